@@ -0,0 +1,220 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_BENCH_H
+#define MADOPT_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace MadOpt {
+namespace Bench {
+
+using std::string;
+using std::vector;
+
+typedef unsigned int Idx;
+
+//! the timed operation
+typedef std::function<void()> Op;
+
+//! prepares everything for problem size n and returns the operation to time
+typedef std::function<Op(Idx n)> Factory;
+
+//! keeps the compiler from optimising away a result
+template<class T>
+inline void doNotOptimize(const T& value){
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+struct Result {
+    string name;
+    Idx size;
+    Idx iterations;
+    double mean_ns;
+    double median_ns;
+    double min_ns;
+};
+
+/*! \brief minimal benchmark harness
+ * \details every benchmark is timed in batches until min_time seconds are
+ * used, a batch runs the operation so often that it takes at least 1/20 of
+ * min_time. Reported are mean, median and min of the time per operation over
+ * the batches. The results are printed as table and written as json.
+ *
+ * command line: [--filter substring] [--min-time seconds] [--out file.json]
+ * [--quick] (only the smallest size of every benchmark)
+ */
+class Runner {
+    public:
+        Runner(int argc, char** argv): min_time(0.5), quick(false){
+            for (int i=1; i<argc; i++){
+                const string arg(argv[i]);
+                if (arg == "--filter" && i+1 < argc)
+                    filter = argv[++i];
+                else if (arg == "--min-time" && i+1 < argc)
+                    min_time = std::stod(argv[++i]);
+                else if (arg == "--out" && i+1 < argc)
+                    out = argv[++i];
+                else if (arg == "--quick")
+                    quick = true;
+                else
+                    std::cerr<<"unknown argument "<<arg<<std::endl;
+            }
+        }
+
+        //! registers the benchmark name for all sizes
+        void add(const string& name, const vector<Idx>& sizes, Factory factory){
+            benchmarks.push_back(Benchmark{name, sizes, factory});
+        }
+
+        //! context information written to the json output
+        void context(const string& key, const string& value){
+            contexts.push_back(std::make_pair(key, value));
+        }
+
+        //! runs all benchmarks matching the filter and writes the output
+        int run(){
+            for (auto& b: benchmarks){
+                if (b.name.find(filter) == string::npos)
+                    continue;
+                for (auto& n: b.sizes){
+                    results.push_back(measure(b.name, n, b.factory(n)));
+                    print(results.back());
+                    if (quick)
+                        break;
+                }
+            }
+
+            if (!out.empty()){
+                std::ofstream file(out);
+                if (!file){
+                    std::cerr<<"can not write "<<out<<std::endl;
+                    return 1;
+                }
+                json(file);
+            } else {
+                json(std::cout);
+            }
+            return 0;
+        }
+
+        void json(std::ostream& os)const{
+            os.precision(10);
+            os<<"{\n  \"context\": {";
+            for (Idx i=0; i<contexts.size(); i++)
+                os<<(i ? ",\n" : "\n")<<"    \""<<contexts[i].first<<"\": \""
+                    <<contexts[i].second<<"\"";
+            os<<"\n  },\n  \"benchmarks\": [";
+            for (Idx i=0; i<results.size(); i++){
+                const Result& r = results[i];
+                os<<(i ? ",\n" : "\n")<<"    {\"name\": \""<<r.name<<"\", \"size\": "<<r.size
+                    <<", \"iterations\": "<<r.iterations
+                    <<", \"mean_ns\": "<<r.mean_ns
+                    <<", \"median_ns\": "<<r.median_ns
+                    <<", \"min_ns\": "<<r.min_ns<<"}";
+            }
+            os<<"\n  ]\n}"<<std::endl;
+        }
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Benchmark {
+            string name;
+            vector<Idx> sizes;
+            Factory factory;
+        };
+
+        vector<Benchmark> benchmarks;
+        vector<Result> results;
+        vector<std::pair<string, string>> contexts;
+        string filter;
+        string out;
+        double min_time;
+        bool quick;
+
+        static double seconds(const Clock::time_point& start){
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        Result measure(const string& name, Idx n, const Op& op)const{
+            // warm up and estimate the batch size
+            Idx batch = 1;
+            while (1){
+                auto start = Clock::now();
+                for (Idx i=0; i<batch; i++)
+                    op();
+                const double t = seconds(start);
+                if (t >= min_time/20 || batch >= (Idx(1)<<30))
+                    break;
+                batch *= t > 0 ? std::max(Idx(2), std::min(Idx(100), Idx(min_time/20/t) + 1)) : 100;
+            }
+
+            vector<double> times;
+            Idx iterations = 0;
+            auto total = Clock::now();
+            do {
+                auto start = Clock::now();
+                for (Idx i=0; i<batch; i++)
+                    op();
+                times.push_back(1e9*seconds(start)/batch);
+                iterations += batch;
+            } while (seconds(total) < min_time || times.size() < 3);
+
+            Result r;
+            r.name = name;
+            r.size = n;
+            r.iterations = iterations;
+            double sum = 0;
+            for (auto& t: times)
+                sum += t;
+            r.mean_ns = sum/times.size();
+            std::sort(times.begin(), times.end());
+            r.median_ns = times[times.size()/2];
+            r.min_ns = times.front();
+            return r;
+        }
+
+        static void print(const Result& r){
+            std::ostringstream line;
+            line<<r.name<<"/"<<r.size;
+            string label = line.str();
+            label.resize(std::max(label.size(), std::size_t(40)), ' ');
+            line.str("");
+            line<<std::fixed;
+            line.precision(1);
+            line<<label<<" "<<r.median_ns<<" ns (min "<<r.min_ns
+                <<", "<<r.iterations<<" iterations)";
+            std::cerr<<line.str()<<std::endl;
+        }
+};
+
+}
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
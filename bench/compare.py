@@ -0,0 +1,32 @@
+#!/usr/bin/env python
+# Compares two result files of madopt_bench, e.g.
+#   madopt_bench --out old.json; ...; madopt_bench --out new.json
+#   python bench/compare.py old.json new.json
+import json
+import sys
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    res = {}
+    for b in data["benchmarks"]:
+        res[(b["name"], b["size"])] = b["median_ns"]
+    return data["context"], res
+
+def main():
+    if len(sys.argv) != 3:
+        print("usage: compare.py old.json new.json")
+        sys.exit(1)
+    old_ctx, old = load(sys.argv[1])
+    new_ctx, new = load(sys.argv[2])
+    print("old: %s, new: %s" % (old_ctx.get("revision"), new_ctx.get("revision")))
+    print("%-40s %14s %14s %8s" % ("benchmark", "old [ns]", "new [ns]", "new/old"))
+    for key in sorted(set(old) | set(new)):
+        label = "%s/%d" % key
+        if key not in old or key not in new:
+            print("%-40s %14s %14s" % (label, old.get(key, "-"), new.get(key, "-")))
+            continue
+        print("%-40s %14.1f %14.1f %8.3f" % (label, old[key], new[key], new[key]/old[key]))
+
+if __name__ == "__main__":
+    main()
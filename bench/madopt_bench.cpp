@@ -0,0 +1,398 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <memory>
+
+#include "bench.hpp"
+#include "../src/model.hpp"
+#include "../src/inner_constraint.hpp"
+#include "../src/pairhashmap.hpp"
+#include "../src/array.hpp"
+
+using namespace MadOpt;
+using Bench::Op;
+using Bench::doNotOptimize;
+
+#ifndef MADOPT_BENCH_REVISION
+#define MADOPT_BENCH_REVISION "unknown"
+#endif
+
+#ifndef MADOPT_BENCH_BUILD_TYPE
+#define MADOPT_BENCH_BUILD_TYPE "unknown"
+#endif
+
+//! model without solver, only the evaluation routines are used
+class BenchModel: public Model {
+    public:
+        void solve(){}
+};
+
+//! a synthetic model: the variables, the objective and the constraints
+struct Synthetic {
+    vector<Var> x;
+    Expr obj;
+    vector<Expr> constraints;
+};
+
+typedef void (*Generator)(BenchModel& m, Synthetic& s, Idx n);
+
+static void addVars(BenchModel& m, Synthetic& s, Idx n){
+    for (Idx i=0; i<n; i++)
+        s.x.push_back(m.addVar(-1.5, 0, -0.5, "x" + std::to_string((long long int)i)));
+}
+
+//! every constraint couples three neighbouring variables
+static void chained(BenchModel& m, Synthetic& s, Idx n){
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i] - 1, 2);
+    for (Idx i=0; i+2<n; i++){
+        const double a = double(i+2)/(double)n;
+        s.constraints.push_back((pow(s.x[i+1], 2) + 1.5*s.x[i+1] - a)*cos(s.x[i+2]) - s.x[i]);
+    }
+}
+
+//! blocks of 10 variables, every block has 10 constraints with a dense hessian
+static void denseBlock(BenchModel& m, Synthetic& s, Idx n){
+    const Idx B = 10;
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx b=0; b+B<=n; b+=B){
+        for (Idx k=0; k<B; k++){
+            Expr e(0);
+            for (Idx j=0; j<B; j++)
+                e += s.x[b+j]*s.x[b+(j+k)%B];
+            s.constraints.push_back(e);
+        }
+    }
+}
+
+//! blocks of 500 variables, one constraint per block with a dense 500x500
+//hessian
+static void denseHessian(BenchModel& m, Synthetic& s, Idx n){
+    const Idx B = 500;
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx b=0; b+B<=n; b+=B){
+        Expr e(0);
+        for (Idx j=0; j<B; j++)
+            e += (j+1)*s.x[b+j];
+        s.constraints.push_back(pow(e, 2));
+    }
+}
+
+//! two constraints that contain all variables
+static void wideSum(BenchModel& m, Synthetic& s, Idx n){
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    Expr e1(0);
+    Expr e2(0);
+    for (Idx i=0; i<n; i++){
+        s.obj += pow(s.x[i], 2);
+        e1 += (i+1)*s.x[i]*s.x[(i+1)%n];
+        e2 += sin(s.x[i]);
+    }
+    s.constraints.push_back(e1);
+    s.constraints.push_back(e2);
+}
+
+//! constraints nested 100 levels deep, e = cos(e*x_i) + x_i
+static void deepNesting(BenchModel& m, Synthetic& s, Idx n){
+    const Idx D = 100;
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx b=0; b<n; b+=D){
+        Expr e = s.x[b];
+        for (Idx i=b+1; i<std::min(n, b+D); i++)
+            e = cos(e*s.x[i]) + s.x[i];
+        s.constraints.push_back(e);
+    }
+}
+
+//! blocks of 5 variables, one constraint per block with 100 products of
+//them, most entries conflict many times
+static void repeatedVars(BenchModel& m, Synthetic& s, Idx n){
+    const Idx B = 5;
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx b=0; b+B<=n; b+=B){
+        Expr e(0);
+        for (Idx k=0; k<100; k++)
+            e += s.x[b+k%B]*s.x[b+(3*k+1)%B]*s.x[b+(k/B)%B];
+        s.constraints.push_back(e);
+    }
+}
+
+//! one constraint per variable with the common powers and sin*cos
+static void intrinsics(BenchModel& m, Synthetic& s, Idx n){
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx i=0; i<n; i++){
+        const Var& a = s.x[i];
+        const Var& b = s.x[(i+1)%n];
+        s.constraints.push_back(sqrt(a*a + 1) + pow(b + 2, -1) + pow(a, 3)
+                + pow(a - b, 5) + sin(a)*cos(b) + pow(b*b + 1, 1.5));
+    }
+}
+
+//! one constraint per variable with quotients, differences and scaled
+//terms
+static void quotients(BenchModel& m, Synthetic& s, Idx n){
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx i=0; i<n; i++){
+        const Var& a = s.x[i];
+        const Var& b = s.x[(i+1)%n];
+        const Var& c = s.x[(i+2)%n];
+        s.constraints.push_back((a - b)/(a*a + 1) - 2*c + 3
+                + (b*c - 0.5)/(c - 2) - a/b*0.1);
+    }
+}
+
+//! one constraint per variable, a sum of products of 4 to 8 of the next
+//variables like the multilinear terms of pooling models
+static void multilinear(BenchModel& m, Synthetic& s, Idx n){
+    addVars(m, s, n);
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(s.x[i], 2);
+    for (Idx i=0; i<n; i++){
+        Expr e(0);
+        for (Idx k=4; k<=8; k++){
+            Expr p = s.x[i];
+            for (Idx j=1; j<k; j++)
+                p *= s.x[(i+j*k)%n];
+            e += p;
+        }
+        s.constraints.push_back(e);
+    }
+}
+
+//! builds the synthetic model, the vars and exprs are kept in s
+static void build(Generator gen, BenchModel& m, Synthetic& s, Idx n){
+    gen(m, s, n);
+    m.setObj(s.obj);
+    FOREACH(e, s.constraints)
+    //for (auto& e: s.constraints){
+        m.addConstr(e, 0);
+    }
+}
+
+//! model and evaluation buffers shared by the benchmarks of one size
+struct Fixture {
+    BenchModel m;
+    Synthetic s;
+    vector<double> x;
+    vector<double> jac;
+    vector<double> hess;
+    vector<double> lambda;
+
+    Fixture(Generator gen, Idx n){
+        build(gen, m, s, n);
+        x.assign(m.nx(), 0.5);
+        jac.resize(m.getNNZ_Jac());
+        hess.resize(m.getNNZ_Hess());
+        lambda.assign(m.ng(), 1);
+        m.setEvals(x.data());
+    }
+};
+
+static void addExprBenchmarks(Bench::Runner& runner, const vector<Idx>& sizes){
+    struct Vars {
+        BenchModel m;
+        vector<Var> x;
+    };
+    auto vars = [](Idx n){
+        shared_ptr<Vars> v(new Vars());
+        for (Idx i=0; i<n+1; i++)
+            v->x.push_back(v->m.addVar("x" + std::to_string((long long int)i)));
+        return v;
+    };
+
+    runner.add("expr/add", sizes, [vars](Idx n){
+        auto v = vars(n);
+        return Op([v, n]{
+            Expr e(0);
+            for (Idx i=0; i<n; i++)
+                e += v->x[i];
+            doNotOptimize(e);
+        });
+    });
+    runner.add("expr/mul", sizes, [vars](Idx n){
+        auto v = vars(n);
+        return Op([v, n]{
+            Expr e(0);
+            for (Idx i=0; i<n; i++)
+                e += v->x[i]*v->x[i+1];
+            doNotOptimize(e);
+        });
+    });
+    runner.add("expr/pow", sizes, [vars](Idx n){
+        auto v = vars(n);
+        return Op([v, n]{
+            Expr e(0);
+            for (Idx i=0; i<n; i++)
+                e += pow(v->x[i] - 1, 2);
+            doNotOptimize(e);
+        });
+    });
+    runner.add("expr/trig", sizes, [vars](Idx n){
+        auto v = vars(n);
+        return Op([v, n]{
+            Expr e(0);
+            for (Idx i=0; i<n; i++)
+                e += sin(v->x[i])*cos(v->x[i+1]) + tan(v->x[i]);
+            doNotOptimize(e);
+        });
+    });
+}
+
+static void addStackBenchmarks(Bench::Runner& runner, const vector<Idx>& sizes){
+    runner.add("pairhashmap/insert", sizes, [](Idx n){
+        return Op([n]{
+            PairHashMap map(n);
+            for (Idx i=0; i<n; i++){
+                for (Idx k=0; k<4; k++){
+                    const Idx j = (i*7 + k*13)%n;
+                    map[uPII(i, j)] += 1;
+                }
+            }
+            doNotOptimize(map);
+        });
+    });
+    runner.add("simstack/product", sizes, [](Idx n){
+        shared_ptr<SimStack> stack(new SimStack());
+        shared_ptr<Array<Idx>> jac_plan(new Array<Idx>());
+        shared_ptr<Array<Idx>> hess_plan(new Array<Idx>());
+        return Op([stack, jac_plan, hess_plan, n]{
+            // x0*x1*...*xn, every product creates hessian entries
+            jac_plan->clear();
+            hess_plan->clear();
+            stack->setPlan(jac_plan.get(), hess_plan.get());
+            stack->setXSize(n);
+            stack->emplace_back(Idx(0));
+            for (Idx i=1; i<n; i++){
+                stack->emplace_back(i);
+                stack->doMull();
+            }
+            doNotOptimize(stack->max_hess_size());
+            stack->clear();
+        });
+    });
+}
+
+static void addModelBenchmarks(Bench::Runner& runner, const string& name,
+        Generator gen, const vector<Idx>& sizes){
+    runner.add("build/" + name, sizes, [gen](Idx n){
+        return Op([gen, n]{
+            BenchModel m;
+            Synthetic s;
+            build(gen, m, s, n);
+            doNotOptimize(m.getNNZ_Hess());
+        });
+    });
+    runner.add("inner_constraint/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f, n]{
+            HessStructure hess_structure;
+            SimStack stack;
+            stack.setXSize(n);
+            FOREACH(e, f->s.constraints)
+            //for (auto& e: f->s.constraints){
+                InnerConstraint c(e, -INF, 0, hess_structure, stack);
+                doNotOptimize(c);
+            }
+        });
+    });
+    runner.add("set_evals/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f]{
+            f->m.setEvals(f->x.data());
+        });
+    });
+    runner.add("set_evals_jac/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f]{
+            f->m.setEvals(f->x.data(), EVAL_JAC);
+        });
+    });
+    runner.add("set_evals_value/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f]{
+            f->m.setEvals(f->x.data(), EVAL_VALUE);
+        });
+    });
+    runner.add("set_evals_one_pass/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        // the first evaluation aligns the entries
+        f->m.setEngine(ENGINE_ONE_PASS);
+        f->m.setEvals(f->x.data());
+        return Op([f]{
+            f->m.setEvals(f->x.data());
+        });
+    });
+    runner.add("eval_jac_g/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f]{
+            f->m.eval_jac_g(f->x.data(), false, f->jac.data());
+            doNotOptimize(f->jac[0]);
+        });
+    });
+    runner.add("eval_h/" + name, sizes, [gen](Idx n){
+        shared_ptr<Fixture> f(new Fixture(gen, n));
+        return Op([f]{
+            f->m.eval_h(f->x.data(), false, f->hess.data(), 1, f->lambda.data());
+            doNotOptimize(f->hess[0]);
+        });
+    });
+}
+
+int main(int argc, char** argv){
+    Bench::Runner runner(argc, argv);
+    runner.context("revision", MADOPT_BENCH_REVISION);
+    runner.context("build_type", MADOPT_BENCH_BUILD_TYPE);
+#if defined(__VERSION__)
+    runner.context("compiler", __VERSION__);
+#endif
+
+    const vector<Idx> sizes = {100, 1000, 10000};
+    addExprBenchmarks(runner, sizes);
+    addStackBenchmarks(runner, {100, 1000});
+    addModelBenchmarks(runner, "chained", chained, sizes);
+    addModelBenchmarks(runner, "dense_block", denseBlock, sizes);
+    addModelBenchmarks(runner, "wide_sum", wideSum, sizes);
+    addModelBenchmarks(runner, "dense_hessian", denseHessian, {500, 5000});
+    addModelBenchmarks(runner, "deep_nesting", deepNesting, {100, 1000});
+    addModelBenchmarks(runner, "repeated_vars", repeatedVars, {100, 1000});
+    addModelBenchmarks(runner, "intrinsics", intrinsics, {1000, 10000});
+    addModelBenchmarks(runner, "quotients", quotients, {1000, 10000});
+    addModelBenchmarks(runner, "multilinear", multilinear, {1000, 10000});
+    return runner.run();
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
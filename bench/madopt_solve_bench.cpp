@@ -0,0 +1,351 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "../src/ipopt_model.hpp"
+#include "../src/solve_executor.hpp"
+#ifdef MADOPT_BENCH_BONMIN
+#include "../src/bonmin_model.hpp"
+#endif
+
+using namespace MadOpt;
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(const Clock::time_point& start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//! expressions of an instance, they are added to the model after building
+//so the symbolic construction can be timed on its own
+struct Instance {
+    Expr obj;
+    vector<double> lb;
+    vector<Expr> constraints;
+    vector<double> ub;
+
+    void add(double l, const Expr& e, double u){
+        lb.push_back(l);
+        constraints.push_back(e);
+        ub.push_back(u);
+    }
+};
+
+typedef void (*Generator)(Model& m, Instance& s, Idx n);
+
+static string name(const char* prefix, Idx i){
+    return prefix + std::to_string((long long int)i);
+}
+
+//! extended rosenbrock, unconstrained
+static void rosenbrock(Model& m, Instance& s, Idx n){
+    vector<Var> x;
+    for (Idx i=0; i<n; i++)
+        x.push_back(m.addVar(-INF, INF, i % 2 ? 1 : -1.2, name("x", i)));
+    s.obj = Expr(0);
+    for (Idx i=0; i+1<n; i++)
+        s.obj += 100*pow(x[i+1] - pow(x[i], 2), 2) + pow(1 - x[i], 2);
+}
+
+//! the chained cos problem of examples/get_started.cpp
+static void chainedCos(Model& m, Instance& s, Idx n){
+    vector<Var> x;
+    for (Idx i=0; i<n; i++)
+        x.push_back(m.addVar(-1.5, 0, -0.5, name("x", i)));
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++)
+        s.obj += pow(x[i] - 1, 2);
+    for (Idx i=0; i+2<n; i++){
+        const double a = double(i+2)/(double)n;
+        s.add(0, (pow(x[i+1], 2) + 1.5*x[i+1] - a)*cos(x[i+2]) - x[i], 0);
+    }
+}
+
+//! explicit euler discretisation of y' = sin(y) + u on [0, 1], the state
+//should track 1 with bounded control
+static void optimalControl(Model& m, Instance& s, Idx n){
+    const Idx steps = std::max(n/2, (Idx)2);
+    const double h = 1.0/steps;
+    vector<Var> y, u;
+    for (Idx i=0; i<=steps; i++)
+        y.push_back(m.addVar(i == 0 ? 0 : -INF, i == 0 ? 0 : INF, 0, name("y", i)));
+    for (Idx i=0; i<steps; i++)
+        u.push_back(m.addVar(-1, 1, 0, name("u", i)));
+    s.obj = Expr(0);
+    for (Idx i=0; i<steps; i++){
+        s.obj += 0.5*h*pow(y[i+1] - 1, 2) + 0.005*h*pow(u[i], 2);
+        s.add(0, y[i+1] - y[i] - h*(sin(y[i]) + u[i]), 0);
+    }
+}
+
+//! convex qp with a tridiagonal hessian and sparse linear constraints
+static void sparseQP(Model& m, Instance& s, Idx n){
+    vector<Var> x;
+    for (Idx i=0; i<n; i++)
+        x.push_back(m.addVar(-10, 10, 0, name("x", i)));
+    s.obj = Expr(0);
+    for (Idx i=0; i<n; i++){
+        s.obj += (1 + (i % 7))*pow(x[i], 2) - x[i];
+        if (i+1 < n)
+            s.obj += 0.5*x[i]*x[i+1];
+    }
+    for (Idx i=0; i+2<n; i+=2)
+        s.add(1, x[i] + 2*x[i+1] + x[i+2], INF);
+}
+
+#ifdef MADOPT_BENCH_BONMIN
+//! small facility problem, x_i may only be positive if y_i is open
+static void minlp(Model& m, Instance& s, Idx n){
+    n = std::min(n, (Idx)50);
+    vector<Var> x, y;
+    for (Idx i=0; i<n; i++){
+        x.push_back(m.addVar(0, 1, 0, name("x", i)));
+        y.push_back(m.addBVar(0, name("y", i)));
+    }
+    s.obj = Expr(0);
+    Expr total(0);
+    for (Idx i=0; i<n; i++){
+        s.obj += pow(x[i] - 0.5 - double(i)/n, 2) + 0.2*y[i];
+        s.add(-INF, x[i] - y[i], 0);
+        total += x[i];
+    }
+    s.add(n/4.0, total, INF);
+}
+#endif
+
+struct Problem {
+    string name;
+    Generator generator;
+    bool minlp;
+};
+
+struct Config {
+    string linear_solver;
+    Idx max_iter;
+};
+
+//! measurements of one run, negative values are not available
+struct Result {
+    double build;
+    double symbolic;
+    double solve;
+    double callbacks;
+    double ipopt;
+    long iterations;
+    long peak_rss_kb;
+    int status;
+};
+
+static void build(Model& m, Generator gen, Idx n, double& build_time, double& symbolic_time){
+    Instance s;
+    auto start = Clock::now();
+    gen(m, s, n);
+    build_time += seconds(start);
+
+    start = Clock::now();
+    m.setObj(s.obj);
+    for (Idx i=0; i<s.constraints.size(); i++)
+        m.addConstr(s.lb[i], s.constraints[i], s.ub[i]);
+    symbolic_time += seconds(start);
+}
+
+static void setOptions(Model& m, const Config& config, bool minlp){
+    m.show_solver = false;
+    if (minlp)
+        return;
+    m.setIntegerOption("max_iter", config.max_iter);
+    if (!config.linear_solver.empty())
+        m.setStringOption("linear_solver", config.linear_solver);
+}
+
+//! threads independent copies solved by a SolveExecutor with threads
+//workers, build and symbolic are per model, solve is the wall time of all,
+//callbacks and iterations are the ones of the first model
+static Result run(const Problem& p, Idx n, Idx threads, const Config& config){
+    Result r = {0, 0, -1, -1, -1, -1, -1, -1};
+    vector<unique_ptr<Model>> models;
+    for (Idx t=0; t<threads; t++){
+#ifdef MADOPT_BENCH_BONMIN
+        if (p.minlp)
+            models.emplace_back(new BonminModel());
+        else
+#endif
+            models.emplace_back(new IpoptModel());
+        build(*models.back(), p.generator, n, r.build, r.symbolic);
+        setOptions(*models.back(), config, p.minlp);
+    }
+    r.build /= threads;
+    r.symbolic /= threads;
+
+    SolveExecutor executor(threads);
+    vector<std::future<Solution>> solutions;
+    auto start = Clock::now();
+    FOREACH(m, models)
+    //for (auto& m: models){
+        solutions.push_back(executor.submit(*m));
+    }
+    FOREACH(s, solutions)
+    //for (auto& s: solutions){
+        s.wait();
+    }
+    r.solve = seconds(start);
+    r.status = models.front()->status();
+
+    // the statistics are only collected if madopt is built with ENABLE_STATS
+    const SolveStats& stats = models.front()->stats();
+    if (stats.solve.calls > 0){
+        r.callbacks = stats.callbackSeconds();
+        r.ipopt = stats.solve.seconds - r.callbacks;
+        r.iterations = stats.iterations;
+    }
+    return r;
+}
+
+//! runs in a child process so that the peak rss belongs to this run only
+static bool runForked(const Problem& p, Idx n, Idx threads, const Config& config, Result& r){
+    int fds[2];
+    if (pipe(fds) != 0)
+        return false;
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0){
+        close(fds[0]);
+        Result res = run(p, n, threads, config);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        res.peak_rss_kb = usage.ru_maxrss;
+        ssize_t written = write(fds[1], &res, sizeof(res));
+        close(fds[1]);
+        _exit(written == sizeof(res) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &r, sizeof(r));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return got == sizeof(r) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static string number(double v){
+    if (v < 0)
+        return "null";
+    std::ostringstream os;
+    os.precision(10);
+    os<<v;
+    return os.str();
+}
+
+int main(int argc, char** argv){
+    vector<Problem> problems = {
+        {"rosenbrock", rosenbrock, false},
+        {"chained_cos", chainedCos, false},
+        {"optimal_control", optimalControl, false},
+        {"sparse_qp", sparseQP, false},
+#ifdef MADOPT_BENCH_BONMIN
+        {"minlp", minlp, true},
+#endif
+    };
+
+    string filter;
+    string out;
+    int min_exp = 3;
+    int max_exp = 5;
+    Idx max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    Config config = {"", 3000};
+    for (int i=1; i<argc; i++){
+        const string arg(argv[i]);
+        if (arg == "--filter" && i+1 < argc)
+            filter = argv[++i];
+        else if (arg == "--out" && i+1 < argc)
+            out = argv[++i];
+        else if (arg == "--min-exp" && i+1 < argc)
+            min_exp = atoi(argv[++i]);
+        else if (arg == "--max-exp" && i+1 < argc)
+            max_exp = atoi(argv[++i]);
+        else if (arg == "--max-threads" && i+1 < argc)
+            max_threads = std::max(atoi(argv[++i]), 1);
+        else if (arg == "--linear-solver" && i+1 < argc)
+            config.linear_solver = argv[++i];
+        else if (arg == "--max-iter" && i+1 < argc)
+            config.max_iter = atoi(argv[++i]);
+        else {
+            std::cerr<<"usage: madopt_solve_bench [--filter name] [--out file.json]"
+                <<" [--min-exp 3] [--max-exp 5] [--max-threads n]"
+                <<" [--linear-solver name] [--max-iter n]"<<std::endl;
+            return 1;
+        }
+    }
+
+    std::ostringstream json;
+    json<<"{\n  \"context\": {\n    \"revision\": \""<<MADOPT_BENCH_REVISION
+        <<"\",\n    \"build_type\": \""<<MADOPT_BENCH_BUILD_TYPE
+        <<"\",\n    \"linear_solver\": \""<<config.linear_solver
+        <<"\"\n  },\n  \"runs\": [";
+    bool first = true;
+    FOREACH(p, problems)
+    //for (auto& p: problems){
+        if (p.name.find(filter) == string::npos)
+            continue;
+        for (int e=min_exp; e<=max_exp; e++){
+            const Idx n = std::pow(10, e);
+            for (Idx threads=1; threads<=max_threads; threads*=2){
+                Result r;
+                if (!runForked(p, n, threads, config, r)){
+                    std::cerr<<p.name<<" n="<<n<<" threads="<<threads<<" failed"<<std::endl;
+                    continue;
+                }
+                std::cerr<<p.name<<" n="<<n<<" threads="<<threads
+                    <<" build="<<r.build<<"s symbolic="<<r.symbolic<<"s solve="<<r.solve
+                    <<"s callbacks="<<r.callbacks<<"s iterations="<<r.iterations
+                    <<" rss="<<r.peak_rss_kb<<"kB"<<std::endl;
+                json<<(first ? "\n" : ",\n")<<"    {\"problem\": \""<<p.name<<"\", \"n\": "<<n
+                    <<", \"threads\": "<<threads
+                    <<", \"build_s\": "<<number(r.build)
+                    <<", \"symbolic_s\": "<<number(r.symbolic)
+                    <<", \"solve_s\": "<<number(r.solve)
+                    <<", \"callbacks_s\": "<<number(r.callbacks)
+                    <<", \"ipopt_s\": "<<number(r.ipopt)
+                    <<", \"iterations\": "<<(r.iterations >= 0 ? std::to_string(r.iterations) : "null")
+                    <<", \"peak_rss_kb\": "<<r.peak_rss_kb
+                    <<", \"status\": "<<r.status<<"}";
+                first = false;
+            }
+        }
+    }
+    json<<"\n  ]\n}"<<std::endl;
+
+    if (out.empty()){
+        std::cout<<json.str();
+    } else {
+        std::ofstream file(out);
+        file<<json.str();
+    }
+    return 0;
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
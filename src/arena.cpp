@@ -0,0 +1,64 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdlib>
+
+#include "arena.hpp"
+#include "common.hpp"
+
+namespace MadOpt {
+
+const std::size_t Arena::first_block_size;
+const std::size_t Arena::max_block_size;
+
+Arena::~Arena(){
+    FOREACH(block, blocks)
+    //for (auto& block: blocks){
+        std::free(block);
+    }
+}
+
+char* Arena::newBlock(std::size_t size){
+    char* block = static_cast<char*>(std::malloc(size));
+    if (block == NULL)
+        throw std::bad_alloc();
+    blocks.push_back(block);
+    reserved += size;
+    return block;
+}
+
+void* Arena::allocate(std::size_t bytes, std::size_t align){
+    std::size_t pad = (align - reinterpret_cast<std::size_t>(current) % align) % align;
+    if (current == NULL || pad + bytes > left){
+        if (bytes > next_size/2){
+            // a dedicated block keeps the current one in use
+            _used += bytes;
+            return newBlock(bytes);
+        }
+        current = newBlock(next_size);
+        left = next_size;
+        next_size = std::min(2*next_size, max_block_size);
+        pad = 0;
+    }
+    void* res = current + pad;
+    current += pad + bytes;
+    left -= pad + bytes;
+    _used += pad + bytes;
+    return res;
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_ARENA_H
+#define MADOPT_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MadOpt {
+
+/*! \brief monotonic allocator of a model
+ * \details memory is taken from big blocks and only given back when the
+ * arena is destroyed, hence the objects in it are never destructed, they
+ * must not own memory outside of the arena. The block size doubles up to
+ * max_block_size, bigger requests get their own block.
+ */
+class Arena {
+    public:
+        static const std::size_t first_block_size = 1<<16;
+        static const std::size_t max_block_size = 1<<26;
+
+        Arena(): current(NULL), left(0), next_size(first_block_size),
+            reserved(0), _used(0){}
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        ~Arena();
+
+        void* allocate(std::size_t bytes, std::size_t align=alignof(std::max_align_t));
+
+        //! constructs a T in the arena, its destructor is never called
+        template<class T, class... Args>
+        T* create(Args&&... args){
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        //! bytes of all blocks
+        std::size_t bytes()const { return reserved; }
+
+        //! bytes handed out, including the alignment
+        std::size_t used()const { return _used; }
+
+        std::size_t nofBlocks()const { return blocks.size(); }
+
+    private:
+        std::vector<char*> blocks;
+        char* current;
+        std::size_t left;
+        std::size_t next_size;
+        std::size_t reserved;
+        std::size_t _used;
+
+        char* newBlock(std::size_t size);
+};
+
+/*! \brief std allocator that takes the memory from an arena
+ * \details without arena it uses the global operator new, so containers
+ * with this allocator can be used inside and outside of a model
+ */
+template<class T>
+class ArenaAllocator {
+    public:
+        typedef T value_type;
+
+        ArenaAllocator(Arena* arena=NULL) noexcept : arena(arena){}
+
+        template<class U>
+        ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena){}
+
+        T* allocate(std::size_t n){
+            if (arena != NULL)
+                return static_cast<T*>(arena->allocate(n*sizeof(T), alignof(T)));
+            return static_cast<T*>(::operator new(n*sizeof(T)));
+        }
+
+        void deallocate(T* p, std::size_t){
+            if (arena == NULL)
+                ::operator delete(p);
+        }
+
+        Arena* arena;
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){
+    return a.arena == b.arena;
+}
+
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b){
+    return a.arena != b.arena;
+}
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>> ArenaString;
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
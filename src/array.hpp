@@ -19,6 +19,7 @@
 #include <vector>
 #include "common.hpp"
 #include "logger.hpp"
+#include "arena.hpp"
 #include <string.h>
 
 namespace MadOpt {
@@ -26,8 +27,8 @@ namespace MadOpt {
 template<class T>
 class Array {
     public:
-        Array(const Idx init_size=0): 
-            data(init_size), data_end(init_size){}
+        Array(const Idx init_size=0, Arena* arena=NULL): 
+            data(init_size, T(), ArenaAllocator<T>(arena)), data_end(init_size){}
 
         const Idx& size()const {
             return data_end;
@@ -124,6 +125,24 @@ class Array {
             data.resize(new_size);
         }
 
+        //! copies the used elements of other, allocates exactly their size
+        void assign(const Array& other){
+            data.assign(other.data.begin(), other.data.begin() + other.data_end);
+            data_end = other.data_end;
+            iter = 0;
+        }
+
+        //! allocated heap memory
+        std::size_t bytes()const {
+            return data.capacity()*sizeof(T);
+        }
+
+        //! like resize() but never shrinks, the push*Save methods rely on it
+        void grow(const Idx& new_size){
+            if (new_size > data.size())
+                data.resize(new_size);
+        }
+
         std::string str()const {
             std::string res;
             for (Idx i=0; i<data_end; i++){
@@ -136,7 +155,7 @@ class Array {
         }
 
     private:
-        std::vector<T> data;
+        ArenaVector<T> data;
         Idx data_end;
         Idx iter;
 
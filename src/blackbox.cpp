@@ -0,0 +1,271 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <limits>
+#include <cmath>
+
+#include "blackbox.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+
+namespace MadOpt {
+
+const Idx BlackBox::NONE = std::numeric_limits<Idx>::max();
+
+BlackBox::BlackBox(const vector<Var>& vars, Idx rows, const vector<PII>& jac_pattern,
+        Jacobian jacobian, Hessian hessian, Idx threads):
+    CallbackBlock(&BlackBox::callback, this),
+    jac_pattern(jac_pattern),
+    jacobian(jacobian),
+    hessian(hessian),
+    threads(std::max(threads, (Idx)1)),
+    nrows(rows)
+{
+    TRACE_START;
+    FOREACH(v, vars)
+    //for (auto& v: vars){
+        pos.push_back(v.getPos());
+    }
+
+    vector<vector<Idx>> row_cols(rows);
+    vector<int> jac_rows, jac_cols;
+    FOREACH(e, jac_pattern)
+    //for (auto& e: jac_pattern){
+        if (e.first >= rows || e.second >= pos.size())
+            throw MadOptError("invalid jacobian entry of black box");
+        row_cols[e.first].push_back(e.second);
+        jac_rows.push_back(e.first);
+        jac_cols.push_back(pos[e.second]);
+    }
+
+    vector<int> hess_rows, hess_i, hess_j;
+    if (hessian == SECOND_DIFFERENCE){
+        for (Idx r=0; r<rows; r++){
+            const vector<Idx>& cols = row_cols[r];
+            for (Idx a=0; a<cols.size(); a++){
+                for (Idx b=a; b<cols.size(); b++){
+                    hess_pattern.push_back(std::make_pair(r, PII(cols[a], cols[b])));
+                    hess_rows.push_back(r);
+                    hess_i.push_back(pos[cols[a]]);
+                    hess_j.push_back(pos[cols[b]]);
+                }
+            }
+        }
+    }
+
+    setPattern(rows, jac_rows.size(), jac_rows.data(), jac_cols.data(),
+            hess_rows.size(), hess_rows.data(), hess_i.data(), hess_j.data());
+
+    colorColumns();
+
+    for (Idx a=0; a<color_cols.size(); a++)
+        single_perts.push_back(PII(a, NONE));
+    if (hessian == SECOND_DIFFERENCE){
+        pair_index.assign(color_cols.size(), vector<Idx>(color_cols.size(), 0));
+        for (Idx a=0; a<color_cols.size(); a++){
+            for (Idx b=a; b<color_cols.size(); b++){
+                pair_index[a][b] = pair_index[b][a] = pair_perts.size();
+                pair_perts.push_back(PII(a, b));
+            }
+        }
+    }
+
+    x_local.resize(pos.size());
+    fd_steps.resize(pos.size());
+    sd_steps.resize(pos.size());
+    cs_steps.assign(pos.size(), Complex(0, 1e-20));
+
+    // all buffers of evaluate() are allocated here
+    if (jacobian == COMPLEX_STEP){
+        complex_res.resize(single_perts.size()*nrows);
+        complex_xp.assign(this->threads, vector<Complex>(pos.size()));
+    }
+    if (jacobian == FORWARD_DIFFERENCE || hessian == SECOND_DIFFERENCE){
+        single_res.resize(single_perts.size()*nrows);
+        real_xp.assign(this->threads, vector<double>(pos.size()));
+    }
+    if (hessian == SECOND_DIFFERENCE)
+        pair_res.resize(pair_perts.size()*nrows);
+    TRACE_END;
+}
+
+void BlackBox::g(const Complex*, Complex*)const{
+    throw MadOptError("black box does not implement g for complex arguments");
+}
+
+Idx BlackBox::nofEvaluations()const{
+    return 1 + single_perts.size()
+        + (hessian == SECOND_DIFFERENCE ? single_perts.size() + pair_perts.size() : 0);
+}
+
+void BlackBox::colorColumns(){
+    // greedy distance-1 colouring of the column intersection graph
+    vector<vector<Idx>> col_rows(pos.size());
+    vector<vector<Idx>> row_cols(nrows);
+    FOREACH(e, jac_pattern)
+    //for (auto& e: jac_pattern){
+        col_rows[e.second].push_back(e.first);
+        row_cols[e.first].push_back(e.second);
+    }
+
+    color.assign(pos.size(), NONE);
+    vector<Idx> used_by(pos.size(), NONE);
+    for (Idx j=0; j<pos.size(); j++){
+        FOREACH(r, col_rows[j])
+        //for (auto& r: col_rows[j]){
+            FOREACH(k, row_cols[r])
+            //for (auto& k: row_cols[r]){
+                if (color[k] != NONE)
+                    used_by[color[k]] = j;
+            }
+        }
+        Idx c = 0;
+        while (used_by[c] == j)
+            c++;
+        color[j] = c;
+        if (c == color_cols.size())
+            color_cols.push_back(vector<Idx>());
+        color_cols[c].push_back(j);
+    }
+}
+
+template<class T>
+void BlackBox::evalPerturbed(const vector<PII>& perts, const vector<T>& shift,
+        vector<T>& res, vector<vector<T>>& xps)const{
+    ASSERT_EQ(res.size(), perts.size()*nrows);
+    auto work = [&](Idx first){
+        vector<T>& xp = xps[first];
+        std::copy(x_local.begin(), x_local.end(), xp.begin());
+        for (Idx p=first; p<perts.size(); p+=threads){
+            const PII& pert = perts[p];
+            FOREACH(j, color_cols[pert.first])
+            //for (auto& j: color_cols[pert.first]){
+                xp[j] += shift[j];
+            }
+            if (pert.second != NONE){
+                FOREACH(j, color_cols[pert.second])
+                //for (auto& j: color_cols[pert.second]){
+                    xp[j] += shift[j];
+                }
+            }
+
+            this->g(xp.data(), res.data() + p*nrows);
+
+            FOREACH(j, color_cols[pert.first])
+            //for (auto& j: color_cols[pert.first]){
+                xp[j] = x_local[j];
+            }
+            if (pert.second != NONE){
+                FOREACH(j, color_cols[pert.second])
+                //for (auto& j: color_cols[pert.second]){
+                    xp[j] = x_local[j];
+                }
+            }
+        }
+    };
+
+    const Idx nof_threads = std::min(threads, (Idx)perts.size());
+    if (nof_threads <= 1){
+        work(0);
+        return;
+    }
+
+    vector<std::thread> workers;
+    std::exception_ptr exception;
+    std::mutex lock;
+    for (Idx t=1; t<nof_threads; t++){
+        workers.emplace_back([&, t]{
+            try {
+                work(t);
+            } catch (...){
+                std::unique_lock<std::mutex> _lock(lock);
+                exception = std::current_exception();
+            }
+        });
+    }
+    try {
+        work(0);
+    } catch (...){
+        std::unique_lock<std::mutex> _lock(lock);
+        exception = std::current_exception();
+    }
+    FOREACH(t, workers)
+    //for (auto& t: workers){
+        t.join();
+    }
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+bool BlackBox::callback(void* data, const double* x, Idx, double* g, double* jac, double* hess){
+    return static_cast<BlackBox*>(data)->evaluate(x, g, jac, hess);
+}
+
+bool BlackBox::evaluate(const double* x, double* g, double* jac, double* hess){
+    TRACE_START;
+    static const double fd_eps = std::sqrt(std::numeric_limits<double>::epsilon());
+    static const double sd_eps = std::cbrt(std::numeric_limits<double>::epsilon());
+
+    for (Idx i=0; i<pos.size(); i++){
+        x_local[i] = x[pos[i]];
+        const double scale = std::max(1.0, std::fabs(x_local[i]));
+        // the actually applied step, x + h is rounded
+        fd_steps[i] = (x_local[i] + fd_eps*scale) - x_local[i];
+        sd_steps[i] = (x_local[i] + sd_eps*scale) - x_local[i];
+    }
+
+    this->g(x_local.data(), g);
+
+    if (jacobian == COMPLEX_STEP){
+        evalPerturbed(single_perts, cs_steps, complex_res, complex_xp);
+        for (Idx k=0; k<jac_pattern.size(); k++){
+            const PII& e = jac_pattern[k];
+            jac[k] = complex_res[color[e.second]*nrows + e.first].imag()
+                / cs_steps[e.second].imag();
+        }
+    } else {
+        evalPerturbed(single_perts, fd_steps, single_res, real_xp);
+        for (Idx k=0; k<jac_pattern.size(); k++){
+            const PII& e = jac_pattern[k];
+            jac[k] = (single_res[color[e.second]*nrows + e.first] - g[e.first])
+                / fd_steps[e.second];
+        }
+    }
+
+    if (hessian == SECOND_DIFFERENCE){
+        // (g(x + d_a + d_b) - g(x + d_a) - g(x + d_b) + g(x))/(h_i*h_j), the
+        // colouring ensures that row r has at most one variable in a and b
+        evalPerturbed(single_perts, sd_steps, single_res, real_xp);
+        evalPerturbed(pair_perts, sd_steps, pair_res, real_xp);
+        for (Idx k=0; k<hess_pattern.size(); k++){
+            const Idx r = hess_pattern[k].first;
+            const Idx i = hess_pattern[k].second.first;
+            const Idx j = hess_pattern[k].second.second;
+            const Idx a = color[i];
+            const Idx b = color[j];
+            hess[k] = (pair_res[pair_index[a][b]*nrows + r]
+                    - single_res[a*nrows + r] - single_res[b*nrows + r] + g[r])
+                / (sd_steps[i]*sd_steps[j]);
+        }
+    }
+    TRACE_END;
+    return true;
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_BLACKBOX_H
+#define MADOPT_BLACKBOX_H
+
+#include <complex>
+
+#include "python_callback.hpp"
+#include "var.hpp"
+
+namespace MadOpt {
+
+/*! \brief block of constraints given only by their values
+ * \details derive from it and implement g() on the local variables, i.e.
+ * x[i] is the value of vars[i]. The jacobian is computed by forward
+ * differences or by the complex step, the hessian by second differences or
+ * it is declared absent (then ipopt has to approximate it, e.g. with
+ * hessian_approximation limited-memory). Columns that never share a row
+ * get the same colour and are perturbed together, hence the number of
+ * calls of g() depends on the number of colours and not on the number of
+ * variables. The perturbed evaluations of one x can be distributed over
+ * several threads, then g() must be thread safe.
+ * Add the block with Model::addCallbackConstrs(), the model takes ownership.
+ */
+class BlackBox: public CallbackBlock {
+    public:
+        enum Jacobian { FORWARD_DIFFERENCE, COMPLEX_STEP };
+        enum Hessian { NO_HESSIAN, SECOND_DIFFERENCE };
+
+        /*!
+         * @param[in] vars the variables g depends on
+         * @param[in] rows number of constraints
+         * @param[in] jac_pattern (row, local variable) of the nonzeros of
+         * the jacobian
+         * @param[in] jacobian how the jacobian is computed
+         * @param[in] hessian how the hessian is computed, the hessian of a
+         * row is assumed dense over the variables of that row
+         * @param[in] threads number of threads used for the perturbed
+         * evaluations, with threads > 1 the workers are started for every
+         * new x, which allocates
+         */
+        BlackBox(const vector<Var>& vars, Idx rows, const vector<PII>& jac_pattern,
+                Jacobian jacobian=FORWARD_DIFFERENCE, Hessian hessian=NO_HESSIAN,
+                Idx threads=1);
+
+        //! constraint values of the local variables x
+        virtual void g(const double* x, double* g)const = 0;
+
+        //! complex version of g, needed for COMPLEX_STEP
+        virtual void g(const std::complex<double>* x, std::complex<double>* g)const;
+
+        //! number of colour groups of the variables
+        Idx nofColors()const { return color_cols.size(); }
+
+        //! number of calls of g() per new x
+        Idx nofEvaluations()const;
+
+    private:
+        typedef std::complex<double> Complex;
+
+        //! model position of each local variable
+        vector<Idx> pos;
+
+        //! (row, local variable) of the jacobian entries
+        vector<PII> jac_pattern;
+
+        //! (row, local i, local j) of the hessian entries
+        vector<std::pair<Idx, PII>> hess_pattern;
+
+        //! colour of each local variable
+        vector<Idx> color;
+
+        //! local variables of each colour
+        vector<vector<Idx>> color_cols;
+
+        //! index of the perturbation x + d_a + d_b in pair_perts
+        vector<vector<Idx>> pair_index;
+
+        //! perturbations as (colour a, colour b), NONE if only a is shifted
+        vector<PII> single_perts;
+        vector<PII> pair_perts;
+
+        Jacobian jacobian;
+        Hessian hessian;
+        Idx threads;
+        Idx nrows;
+
+        vector<double> x_local;
+        vector<double> fd_steps;
+        vector<double> sd_steps;
+        vector<Complex> cs_steps;
+        vector<double> single_res;
+        vector<double> pair_res;
+        vector<Complex> complex_res;
+        //! perturbed x of every thread, allocated once
+        vector<vector<double>> real_xp;
+        vector<vector<Complex>> complex_xp;
+
+        static const Idx NONE;
+
+        static bool callback(void* data, const double* x, Idx nx,
+                double* g, double* jac, double* hess);
+
+        bool evaluate(const double* x, double* g, double* jac, double* hess);
+
+        void colorColumns();
+
+        //! evaluates g at x_local + shift of the colours of each perturbation
+        template<class T>
+        void evalPerturbed(const vector<PII>& perts, const vector<T>& shift,
+                vector<T>& res, vector<vector<T>>& xps)const;
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -17,6 +17,7 @@
 #include "bonmin_model.hpp"
 #include "solution.hpp"
 #include "logger.hpp"
+#include "tracing.hpp"
 
 using namespace MadOpt;
 
@@ -24,6 +25,8 @@ BonminUserClass::BonminUserClass(BonminModel* solver): solver(solver){}
 
 bool BonminUserClass::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
                             Index& nnz_h_lag, Ipopt::TNLP::IndexStyleEnum& index_style){
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("bonmin::get_nlp_info");
     n = solver->nx();
     m = solver->ng();
     nnz_jac_g = solver->getNNZ_Jac();
@@ -86,6 +89,8 @@ void BonminUserClass::finalize_solution(SolverReturn status, Index n, const Numb
 
 bool BonminUserClass::get_bounds_info(Index n, Number* x_l, Number* x_u,
                                Index m, Number* g_l, Number* g_u){
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("bonmin::get_bounds_info");
     ASSERT(n >= 0); 
     ASSERT(m >= 0); 
     ASSERT((unsigned int)n==solver->nx());
@@ -98,6 +103,8 @@ bool BonminUserClass::get_starting_point(Index n, bool init_x, Number* x,
                                   bool init_z, Number* z_L, Number* z_U,
                                   Index m, bool init_lambda,
                                   Number* lambda){
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("bonmin::get_starting_point");
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
     if (init_x)
@@ -110,6 +117,8 @@ bool BonminUserClass::get_starting_point(Index n, bool init_x, Number* x,
   }
 
 bool BonminUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_value){
+    STATS_TIMER(solver->getStats().eval_f);
+    TRACE_SPAN("bonmin::eval_f");
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
     solver->eval_f(x, new_x, obj_value);
@@ -117,6 +126,8 @@ bool BonminUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_v
 }
 
 bool BonminUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f){
+    STATS_TIMER(solver->getStats().eval_grad_f);
+    TRACE_SPAN("bonmin::eval_grad_f");
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
     solver->eval_grad_f(x, new_x, grad_f);
@@ -124,6 +135,8 @@ bool BonminUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number*
 }
 
 bool BonminUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g){
+    STATS_TIMER(solver->getStats().eval_g);
+    TRACE_SPAN("bonmin::eval_g");
     ASSERT(n >= 0); 
     ASSERT((unsigned int)n==solver->nx());
     solver->eval_g(x, new_x, g);
@@ -133,6 +146,8 @@ bool BonminUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Numb
 bool BonminUserClass::eval_jac_g(Index n, const Number* x, bool new_x,
                         Index m, Index nele_jac, Index* iRow, Index *jCol,
                         Number* values){
+    STATS_TIMER(values == NULL ? solver->getStats().structure : solver->getStats().eval_jac_g);
+    TRACE_SPAN("bonmin::eval_jac_g");
     ASSERT(n >= 0); 
     ASSERT(m >= 0); 
     ASSERT((unsigned int)n==solver->nx());
@@ -149,6 +164,8 @@ bool BonminUserClass::eval_h(Index n, const Number* x, bool new_x,
                     Number obj_factor, Index m, const Number* lambda,
                     bool new_lambda, Index nele_hess, Index* iRow,
                     Index* jCol, Number* values){
+    STATS_TIMER(values == NULL ? solver->getStats().structure : solver->getStats().eval_h);
+    TRACE_SPAN("bonmin::eval_h");
     ASSERT(n >= 0); 
     ASSERT(m >= 0); 
     ASSERT((unsigned int)n==solver->nx());
@@ -17,15 +17,33 @@
 #include "bonmin_minlp.hpp"
 
 #include "common.hpp"
+#include "solver_options.hpp"
+#include "solve_executor.hpp"
+#include "tracing.hpp"
 
 using namespace MadOpt;
 
 namespace MadOpt {
 
-struct BonminModelImpl {
-    BonminModelImpl(BonminModel* model){
+//! bonmin setup of a SolveExecutor worker, the options are registered once
+//and the setup is reused for every model the worker solves
+struct BonminWorkspaceEntry: public SolverWorkspace::Entry {
+    BonminWorkspaceEntry(){
         Bapp = new Bonmin::BonminSetup();
         Bapp->initializeOptionsAndJournalist();
+        defaults = *Bapp->options();
+    }
+
+    ~BonminWorkspaceEntry(){
+        delete Bapp;
+    }
+
+    Bonmin::BonminSetup* Bapp;
+    Ipopt::OptionsList defaults;
+};
+
+struct BonminModelImpl {
+    BonminModelImpl(BonminModel* model): Bapp(nullptr){
         bonmin_callback = new BonminUserClass(model);
     }
 
@@ -33,8 +51,11 @@ struct BonminModelImpl {
         delete Bapp;
     }
 
+    //! created on the first solve(), models that are only solved by a
+    //SolveExecutor never set up their own
     Bonmin::BonminSetup* Bapp;
     Ipopt::SmartPtr<Bonmin::TMINLP> bonmin_callback;
+    SolverOptions options;
 };
 }
 
@@ -47,20 +68,43 @@ BonminModel::~BonminModel(){
 }
 
 void BonminModel::solve(){
+    if (impl->Bapp == nullptr){
+        impl->Bapp = new Bonmin::BonminSetup();
+        impl->Bapp->initializeOptionsAndJournalist();
+    }
+    solve(*impl->Bapp);
+}
+
+void BonminModel::solve(SolverWorkspace& workspace){
+    auto& entry = workspace.get<BonminWorkspaceEntry>();
+    *entry.Bapp->options() = entry.defaults;
+    solve(*entry.Bapp);
+}
+
+void BonminModel::solve(Bonmin::BonminSetup& app){
+    STATS(solve_stats.clear());
+    STATS_TIMER(solve_stats.solve);
+    TRACE_SPAN("BonminModel::solve");
+    finalize();
+    auto options = app.options();
+    impl->options.applyTo(*options);
+
     if (timelimit >= 0)
-        setNumericOption("bonmin.time_limit", timelimit);
+        options->SetNumericValue("bonmin.time_limit", timelimit);
 
     if (not show_solver){
-        setIntegerOption("print_level", 0);
-        setIntegerOption("bonmin.bb_log_level", 0);
-        setIntegerOption("bonmin.nlp_log_level", 0);
-        setStringOption("sb", "yes");
+        options->SetIntegerValue("print_level", 0);
+        options->SetIntegerValue("bonmin.bb_log_level", 0);
+        options->SetIntegerValue("bonmin.nlp_log_level", 0);
+        options->SetStringValue("sb", "yes");
     }
 
     try {
-        impl->Bapp->initialize(GetRawPtr(impl->bonmin_callback));
+        app.initialize(GetRawPtr(impl->bonmin_callback));
         Bonmin::Bab bb;
-        bb(impl->Bapp);
+        bb(app);
+        // for bonmin the number of branch and bound nodes
+        STATS(solve_stats.iterations = bb.numNodes());
     }
     catch(Bonmin::TNLPSolver::UnsolvedError *E) {
         solution.setStatus(Solution::SolverStatus::UNSOLVED_ERROR);
@@ -77,13 +121,16 @@ void BonminModel::solve(){
 }
 
 void BonminModel::setStringOption(std::string key, std::string value){
-    impl->Bapp->options()->SetStringValue(key, value);
+    impl->options.strings[key] = value;
+    // eval_h is never called if the solver approximates the hessian
+    if (key == "hessian_approximation")
+        setEvalLevel(value == "limited-memory" ? EVAL_JAC : EVAL_HESS);
 }
 
 void BonminModel::setNumericOption(std::string key, double value){
-    impl->Bapp->options()->SetNumericValue(key, value);
+    impl->options.numerics[key] = value;
 }
 
 void BonminModel::setIntegerOption(std::string key, int value){
-    impl->Bapp->options()->SetIntegerValue(key, value);
+    impl->options.integers[key] = value;
 }
@@ -18,6 +18,10 @@
 
 #include "model.hpp"
 
+namespace Bonmin {
+class BonminSetup;
+}
+
 namespace MadOpt {
 
 struct BonminModelImpl;
@@ -37,8 +41,15 @@ class BonminModel: public Model {
         void setIntegerOption(std::string key, int value);
         void solve();
 
+        //! solve with the bonmin setup of the workspace, the options of the
+        //setup are reset to the state after initializeOptionsAndJournalist()
+        //first
+        void solve(SolverWorkspace& workspace);
+
     private:
         BonminModelImpl* impl;
+
+        void solve(Bonmin::BonminSetup& app);
 };
 
 }
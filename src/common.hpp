@@ -26,6 +26,8 @@
 #include <iomanip>
 #include <sstream>
 
+#include "arena.hpp"
+
 namespace std {
     template <class T>
     inline void hash_combine(std::size_t & seed, const T & v){
@@ -66,7 +68,6 @@ string doubleToString(const double a_value, int p=10);
 typedef unsigned int Idx;
 typedef pair<Idx, Idx> PII;
 #define uPII(a,b) (((a)<(b))?(PII((a),(b))):(PII((b),(a))))
-typedef unordered_map<PII, int> HessPosMap;
 typedef vector<double> ParamData;
 
 string to_string(PII p);
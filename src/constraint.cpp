@@ -40,4 +40,12 @@ double Constraint::lam()const {
     return model->getSolution().lam(pos);
 }
 
+const string& Constraint::tag()const {
+    return model->tag(pos);
+}
+
+void Constraint::tag(const string& v){
+    model->tag(pos, v);
+}
+
 }
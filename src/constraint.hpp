@@ -44,6 +44,13 @@ class Constraint {
         //! get the lambda value of the current solution, only available
         double lam()const; 
 
+        //! get the tag, \sa Model::profile()
+        const string& tag()const;
+
+        //! set the tag, constraints with the same tag are aggregated in the
+        //profile
+        void tag(const string& v);
+
     private:
         Model* model;
         Idx pos;
@@ -18,6 +18,10 @@
 
 #include "common.hpp"
 #include "array.hpp"
+#include "memory_report.hpp"
+#include "hess_structure.hpp"
+#include "stack.hpp"
+#include "exceptions.hpp"
 
 namespace MadOpt {
 
@@ -28,6 +32,24 @@ class Stack;
 class CStack;
 class SimStack;
 
+//! static description of a constraint, \sa Profiler
+struct TapeInfo {
+    TapeInfo(): operators(0), jac_nnz(0), hess_nnz(0), plan(0),
+        max_stack(0), shape(0){}
+    //! length of the tape, 0 if the constraint has none
+    Idx operators;
+    Idx jac_nnz;
+    //! local hessian entries
+    Idx hess_nnz;
+    //! length of the plan the stack follows in every evaluation
+    Idx plan;
+    //! maximal number of elements on the stack during computeFinalStack
+    Idx max_stack;
+    //! hash of the operator sequence without variables and constants, 0 if
+    //the constraint has no tape
+    size_t shape;
+};
+
 class ConstraintInterface{
 public:
   virtual ~ConstraintInterface() {}
@@ -37,10 +59,41 @@ public:
     virtual void ub(double v) = 0;
     virtual Idx getNNZ_Jac() = 0;
     virtual void getNZ_Jac(unsigned int* jCol) = 0;
+    //! adds the hessian entries of the constraint to hess, called when the
+    //constraint is added to a model
+    virtual void setHessStructure(HessStructure& hess){}
+    //! replaces the ids of the hessian entries by their positions, perm is
+    //the result of HessStructure::compress()
+    virtual void remapHess(const vector<Idx>& perm){}
+    //! frees memory that is only needed while the constraint is added,
+    //\sa Model::finalize()
+    virtual void finalize(){}
+    //! evaluates the constraint at the x of the stack, values, jacobian
+    //and hessian
     virtual void setEvals(CStack&){}
+    //! evaluates the constraint at the x of the stack, at least up to level,
+    //the default evaluates everything with setEvals(CStack&)
+    virtual void setEvals(CStack& stack, EvalLevel level){ setEvals(stack); }
     virtual const double& getG()const = 0;
-    virtual const vector<double>& getJac()const = 0;
+    //! the jacobian values in the order of getNZ_Jac(), custom constraints
+    //implement it, the built-in ones getJacValues()
+    virtual const vector<double>& getJac()const {
+        throw MadOptError("constraint does not implement getJac()");
+    }
+    //! the getNNZ_Jac() jacobian values, the default reads getJac()
+    virtual const double* getJacValues()const { return getJac().data(); }
     virtual void eval_h(double* values, const double& lambda) = 0;
+    //! adds the memory of the constraint to report, the default only counts
+    //the constraint since its size is unknown
+    virtual void addMemory(MemoryReport& report)const {
+        report.add("custom constraint", 0);
+    }
+    //! description used by the profiler, the default only knows the jacobian
+    virtual TapeInfo tapeInfo(){
+        TapeInfo info;
+        info.jac_nnz = getNNZ_Jac();
+        return info;
+    }
 };
 }
 #endif
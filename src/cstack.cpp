@@ -16,89 +16,128 @@
 
 #include "cstack.hpp"
 #include "simstack.hpp"
+#include "vstack.hpp"
 #include "logger.hpp"
 
 namespace MadOpt {
 
-void CStack::doAdd(const Idx& nofelems){
+template<EvalLevel level>
+void CStack::mulFactors(const Idx& nofelems){
     TRACE_START;
-    ASSERT_LE(nofelems, size());
     ASSERT_LE(nofelems, g_stack.size());
-    ASSERT_LE(2, nofelems);
-
-    jac_stack.merge(nofelems);
-    hess_stack.merge(nofelems);
-    double& goal = g_stack.back(nofelems);
-    for (Idx i=0; i<nofelems-1; i++)
-        goal += g_stack.pop();
-}
-
-void CStack::doMull(){
-    TRACE_START;
-    ASSERT_LE(2, g_stack.size());
-
-    double& last = g_stack.pop();
-    double& prev = g_stack.back();
-    TRACE("last=", last, "prev=", prev);
-    hess_stack.mulAllLast(prev);
-    hess_stack.mulAllPrev(last);
-
-    const auto& stack = jac_stack.getStack();
-    const auto& pos = jac_stack.getPos();
-    for (Idx i=pos.back(1); i<stack.size(); i++)
-        for (Idx k=pos.back(2); k<pos.back(1); k++){
-            TRACE(i, k);
-            hess_stack.push(stack[i]*stack[k]);
+    const double* factors = &g_stack.back(nofelems);
+    const Idx last = nofelems-1;
+    prefix[0] = 1;
+    for (Idx i=1; i<nofelems; i++)
+        prefix[i] = prefix[i-1]*factors[i-1];
+    if (level >= EVAL_JAC){
+        suffix[last] = 1;
+        for (Idx i=last; i>0; i--)
+            suffix[i-1] = suffix[i]*factors[i];
+    }
+    if (level >= EVAL_HESS){
+        // linear factors, like variables, have no hessian entries
+        if (hess_stack.getPos().back(nofelems) != hess_stack.getStack().size())
+            for (Idx l=0; l<nofelems; l++)
+                hess_stack.mulList(nofelems-l, prefix[l]*suffix[l]);
+        pushPairs(nofelems, factors);
+        hess_stack.merge(nofelems);
+    }
+    if (level >= EVAL_JAC){
+        auto& stack = jac_stack.getStack();
+        const Idx* first = &jac_stack.getPos().back(nofelems);
+        for (Idx l=0; l<nofelems; l++){
+            const double value = prefix[l]*suffix[l];
+            const Idx end = l == last ? stack.size() : first[l+1];
+            for (Idx i=first[l]; i<end; i++)
+                stack[i] *= value;
         }
-
-    TRACE("conf elems", conflicts->str());
-    Idx& counter = conflicts->next();
-    for (Idx i=0; i<counter; i++){
-        TRACE("sol 00 conf", conflicts->current());
-        hess_stack.getStack()[conflicts->next()] *= 2;
+        jac_stack.merge(nofelems);
     }
-
-    hess_stack.merge(2);
-
-    jac_stack.mulAllLast(prev);
-    jac_stack.mulAllPrev(last);
-    jac_stack.merge(2);
-    prev *= last;
+    const double res = prefix[last]*factors[last];
+    g_stack.pop(last);
+    g_stack.back() = res;
     TRACE_END;
 }
 
-double& CStack::lastG(){
-    TRACE_START;
-    return g_stack.back();
+double CStack::pairFactor(const double* factors, const Idx& e, const Idx& l)const{
+    double mid = 1;
+    for (Idx i=l-1; i>e; i--)
+        mid *= factors[i];
+    return prefix[e]*mid*suffix[l];
 }
 
-void CStack::doUnaryOp(const double& jac_value, const double& hess_value){
-    TRACE_START;
-    hess_stack.mulAllLast(jac_value);
+template<bool in_place>
+void CStack::addPairs(const Idx& nofelems, const double* factors, const bool& singles){
     const auto& stack = jac_stack.getStack();
-    const auto& pos = jac_stack.getPos();
-    hess_stack.emplace_back_empty();
-    for (Idx i=pos.back(); i<stack.size(); i++)
-        for (Idx k=i; k<stack.size(); k++)
-            hess_stack.push(stack[i]*stack[k]*hess_value);
-    hess_stack.merge(2);
-    jac_stack.mulAllLast(jac_value);
-    TRACE_END;
+    const Idx* first = &jac_stack.getPos().back(nofelems);
+    if (singles){
+        // every list has one element, the lists are the elements
+        const double* jac = &stack[first[0]];
+        for (Idx l=1; l<nofelems; l++){
+            double mid = 1;
+            for (Idx e=l; e-- > 0;){
+                const double value = prefix[e]*mid*suffix[l];
+                mid *= factors[e];
+                if (in_place)
+                    hess_stack.push(jac[l]*jac[e]*value);
+                else
+                    hess_stack.scatter(jac[l]*jac[e]*value);
+            }
+        }
+        return;
+    }
+    for (Idx l=1; l<nofelems; l++){
+        const Idx l_end = l+1 == nofelems ? stack.size() : first[l+1];
+        // the product of the factors between e and l, \sa pairFactor()
+        double mid = 1;
+        for (Idx e=l; e-- > 0;){
+            const double value = prefix[e]*mid*suffix[l];
+            mid *= factors[e];
+            for (Idx i=first[l]; i<l_end; i++)
+                for (Idx k=first[e]; k<first[e+1]; k++){
+                    if (in_place)
+                        hess_stack.push(stack[i]*stack[k]*value);
+                    else
+                        hess_stack.scatter(stack[i]*stack[k]*value);
+                }
+        }
+    }
 }
 
-void CStack::emplace_back(const Idx& id){
-    TRACE_START;
-    g_stack.pushSave(x[id]);
-    jac_stack.emplace_back(1);
-    hess_stack.emplace_back_empty();
+void CStack::pushPairs(const Idx& nofelems, const double* factors){
+    const auto& stack = jac_stack.getStack();
+    const Idx* first = &jac_stack.getPos().back(nofelems);
+    Idx nof_products = 0;
+    Idx nof_before = 0;
+    bool singles = true;
+    for (Idx l=0; l<nofelems; l++){
+        const Idx n = (l+1 == nofelems ? stack.size() : first[l+1]) - first[l];
+        nof_products += n*nof_before;
+        nof_before += n;
+        singles &= n == 1;
+    }
+    if (!nof_products)
+        return;
+    if (hess_stack.beginProducts(nof_products))
+        addPairs<true>(nofelems, factors, singles);
+    else
+        addPairs<false>(nofelems, factors, singles);
+    // the lists of jacobian positions a and b
+    hess_stack.addDoubled(stack, [&](const Idx& a, const Idx& b){
+        Idx l = nofelems-1;
+        while (first[l] > a)
+            l--;
+        Idx e = l-1;
+        while (first[e] > b)
+            e--;
+        return pairFactor(factors, e, l);
+    });
 }
 
-void CStack::emplace_back(const double& value){
-    TRACE_START;
-    g_stack.pushSave(value);
-    jac_stack.emplace_back_empty();
-    hess_stack.emplace_back_empty();
-}
+template void CStack::mulFactors<EVAL_VALUE>(const Idx&);
+template void CStack::mulFactors<EVAL_JAC>(const Idx&);
+template void CStack::mulFactors<EVAL_HESS>(const Idx&);
 
 void CStack::clear(){
     g_stack.clear();
@@ -107,43 +146,49 @@ void CStack::clear(){
     data_i = 0;
 }
 
-void CStack::fill(double& g, double* jac, double* hess){
-    //ASSERT_XOR(jac != nullptr, jac_stack.stackSize() > 0);
-    //ASSERT_XOR(hess != nullptr, hess_stack.stackSize() > 0);
-    g = g_stack.back();
-    jac_stack.fill(jac);
-    hess_stack.fill(hess);
-}
-
 void CStack::resize(const SimStack& simstack){
     TRACE_START;
     TRACE("simstack sizes=",
             simstack.max_g_size(), 
             simstack.max_jac_size(), 
             simstack.max_hess_size());
-    g_stack.resize(simstack.max_g_size());
+    g_stack.grow(simstack.max_g_size());
+    prefix.grow(simstack.max_g_size());
+    suffix.grow(simstack.max_g_size());
     jac_stack.resize(simstack.max_jac_size(), simstack.max_g_size());
     hess_stack.resize(simstack.max_hess_size(), simstack.max_g_size()+1);
     TRACE_END;
 }
 
-Idx CStack::size(){
-    return g_stack.size();
+void CStack::setPlan(Array<Idx>* jac_plan, Array<Idx>* hess_plan){
+    jac_plan->reset();
+    hess_plan->reset();
+    jac_stack.setPlan(jac_plan);
+    hess_stack.setPlan(hess_plan);
 }
 
-void CStack::setConflicts(Array<Idx>* conflicts){
-    conflicts->reset();
-    jac_stack.setConflicts(conflicts);
-    hess_stack.setConflicts(conflicts);
-    this->conflicts = conflicts;
+void CStack::setX(const double* xx, const Idx& size){
+    x = xx;
+    x_size = size;
+    eval_id++;
 }
 
-void CStack::setX(const double* xx){
-    x = xx;
+void CStack::setEngine(Engine engine, const HessStructure* structure){
+    if (engine == ENGINE_PLAN){
+        one_pass.reset();
+        return;
+    }
+    if (!one_pass)
+        one_pass.reset(new VStack());
+    one_pass->setStructure(structure);
 }
 
-Idx& CStack::getDataI(){
-    return data_i;
+std::size_t CStack::bytes()const{
+    std::size_t res = g_stack.bytes() + jac_stack.bytes() + hess_stack.bytes()
+        + prefix.bytes() + suffix.bytes();
+    if (one_pass)
+        res += one_pass->bytes();
+    return res;
 }
 
 }
@@ -19,43 +19,321 @@
 #include "stack.hpp"
 #include "array.hpp"
 #include "list_cstack.hpp"
+#include "logger.hpp"
 
 namespace MadOpt {
 
 class SimStack;
+class VStack;
+class HessStructure;
 
-class CStack: public Stack {
+//! numeric stack of the constraint evaluation, the operations compute up to
+//the given level, \sa CSweep
+class CStack {
     public:
-	CStack(): data_i(0){}
+	CStack(): x(nullptr), x_size(0), eval_id(0), data_i(0){}
 
-        void doAdd(const Idx& nofelems);
-        void doMull(); 
+        template<EvalLevel level> void doAdd(const Idx& nofelems);
+        template<EvalLevel level> void doMull();
+        /*! \brief product of the last nofelems elements
+         * \details every factor is multiplied with the product of the
+         * others and every pair of factors with the product of the rest,
+         * these are products of prefixes and suffixes, hence exact for
+         * zero factors
+         */
+        template<EvalLevel level> void doMul(const Idx& nofelems);
         double& lastG();
+        template<EvalLevel level>
         void doUnaryOp(const double& jac_value, const double& hess_value);
-        void emplace_back(const Idx& id);
-        void emplace_back(const double& value);
+        //! divides the previous element by the last one
+        template<EvalLevel level> void doDiv();
+        //! multiplies the derivatives of the last element with factor, the
+        //derivatives of a linear unary operator
+        template<EvalLevel level> void doScale(const double& factor);
+        template<EvalLevel level> void emplace_back(const Idx& id);
+        template<EvalLevel level> void emplace_back(const double& value);
         void clear();
-        Idx size();
+        Idx size(){ return g_stack.size(); }
 
-        void setConflicts(Array<Idx>* conflicts);
+        //! the evaluation plans of the constraint, \sa ListSimStack::merge()
+        void setPlan(Array<Idx>* jac_plan, Array<Idx>* hess_plan);
 
-        void fill(double& g, double* jac, double* hess);
+        //! copies the results, jac and hess are only written if level
+        //includes them
+        template<EvalLevel level> void fill(double& g, double* jac, double* hess);
 
+        //! reserves the maximal stack sizes seen by simstack, the
+        //evaluation itself never allocates
         void resize(const SimStack& simstack);
 
-        void setX(const double* xx);
+        void setX(const double* xx, const Idx& size=0);
 
-        Idx& getDataI();
+        //! same x values at another address, keeps the eval id
+        void rebindX(const double* xx){ x = xx; }
+
+        const double* getX()const { return x; }
+
+        Idx getXSize()const { return x_size; }
+
+        //! changes with every setX(), constraints that share one evaluation
+        //use it to detect a new x
+        unsigned long getEvalId()const { return eval_id; }
+
+        Idx& getDataI(){ return data_i; }
+
+        /*! \brief selects the engine that evaluates the derivatives
+         * @param structure the compressed hessian structure, needed by
+         * ENGINE_ONE_PASS to align its entries, \sa VStack::setStructure()
+         */
+        void setEngine(Engine engine, const HessStructure* structure=NULL);
+
+        Engine getEngine()const { return one_pass ? ENGINE_ONE_PASS : ENGINE_PLAN; }
+
+        //! the stack of ENGINE_ONE_PASS
+        VStack& getVStack(){ return *one_pass; }
+
+        //! allocated heap memory
+        std::size_t bytes()const;
 
     private:
         Array<double> g_stack;
         ListCStack jac_stack;
         ListCStack hess_stack;
-        Array<Idx>* conflicts;
         const double* x;
+        Idx x_size;
+        unsigned long eval_id;
         Idx data_i;
+        //! only allocated for ENGINE_ONE_PASS
+        shared_ptr<VStack> one_pass;
+        //! products of the factors before and after each factor of doMul()
+        Array<double> prefix;
+        Array<double> suffix;
+
+        //! the products of the last jacobian list with itself times value,
+        //the new hessian entries of a unary operator
+        inline void pushSquares(const double& value);
+
+        //! the products of the last two jacobian lists times value, the new
+        //hessian entries of a product
+        inline void pushCross(const double& value);
+
+        //! doMul() of more than two factors, out of line to keep the
+        //interpreter small for the binary products
+        template<EvalLevel level> void mulFactors(const Idx& nofelems);
+
+        //! the products of every pair of the last nofelems jacobian lists
+        //times the product of the other factors, \sa HessSimStack::setJacs()
+        void pushPairs(const Idx& nofelems, const double* factors);
+        template<bool in_place>
+        void addPairs(const Idx& nofelems, const double* factors,
+                const bool& singles);
+
+        //! the product of the factors other than e and l
+        double pairFactor(const double* factors, const Idx& e,
+                const Idx& l)const;
 };
+
+/*! \brief a CStack that evaluates up to level, the stack type of the
+ * numeric instantiations of InnerConstraint::computeFinalStack()
+ * \details level is a compile time constant, hence each instantiation of
+ * the interpreter only contains the work of its level
+ */
+template<EvalLevel L>
+class CSweep {
+    public:
+        static const EvalLevel level = L;
+
+        CSweep(CStack& stack): stack(stack){}
+
+        void doAdd(const Idx& nofelems){ stack.doAdd<L>(nofelems); }
+        void doMull(){ stack.doMull<L>(); }
+        void doMul(const Idx& nofelems){ stack.doMul<L>(nofelems); }
+        double& lastG(){ return stack.lastG(); }
+        void doUnaryOp(const double& jac_value, const double& hess_value){
+            stack.doUnaryOp<L>(jac_value, hess_value);
+        }
+        void doDiv(){ stack.doDiv<L>(); }
+        void doScale(const double& factor){ stack.doScale<L>(factor); }
+        void emplace_back(const Idx& id){ stack.emplace_back<L>(id); }
+        void emplace_back(const double& value){ stack.emplace_back<L>(value); }
+        Idx size(){ return stack.size(); }
+        Idx& getDataI(){ return stack.getDataI(); }
+        void fill(double& g, double* jac, double* hess){
+            stack.fill<L>(g, jac, hess);
+        }
+
+    private:
+        CStack& stack;
+};
+
+template<EvalLevel level>
+inline void CStack::doAdd(const Idx& nofelems){
+    TRACE_START;
+    ASSERT_LE(nofelems, size());
+    ASSERT_LE(nofelems, g_stack.size());
+    ASSERT_LE(2, nofelems);
+
+    if (level >= EVAL_JAC)
+        jac_stack.merge(nofelems);
+    if (level >= EVAL_HESS)
+        hess_stack.merge(nofelems);
+    double& goal = g_stack.back(nofelems);
+    for (Idx i=0; i<nofelems-1; i++)
+        goal += g_stack.pop();
 }
-#endif
 
+template<EvalLevel level>
+inline void CStack::doMull(){
+    TRACE_START;
+    ASSERT_LE(2, g_stack.size());
+
+    double& last = g_stack.pop();
+    double& prev = g_stack.back();
+    TRACE("last=", last, "prev=", prev);
+    if (level >= EVAL_HESS){
+        hess_stack.mulAllLast(prev);
+        hess_stack.mulAllPrev(last);
+        pushCross(1);
+        hess_stack.merge(2);
+    }
 
+    if (level >= EVAL_JAC){
+        jac_stack.mulAllLast(prev);
+        jac_stack.mulAllPrev(last);
+        jac_stack.merge(2);
+    }
+    prev *= last;
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void CStack::doMul(const Idx& nofelems){
+    if (nofelems == 2)
+        doMull<level>();
+    else
+        mulFactors<level>(nofelems);
+}
+
+inline double& CStack::lastG(){
+    TRACE_START;
+    return g_stack.back();
+}
+
+template<EvalLevel level>
+inline void CStack::doUnaryOp(const double& jac_value, const double& hess_value){
+    TRACE_START;
+    if (level >= EVAL_HESS){
+        hess_stack.mulAllLast(jac_value);
+        hess_stack.emplace_back_empty();
+        pushSquares(hess_value);
+        hess_stack.merge(2);
+    }
+    if (level >= EVAL_JAC)
+        jac_stack.mulAllLast(jac_value);
+    TRACE_END;
+}
+
+// u/v replays the merges of pow(v, -1) and of the product, \sa
+// SimStack::doDiv(), but scales every list once
+template<EvalLevel level>
+inline void CStack::doDiv(){
+    TRACE_START;
+    ASSERT_LE(2, g_stack.size());
+
+    const double& last = g_stack.pop();
+    double& prev = g_stack.back();
+    const double inv = 1/last;
+    const double res = prev/last;
+    if (level >= EVAL_HESS){
+        // d/dv = -u/v^2, d2/dv2 = 2u/v^3, d2/dudv = -1/v^2
+        hess_stack.mulAllLast(-res*inv);
+        hess_stack.emplace_back_empty();
+        pushSquares(2*res*inv*inv);
+        hess_stack.merge(2);
+        hess_stack.mulAllPrev(inv);
+        pushCross(-inv*inv);
+        hess_stack.merge(2);
+    }
+    if (level >= EVAL_JAC){
+        jac_stack.mulAllLast(-res*inv);
+        jac_stack.mulAllPrev(inv);
+        jac_stack.merge(2);
+    }
+    prev = res;
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void CStack::doScale(const double& factor){
+    if (level >= EVAL_HESS)
+        hess_stack.mulAllLast(factor);
+    if (level >= EVAL_JAC)
+        jac_stack.mulAllLast(factor);
+}
+
+inline void CStack::pushSquares(const double& value){
+    const auto& stack = jac_stack.getStack();
+    const auto& pos = jac_stack.getPos();
+    const Idx n = stack.size()-pos.back();
+    if (!n)
+        return;
+    if (hess_stack.beginProducts(n*(n+1)/2)){
+        for (Idx i=pos.back(); i<stack.size(); i++)
+            for (Idx k=i; k<stack.size(); k++)
+                hess_stack.push(stack[i]*stack[k]*value);
+    } else {
+        for (Idx i=pos.back(); i<stack.size(); i++)
+            for (Idx k=i; k<stack.size(); k++)
+                hess_stack.scatter(stack[i]*stack[k]*value);
+    }
+}
+
+inline void CStack::pushCross(const double& value){
+    const auto& stack = jac_stack.getStack();
+    const auto& pos = jac_stack.getPos();
+    const Idx nof_products = (stack.size()-pos.back(1))*(pos.back(1)-pos.back(2));
+    if (!nof_products)
+        return;
+    if (hess_stack.beginProducts(nof_products)){
+        for (Idx i=pos.back(1); i<stack.size(); i++)
+            for (Idx k=pos.back(2); k<pos.back(1); k++)
+                hess_stack.push(stack[i]*stack[k]*value);
+    } else {
+        for (Idx i=pos.back(1); i<stack.size(); i++)
+            for (Idx k=pos.back(2); k<pos.back(1); k++)
+                hess_stack.scatter(stack[i]*stack[k]*value);
+    }
+    hess_stack.addDoubled(stack, [&value](const Idx&, const Idx&){ return value; });
+}
+
+template<EvalLevel level>
+inline void CStack::emplace_back(const Idx& id){
+    TRACE_START;
+    g_stack.pushSave(x[id]);
+    if (level >= EVAL_JAC)
+        jac_stack.emplace_back(1);
+    if (level >= EVAL_HESS)
+        hess_stack.emplace_back_empty();
+}
+
+template<EvalLevel level>
+inline void CStack::emplace_back(const double& value){
+    TRACE_START;
+    g_stack.pushSave(value);
+    if (level >= EVAL_JAC)
+        jac_stack.emplace_back_empty();
+    if (level >= EVAL_HESS)
+        hess_stack.emplace_back_empty();
+}
+
+template<EvalLevel level>
+inline void CStack::fill(double& g, double* jac, double* hess){
+    g = g_stack.back();
+    if (level >= EVAL_JAC)
+        jac_stack.fill(jac);
+    if (level >= EVAL_HESS)
+        hess_stack.fill(hess);
+}
+
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "expr_array.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+static void checkSize(const vector<Expr>& a, const vector<Expr>& b){
+    if (a.size() != b.size())
+        throw MadOptError("expression arrays differ in size "
+                + std::to_string((long long int)a.size()) + " != "
+                + std::to_string((long long int)b.size()));
+}
+
+template<class F>
+static vector<Expr> apply(const vector<Expr>& a, F f){
+    vector<Expr> res;
+    res.reserve(a.size());
+    FOREACH(e, a)
+    //for (auto& e: a){
+        res.push_back(f(e));
+    }
+    return res;
+}
+
+Expr sum(const vector<Expr>& a){
+    Expr res(0);
+    FOREACH(e, a)
+    //for (auto& e: a){
+        res += e;
+    }
+    return res;
+}
+
+Expr dot(const double* c, const vector<Expr>& a){
+    Expr res(0);
+    for (Idx i=0; i<a.size(); i++)
+        if (c[i] != 0)
+            res += c[i]*a[i];
+    return res;
+}
+
+Expr sumsq(const vector<Expr>& a){
+    Expr res(0);
+    FOREACH(e, a)
+    //for (auto& e: a){
+        res += pow(e, 2);
+    }
+    return res;
+}
+
+vector<Expr> add(const vector<Expr>& a, const vector<Expr>& b){
+    checkSize(a, b);
+    vector<Expr> res;
+    res.reserve(a.size());
+    for (Idx i=0; i<a.size(); i++)
+        res.push_back(a[i] + b[i]);
+    return res;
+}
+
+vector<Expr> add(const vector<Expr>& a, const double* b){
+    vector<Expr> res;
+    res.reserve(a.size());
+    for (Idx i=0; i<a.size(); i++)
+        res.push_back(a[i] + b[i]);
+    return res;
+}
+
+vector<Expr> mul(const vector<Expr>& a, const vector<Expr>& b){
+    checkSize(a, b);
+    vector<Expr> res;
+    res.reserve(a.size());
+    for (Idx i=0; i<a.size(); i++)
+        res.push_back(a[i] * b[i]);
+    return res;
+}
+
+vector<Expr> mul(const vector<Expr>& a, const double* b){
+    vector<Expr> res;
+    res.reserve(a.size());
+    for (Idx i=0; i<a.size(); i++)
+        res.push_back(b[i] * a[i]);
+    return res;
+}
+
+vector<Expr> div(const vector<Expr>& a, const vector<Expr>& b){
+    checkSize(a, b);
+    vector<Expr> res;
+    res.reserve(a.size());
+    for (Idx i=0; i<a.size(); i++)
+        res.push_back(a[i] / b[i]);
+    return res;
+}
+
+vector<Expr> pow(const vector<Expr>& a, const double& b){
+    return apply(a, [&b](const Expr& e){ return pow(e, b); });
+}
+
+vector<Expr> sin(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return sin(e); });
+}
+
+vector<Expr> cos(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return cos(e); });
+}
+
+vector<Expr> tan(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return tan(e); });
+}
+
+vector<Expr> sqrt(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return sqrt(e); });
+}
+
+vector<Expr> ln(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return ln(e); });
+}
+
+vector<Expr> log2(const vector<Expr>& a){
+    return apply(a, [](const Expr& e){ return log2(e); });
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
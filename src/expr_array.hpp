@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_EXPR_ARRAY_H
+#define MADOPT_EXPR_ARRAY_H
+
+#include "expr.hpp"
+
+//! builders that work on whole arrays of expressions, they are used by the
+//python interface to construct models with one call per array instead of
+//one call per operator
+namespace MadOpt {
+
+//! sum of all expressions
+Expr sum(const vector<Expr>& a);
+
+//! sum of c[i]*a[i], c has a.size() entries
+Expr dot(const double* c, const vector<Expr>& a);
+
+//! sum of a[i]^2
+Expr sumsq(const vector<Expr>& a);
+
+//! elementwise a[i] + b[i]
+vector<Expr> add(const vector<Expr>& a, const vector<Expr>& b);
+
+//! elementwise a[i] + b[i], b has a.size() entries
+vector<Expr> add(const vector<Expr>& a, const double* b);
+
+//! elementwise a[i] * b[i]
+vector<Expr> mul(const vector<Expr>& a, const vector<Expr>& b);
+
+//! elementwise a[i] * b[i], b has a.size() entries
+vector<Expr> mul(const vector<Expr>& a, const double* b);
+
+//! elementwise a[i] / b[i]
+vector<Expr> div(const vector<Expr>& a, const vector<Expr>& b);
+
+//! elementwise a[i]^b
+vector<Expr> pow(const vector<Expr>& a, const double& b);
+
+//! elementwise sin
+vector<Expr> sin(const vector<Expr>& a);
+
+//! elementwise cos
+vector<Expr> cos(const vector<Expr>& a);
+
+//! elementwise tan
+vector<Expr> tan(const vector<Expr>& a);
+
+//! elementwise sqrt
+vector<Expr> sqrt(const vector<Expr>& a);
+
+//! elementwise ln
+vector<Expr> ln(const vector<Expr>& a);
+
+//! elementwise log2
+vector<Expr> log2(const vector<Expr>& a);
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
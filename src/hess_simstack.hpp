@@ -28,30 +28,37 @@ namespace MadOpt {
 class HessSimStack : public ListSimStack<PII> {
     public:
 
-        void setJac(const JacSimStack& jac){
+        /*! \brief pushes the products of every pair of the last nofelems
+         * jacobian lists
+         * \details the later list of a pair is the outer loop, for each of
+         * them the earlier lists follow from the nearest to the first,
+         * \sa CStack::doMul()
+         */
+        void setJacs(const JacSimStack& jac, const Idx& nofelems){
             TRACE_START;
             ASSERT_LE(positions.back(), stack.size());
-            Idx conflict_counter_pos = conflicts->getEndPosAndPush();
-            (*conflicts)[conflict_counter_pos] = 0;
+            ASSERT_EQ(products, 0);
             const auto& jac_stack = jac.getStack();
             const auto& pos = jac.getPos();
-            ASSERT_BETWEEN(pos.back(2), pos.back(1), jac_stack.size(),
-                    pos.back(2), pos.back(1), jac_stack.size() );
-            for (Idx i=pos.back(1); i<jac_stack.size(); i++){
-                const auto& elem2 = jac_stack[i];
-                for (Idx k=pos.back(2); k<pos.back(); k++){
-                    const auto& elem1 = jac_stack[k];
-                    if (elem1.id == elem2.id){
-                        (*conflicts)[conflict_counter_pos]++;
-                        conflicts->push(stack.size());
-                        ASSERT_LE(1, stack.size());
-                        ASSERT_LE(1, (*conflicts)[conflict_counter_pos]);
-                        TRACE("ins 00 conf", 
-                                (*conflicts)[conflict_counter_pos], stack.size(),
-                                conflicts->size());
+            ASSERT_LE(nofelems, pos.size());
+            for (Idx l=1; l<nofelems; l++){
+                const Idx l_end = l+1 == nofelems ? jac_stack.size() : pos.back(nofelems-l-1);
+                for (Idx e=l; e-- > 0;){
+                    for (Idx i=pos.back(nofelems-l); i<l_end; i++){
+                        const auto& elem2 = jac_stack[i];
+                        for (Idx k=pos.back(nofelems-e); k<pos.back(nofelems-e-1); k++){
+                            const auto& elem1 = jac_stack[k];
+                            if (elem1.id == elem2.id){
+                                doubled.push_back(i);
+                                doubled.push_back(k);
+                                doubled.push_back(stack.size());
+                                TRACE("ins 00 conf", i, k, stack.size());
+                            }
+                            TRACE("push new elem", i, k, elem1.id, elem2.id);
+                            push(uPII(elem1.id, elem2.id));
+                            products++;
+                        }
                     }
-                    TRACE("push new elem", i, k, elem1.id, elem2.id);
-                    push(uPII(elem1.id, elem2.id));
                 }
             }
             TRACE_END;
@@ -60,16 +67,23 @@ class HessSimStack : public ListSimStack<PII> {
         void setSingleJac(const JacSimStack& jac){
             TRACE_START;
             ASSERT_LE(positions.back(), stack.size());
+            ASSERT_EQ(products, 0);
             const auto& jac_stack = jac.getStack();
             for (Idx i=jac.getPos().back(); i<jac_stack.size(); i++)
-                for (Idx k=i; k<jac_stack.size(); k++)
+                for (Idx k=i; k<jac_stack.size(); k++){
                     push(uPII(jac_stack[i].id, jac_stack[k].id));
+                    products++;
+                }
             TRACE(str());
             TRACE_END;
         }
 
-        void setXSize(const Idx& size){
-            last_pos_map.resize(size);
+        //! the map grows with the entries and does not depend on the number
+        //of variables
+        void setXSize(const Idx& size){}
+
+        std::size_t bytes()const {
+            return ListSimStack<PII>::bytes() + last_pos_map.bytes();
         }
         
         string str(){
@@ -90,8 +104,7 @@ class HessSimStack : public ListSimStack<PII> {
             TRACE_START;
             TRACE(str());
             TRACE(last_pos_map.str());
-            for (Idx i=1; i<stack.size(); i++)
-                last_pos_map[stack[i].id] = 0;
+            last_pos_map.clear();
             TRACE_END;
         }
 
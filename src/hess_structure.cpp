@@ -0,0 +1,125 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdint>
+#include "hess_structure.hpp"
+#include "memory_report.hpp"
+#include "logger.hpp"
+
+namespace MadOpt {
+
+static uint64_t toKey(Idx row, Idx col){
+    return (uint64_t(row) << 32) | col;
+}
+
+Idx HessStructure::add(const PII& p){
+    pending.push_back(PII(std::max(p.first, p.second), std::min(p.first, p.second)));
+    return _rows.size() + pending.size() - 1;
+}
+
+Idx HessStructure::find(const PII& p)const{
+    const uint64_t key = toKey(std::max(p.first, p.second), std::min(p.first, p.second));
+    // binary search, the entries are sorted row-major
+    Idx lo = 0;
+    Idx hi = _rows.size();
+    while (lo < hi){
+        const Idx mid = lo + (hi-lo)/2;
+        if (toKey(_rows[mid], _cols[mid]) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < _rows.size() && toKey(_rows[lo], _cols[lo]) == key)
+        return lo;
+    return _rows.size();
+}
+
+void HessStructure::compress(vector<Idx>& perm){
+    const Idx old_size = _rows.size();
+    perm.resize(old_size + pending.size());
+    if (pending.empty()){
+        for (Idx i=0; i<old_size; i++)
+            perm[i] = i;
+        return;
+    }
+
+    // counting sort by row, the rows are bounded by the number of variables
+    // and only have a few entries each
+    Idx max_row = 0;
+    FOREACH(p, pending)
+    //for (auto& p: pending){
+        max_row = std::max(max_row, p.first);
+    }
+    vector<Idx> begin(max_row+2, 0);
+    FOREACH(p, pending)
+    //for (auto& p: pending){
+        begin[p.first+1]++;
+    }
+    for (Idx r=1; r<begin.size(); r++)
+        begin[r] += begin[r-1];
+    vector<pair<uint64_t, Idx>> added(pending.size());
+    for (Idx k=0; k<pending.size(); k++)
+        added[begin[pending[k].first]++] = std::make_pair(
+                toKey(pending[k].first, pending[k].second), old_size + k);
+    Idx row_begin = 0;
+    for (Idx r=0; r<=max_row; r++){
+        // begin[r] is the end of row r now
+        std::sort(added.begin() + row_begin, added.begin() + begin[r]);
+        row_begin = begin[r];
+    }
+
+    // merge the sorted new entries with the structure
+    vector<int> rows;
+    vector<int> cols;
+    rows.reserve(old_size + added.size());
+    cols.reserve(old_size + added.size());
+    Idx i = 0;
+    Idx k = 0;
+    while (i < old_size || k < added.size()){
+        uint64_t key;
+        Idx id;
+        if (k == added.size() || (i < old_size
+                    && toKey(_rows[i], _cols[i]) <= added[k].first)){
+            key = toKey(_rows[i], _cols[i]);
+            id = i++;
+        } else {
+            key = added[k].first;
+            id = added[k++].second;
+        }
+        if (rows.empty() || toKey(rows.back(), cols.back()) != key){
+            rows.push_back(key >> 32);
+            cols.push_back(Idx(key));
+        }
+        perm[id] = rows.size()-1;
+    }
+    ASSERT_LE(rows.size(), perm.size());
+    _rows.swap(rows);
+    _cols.swap(cols);
+    vector<PII>().swap(pending);
+}
+
+void HessStructure::shrink(){
+    _rows.shrink_to_fit();
+    _cols.shrink_to_fit();
+    pending.shrink_to_fit();
+}
+
+std::size_t HessStructure::bytes()const{
+    return heapBytes(_rows) + heapBytes(_cols) + heapBytes(pending);
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_HESS_STRUCTURE_H
+#define MADOPT_HESS_STRUCTURE_H
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+/*! \brief structure of the hessian of the lagrangian as sorted, deduplicated
+ * lower triangle in row-major order
+ * \details the constraints add their entries while they are built and keep
+ * the returned ids, compress() sorts the new entries into the structure and
+ * returns the position of every id, the positions of a compressed structure
+ * are valid ids as well
+ */
+class HessStructure {
+    public:
+        //! adds the entry (i, j) or (j, i), returns its id until the next
+        //compress()
+        Idx add(const PII& p);
+
+        //! true if no entries were added since the last compress()
+        bool compressed()const { return pending.empty(); }
+
+        /*! \brief merges the added entries into the structure
+         * @param[out] perm position of every id
+         */
+        void compress(vector<Idx>& perm);
+
+        //! position of the entry (i, j) or (j, i), size() if it is not in
+        //the structure, only valid if compressed()
+        Idx find(const PII& p)const;
+
+        //! number of entries, only valid if compressed()
+        Idx size()const { return _rows.size(); }
+
+        //! row of every position, the larger index
+        const vector<int>& rows()const { return _rows; }
+
+        //! column of every position, the smaller index
+        const vector<int>& cols()const { return _cols; }
+
+        //! frees the unused capacity
+        void shrink();
+
+        //! allocated heap memory
+        std::size_t bytes()const;
+
+    private:
+        vector<int> _rows;
+        vector<int> _cols;
+        //! entries added since the last compress(), (row, col)
+        vector<PII> pending;
+};
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
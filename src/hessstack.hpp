@@ -22,7 +22,9 @@
 
 #include "common.hpp"
 #include "liststack.hpp"
+#include "jacstack.hpp"
 #include "pairhashmap.hpp"
+#include "logger.hpp"
 
 namespace MadOpt {
 
@@ -30,26 +32,111 @@ using namespace std;
 
 typedef pair<Idx, Idx> HessPair;
 
-class JacStack;
-
-class HessStack : public ListStack<HessPair> {
+class HessStack final : public ListStack<HessPair> {
     public:
-        void mergeJacInto(JacStack& other);
+        //! adds the products of the last two jacobian segments times value
+        void mergeJacInto(JacStack& other, const double& value){
+            auto& other_stack = other.getStack();
+
+            for (Idx i=other.getPrev(); i<other.getLast(); i++){
+                auto& elem2 = other_stack[i];
+                for (Idx k=other.getLast(); k<other.getEnd(); k++){
+                    auto& elem1 = other_stack[k];
+
+                    double v = elem1.value * elem2.value * value;
+                    if (elem1.id == elem2.id)
+                        v *= 2;
+                    insertOrUpdatePair(elem1.id, elem2.id, v);
+                }
+            }
+        }
+
+        /*! \brief adds the products of every pair of the last nofelems
+         * jacobian segments, times the product of the other factors
+         * @param prefix @param suffix the products of the factors before
+         * and after each one, \sa VStack::doMul()
+         */
+        void mergeJacsInto(JacStack& other, const Idx& nofelems,
+                const double* factors, const double* prefix, const double* suffix){
+            auto& other_stack = other.getStack();
+
+            for (Idx l=1; l<nofelems; l++){
+                const Idx l_end = l+1 == nofelems ? other.getEnd() : other.getPrev(nofelems-l-2);
+                double mid = 1;
+                for (Idx e=l; e-- > 0;){
+                    const double factor = prefix[e]*mid*suffix[l];
+                    mid *= factors[e];
+                    for (Idx i=other.getPrev(nofelems-e-1); i<other.getPrev(nofelems-e-2); i++){
+                        auto& elem2 = other_stack[i];
+                        for (Idx k=other.getPrev(nofelems-l-1); k<l_end; k++){
+                            auto& elem1 = other_stack[k];
+
+                            double v = elem1.value * elem2.value * factor;
+                            if (elem1.id == elem2.id)
+                                v *= 2;
+                            insertOrUpdatePair(elem1.id, elem2.id, v);
+                        }
+                    }
+                }
+            }
+        }
 
         void mergeSingle(JacStack& other, 
                 const double& jac_value, 
-                const double& hess_value);
+                const double& hess_value){
+            auto& other_stack = other.getStack();
 
-        void setXSize(const Idx& size);
+            for (Idx i=getLast(); i<stack_end; i++)
+                stack[i].value *= jac_value;
+
+            for (Idx i=other.getLast(); i<other.getEnd(); i++){
+                auto& elem2 = other_stack[i];
+                for (Idx k=i; k<other.getEnd(); k++){
+                    auto& elem1 = other_stack[k];
+
+                    double v = elem1.value * elem2.value * hess_value;
+                    insertOrUpdatePair(elem1.id, elem2.id, v);
+
+                }
+            }
+        }
+
+        //! the map grows with the entries and does not depend on the number
+        //of variables
+        void setXSize(const Idx& size){}
+
+        std::size_t bytes()const {
+            return ListStack<HessPair>::bytes() + last_pos_map.bytes();
+        }
 
     private:
         PairHashMap last_pos_map;
 
-        void clearLastStackPos();
+        void clearLastStackPos(){
+            last_pos_map.clear();
+        }
+
+        void setLastStackPos(const HessPair& id, const Idx& conflict){
+            last_pos_map[id] = conflict;
+        }
 
-        void setLastStackPos(const HessPair& id, const Idx& conflict);
+        void insertOrUpdatePair(const Idx& frst, const Idx& scd, const double& value){
+            auto p = uPII(frst, scd);
+            Idx& conflict = last_pos_map[p];
 
-        void insertOrUpdatePair(const Idx& frst, const Idx& scd, const double& value);
+            if (conflict >= getLast())
+                stack[conflict].value += value;
+            else {
+                if (stack_end == stack.size())
+                    stack.resize(stack_end+1);
+                auto& new_elem = stack[stack_end];
+                new_elem.id = p;
+                new_elem.value = value;
+                new_elem.conflict = conflict;
+                conflict = stack_end;
+                stack_end++;
+            }
+        }
 };
 
 }
@@ -15,7 +15,9 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
 #include <cmath>
+#include <iterator>
 #include "inner_constraint.hpp"
 #include "logger.hpp"
 #include "exceptions.hpp"
@@ -23,9 +25,9 @@
 #include "expr.hpp"
 #include "common.hpp"
 #include "operator.hpp"
-#include "stack.hpp"
 #include "simstack.hpp"
-#include "cstack.hpp"
+#include "tracing.hpp"
+#include "memory_report.hpp"
 
 namespace MadOpt {
 
@@ -42,77 +44,410 @@ const double& InnerConstraint::getG()const {
     return g; 
 }
 
-const vector<double>& InnerConstraint::getJac()const { 
-    return jac;
+const double* InnerConstraint::getJacValues()const { 
+    return jac.data();
 }
 
-const vector<double>& InnerConstraint::getHess()const {
+const ArenaVector<double>& InnerConstraint::getHess()const {
     return hess;
 }
 
-const vector<Idx>& InnerConstraint::getHessMap()const{
+const ArenaVector<Idx>& InnerConstraint::getHessMap()const{
     return hess_map;
 }
 
+static bool hasData(OPType type){
+    return type == OP_VAR_POINTER
+        || type == OP_ADD
+        || type == OP_MUL
+        || type == OP_POW
+        || type == OP_POW_INT
+        || type == OP_MONOMIAL
+        || type == OP_MUL_CONST
+        || type == OP_ADD_CONST
+        || type == OP_CONST
+        || type == OP_VAR_IDX
+        || type == OP_PARAM_POINTER;
+}
+
+//! largest integer exponent that is evaluated by multiplications
+static const double MAX_INT_POW = 16;
+
+//! the operator in the tape, OP_POW is specialised by its exponent
+static OPType tapeType(const Operator& op){
+    if (op.getType() != OP_POW)
+        return op.getType();
+    const double e = op.getValue();
+    if (e == 2)
+        return OP_SQUARE;
+    if (e == 3)
+        return OP_CUBE;
+    if (e == -1)
+        return OP_INV;
+    if (e == 0.5)
+        return OP_SQRT;
+    if (e == -0.5)
+        return OP_RSQRT;
+    // 0 and 1 would divide by the base
+    if (e == std::floor(e) && std::fabs(e) <= MAX_INT_POW && e != 0 && e != 1)
+        return OP_POW_INT;
+    return OP_POW;
+}
+
+typedef list<Operator>::const_iterator OpIter;
+
+//! number of operands of an expression operator
+static Idx nofOperands(const Operator& op){
+    switch(op.getType()){
+        case OP_VAR_POINTER:
+        case OP_PARAM_POINTER:
+        case OP_CONST:
+            return 0;
+        case OP_ADD:
+        case OP_MUL:
+            return op.getCounter();
+    }
+    return 1;
+}
+
+//! the operator after the subexpression at iter
+static OpIter skip(OpIter iter){
+    Idx open = 1;
+    while (open){
+        open += nofOperands(*iter);
+        open--;
+        iter++;
+    }
+    return iter;
+}
+
+static bool isInverse(const Operator& op){
+    return op.getType() == OP_POW && op.getValue() == -1;
+}
+
+static void push(vector<OPType>& ops, vector<Value>& data, OPType type,
+        const Value& value=Value()){
+    ops.push_back(type);
+    if (hasData(type))
+        data.push_back(value);
+}
+
+//! true if the subexpression at iter has no variables and no parameters
+static bool isConstant(OpIter iter){
+    const OpIter end = skip(iter);
+    for (; iter!=end; iter++){
+        const OPType type = iter->getType();
+        if (type == OP_VAR_POINTER || type == OP_VAR_IDX || type == OP_PARAM_POINTER)
+            return false;
+    }
+    return true;
+}
+
+//! true if the tape written from start on is one constant, a folded
+//subexpression
+static bool isFolded(const vector<OPType>& ops, const Idx& start){
+    return ops.size() == start + 1 && ops.back() == OP_CONST;
+}
+
+//! removes the folded constant at the end of the tape
+static double popFolded(vector<OPType>& ops, vector<Value>& data){
+    ops.pop_back();
+    const double value = data.back().d;
+    data.pop_back();
+    return value;
+}
+
+//! the unary operator op applied to the constant u, with the library
+//functions instead of the formulas of the tape, which also compute the
+//derivatives
+static double foldValue(const Operator& op, const double& u){
+    switch(op.getType()){
+        case OP_POW:
+            return op.getValue() == -1 ? 1/u : std::pow(u, op.getValue());
+        case OP_SIN:
+            return std::sin(u);
+        case OP_COS:
+            return std::cos(u);
+        case OP_TAN:
+            return std::tan(u);
+        case OP_LOG2:
+            return std::log2(u);
+        case OP_LN:
+            return std::log(u);
+        case OP_MUL_CONST:
+            return op.getValue()*u;
+        case OP_ADD_CONST:
+            return op.getValue() + u;
+    }
+    throw MadOptError("constant folding of an unknown operator");
+}
+
+static OpIter writeTape(OpIter iter, vector<OPType>& ops, vector<Value>& data);
+
+//! the variable of a factor v or pow(v, e) of a monomial, e an integer
+//from 1 to MAX_INT_POW, nullptr for other factors
+static InnerVar* monomialVar(OpIter iter, double& exponent){
+    exponent = 1;
+    if (iter->getType() == OP_POW){
+        exponent = iter->getValue();
+        if (exponent != std::floor(exponent) || exponent < 1 || exponent > MAX_INT_POW)
+            return nullptr;
+        iter++;
+    }
+    return iter->getType() == OP_VAR_POINTER ? iter->getIVar() : nullptr;
+}
+
+/*! \brief writes a product of variables, their integer powers and
+ * constants as one OP_MONOMIAL and its coefficient
+ * \return false if the product has other factors or less than two
+ * variable factors, then nothing is written
+ */
+static bool writeMonomial(OpIter iter, vector<OPType>& ops, vector<Value>& data){
+    const Idx n = iter->getCounter();
+    const OpIter first = std::next(iter);
+    vector<InnerVar*> vars;
+    vector<double> exponents;
+    Idx nof_factors = 0;
+    OpIter child = first;
+    for (Idx i=0; i<n; i++){
+        double exponent;
+        InnerVar* var = monomialVar(child, exponent);
+        if (var){
+            const Idx k = std::find(vars.begin(), vars.end(), var) - vars.begin();
+            if (k == vars.size()){
+                vars.push_back(var);
+                exponents.push_back(exponent);
+            } else {
+                exponents[k] += exponent;
+            }
+            nof_factors++;
+        } else if (!isConstant(child)){
+            return false;
+        }
+        child = skip(child);
+    }
+    if (nof_factors < 2
+            || *std::max_element(exponents.begin(), exponents.end()) > MAX_INT_POW)
+        return false;
+    double coefficient = 1;
+    child = first;
+    for (Idx i=0; i<n; i++){
+        double exponent;
+        if (monomialVar(child, exponent)){
+            child = skip(child);
+            continue;
+        }
+        child = writeTape(child, ops, data);
+        coefficient *= popFolded(ops, data);
+    }
+    if (coefficient == 0){
+        push(ops, data, OP_CONST, Value(0.));
+        return true;
+    }
+    push(ops, data, OP_MONOMIAL, Value((Idx)vars.size()));
+    for (Idx k=0; k<vars.size(); k++){
+        data.push_back(Value(vars[k]));
+        data.push_back(Value(exponents[k]));
+    }
+    if (coefficient == -1)
+        push(ops, data, OP_NEG);
+    else if (coefficient != 1)
+        push(ops, data, OP_MUL_CONST, Value(coefficient));
+    return true;
+}
+
+//! writes a product, its constant factors become one OP_MUL_CONST or
+//OP_NEG and its factors pow(v, -1) divisions, a zero factor makes it 0,
+//products of variables are monomials
+static OpIter writeProduct(OpIter iter, vector<OPType>& ops, vector<Value>& data){
+    if (writeMonomial(iter, ops, data))
+        return skip(iter);
+    const Idx n = iter->getCounter();
+    const OpIter first = std::next(iter);
+    const Idx ops_start = ops.size();
+    const Idx data_start = data.size();
+    double factor = 1;
+    bool has_factor = false;
+    Idx nof_factors = 0;
+    Idx nof_divisors = 0;
+    OpIter child = first;
+    for (Idx i=0; i<n; i++){
+        // constant divisors are folded with the other constants
+        if (isInverse(*child) && !isConstant(child)){
+            nof_divisors++;
+            child = skip(child);
+            continue;
+        }
+        const Idx start = ops.size();
+        child = writeTape(child, ops, data);
+        if (isFolded(ops, start)){
+            factor *= popFolded(ops, data);
+            has_factor = true;
+        } else {
+            nof_factors++;
+        }
+    }
+    const OpIter end = child;
+    if (has_factor && factor == 0){
+        ops.resize(ops_start);
+        data.resize(data_start);
+        push(ops, data, OP_CONST, Value(0.));
+        return end;
+    }
+    if (nof_factors > 1)
+        push(ops, data, OP_MUL, Value(nof_factors));
+    // the constant is the dividend, e.g. 2/v
+    if (nof_factors == 0 && (has_factor || nof_divisors == 0)){
+        push(ops, data, OP_CONST, Value(factor));
+        has_factor = false;
+        nof_factors = 1;
+    }
+    child = first;
+    for (Idx i=0; nof_divisors && i<n; i++){
+        if (!isInverse(*child) || isConstant(child)){
+            child = skip(child);
+        } else if (nof_factors){
+            child = writeTape(std::next(child), ops, data);
+            push(ops, data, OP_DIV);
+        } else {
+            // the product of inverses starts with 1/v
+            child = writeTape(child, ops, data);
+            nof_factors = 1;
+        }
+    }
+    if (has_factor && factor == -1)
+        push(ops, data, OP_NEG);
+    else if (has_factor && factor != 1)
+        push(ops, data, OP_MUL_CONST, Value(factor));
+    return end;
+}
+
+//! writes a sum, its constant terms become one OP_ADD_CONST
+static OpIter writeSum(OpIter iter, vector<OPType>& ops, vector<Value>& data){
+    const Idx n = iter->getCounter();
+    double constant = 0;
+    Idx nof_terms = 0;
+    OpIter child = std::next(iter);
+    for (Idx i=0; i<n; i++){
+        const Idx start = ops.size();
+        child = writeTape(child, ops, data);
+        if (isFolded(ops, start))
+            constant += popFolded(ops, data);
+        else
+            nof_terms++;
+    }
+    if (nof_terms == 0){
+        push(ops, data, OP_CONST, Value(constant));
+        return child;
+    }
+    if (nof_terms > 1)
+        push(ops, data, OP_ADD, Value(nof_terms));
+    if (constant != 0)
+        push(ops, data, OP_ADD_CONST, Value(constant));
+    return child;
+}
+
+/*! \brief writes the subexpression at iter in postfix order, returns the
+ * operator after it
+ * \details constant subexpressions are folded into one OP_CONST, the
+ * parameters stay on the tape as their values may change, pow(u, 1) is
+ * written as u and pow(u, 0) as 1
+ */
+static OpIter writeTape(OpIter iter, vector<OPType>& ops, vector<Value>& data){
+    const Operator& op = *iter;
+    if (op.getType() == OP_MUL)
+        return writeProduct(iter, ops, data);
+    if (op.getType() == OP_ADD)
+        return writeSum(iter, ops, data);
+    OpIter end = std::next(iter);
+    if (!nofOperands(op)){
+        push(ops, data, tapeType(op), op.getData());
+        return end;
+    }
+    const bool is_pow = op.getType() == OP_POW;
+    if (is_pow && op.getValue() == 0){
+        push(ops, data, OP_CONST, Value(1.));
+        return skip(end);
+    }
+    const Idx start = ops.size();
+    end = writeTape(end, ops, data);
+    if (is_pow && op.getValue() == 1)
+        return end;
+    if (isFolded(ops, start))
+        data.back() = Value(foldValue(op, data.back().d));
+    else
+        push(ops, data, tapeType(op), op.getData());
+    return end;
+}
+
 InnerConstraint::InnerConstraint(
         const Expr& expr,
         const double _lb,
         const double _ub,
-        HessPosMap& hess_pos_map,
-        SimStack& stack): 
+        HessStructure& hess_structure,
+        SimStack& stack,
+        Arena* arena): 
+    jac(ArenaAllocator<double>(arena)),
+    hess(ArenaAllocator<double>(arena)),
+    hess_map(ArenaAllocator<Idx>(arena)),
+    jac_entries(ArenaAllocator<Idx>(arena)),
+    operators(ArenaAllocator<OPType>(arena)),
+    data(ArenaAllocator<Value>(arena)),
     _lb(_lb), 
-    _ub(_ub)
+    _ub(_ub),
+    jac_plan(0, arena),
+    hess_plan(0, arena),
+    jac_align(ArenaAllocator<Idx>(arena)),
+    hess_align(ArenaAllocator<Idx>(arena))
 {
-    auto& ops = expr.getOps();
-    for (auto iter=ops.rbegin(); iter!=ops.rend(); iter++){
-        auto op = *iter;
-        auto type = op.getType();
-
-        operators.push_back(type);
-        if (type == OP_VAR_POINTER
-                || type == OP_ADD
-                || type == OP_MUL
-                || type == OP_POW
-                || type == OP_CONST
-                || type == OP_VAR_IDX
-                || type == OP_PARAM_POINTER){
-            data.push_back(op.getData());
-        } else {
-            ASSERT(type == OP_COS
-                    || type == OP_SIN
-                    || type == OP_TAN
-                   || type == OP_LOG2
-                   || type == OP_LN,
-                    "unknown type", type);
-        }
-    }
-
-    stack.setConflicts(&conflicts);
+    TRACE_SPAN("InnerConstraint::InnerConstraint");
+    // the tape is written in buffers of the stack and copied, exact sizes,
+    // growing would leave the old buffers unused in the arena
+    vector<OPType>& tape_operators = stack.getOperatorBuffer();
+    vector<Value>& tape_data = stack.getDataBuffer();
+    tape_operators.clear();
+    tape_data.clear();
+    const OpIter end = writeTape(expr.begin(), tape_operators, tape_data);
+    ASSERT(end == expr.end());
+    (void)end;
+    operators.assign(tape_operators.begin(), tape_operators.end());
+    data.assign(tape_data.begin(), tape_data.end());
+
+    // the plans are recorded in buffers of the stack and copied
+    Array<Idx>& jac_recorded = stack.getJacPlanBuffer();
+    Array<Idx>& hess_recorded = stack.getHessPlanBuffer();
+    jac_recorded.clear();
+    hess_recorded.clear();
+    stack.setPlan(&jac_recorded, &hess_recorded);
     ASSERT_EQ(stack.size(), 0);
     computeFinalStack(stack);
     ASSERT_EQ(stack.size(), 1);
+    jac_plan.assign(jac_recorded);
+    hess_plan.assign(hess_recorded);
     vector<PII> hess_entries = stack.getHessEntries();
+    hess_map.reserve(hess_entries.size());
     FOREACH(p, hess_entries)
     //for (auto& p : hess_entries){
-        hess_pos_map.insert({p, hess_pos_map.size()}); // Only inserts if new.
-        hess_map.push_back(hess_pos_map[p]);
+        hess_map.push_back(hess_structure.add(p));
     }
     hess.resize(hess_map.size());
     ASSERT_EQ(hess.size(), hess_entries.size());
-    jac_entries = stack.getJacEntries();
-    ASSERT_IF(operators.back() != OP_CONST, jac_entries.size() > 0);
+    const vector<Idx> entries = stack.getJacEntries();
+    jac_entries.assign(entries.begin(), entries.end());
+    // a folded tape may have parameters but no variables
+    ASSERT_IF(hasVariables(), jac_entries.size() > 0);
     jac.resize(jac_entries.size());
-    ASSERT_IF(operators.back() != OP_CONST, jac.data() != nullptr);
-    TRACE("conf elems", conflicts.str());
+    ASSERT_IF(hasVariables(), jac.data() != nullptr);
+    TRACE("plans", jac_plan.str(), hess_plan.str());
     TRACE("final simstack", stack.str());
     stack.clear();
 }
 
 //InnerConstraint::InnerConstraint(
 //        const Expr& expr, 
-//        HessPosMap& hess_pos_map,
+//        HessStructure& hess_structure,
 //        SimStack& stack): 
-//    InnerConstraint(expr, 0, 0, hess_pos_map, stack){}
+//    InnerConstraint(expr, 0, 0, hess_structure, stack){}
 
 double InnerConstraint::lb(){
     return _lb; 
@@ -131,11 +466,11 @@ void InnerConstraint::ub(double v){
 }
 
 Idx InnerConstraint::getNNZ_Jac(){
-    ASSERT(operators[0] == OP_CONST || !jac.empty());
+    ASSERT_IF(hasVariables(), !jac.empty());
     return jac.size(); 
 }
 
-const vector<Idx>& InnerConstraint::getJacEntries(){ 
+const ArenaVector<Idx>& InnerConstraint::getJacEntries(){ 
     return jac_entries;
 }
 
@@ -147,159 +482,84 @@ void InnerConstraint::getNZ_Jac(unsigned int* jCol){
     }
 }
 
-void InnerConstraint::setEvals(CStack& stack){
-    TRACE_START;
-    stack.clear();
-    stack.setConflicts(&conflicts);
-    ASSERT_EQ(stack.size(), 0);
-    computeFinalStack(stack);
-    ASSERT_EQ(stack.size(), 1);
-    ASSERT_IF(operators.back() != OP_CONST, jac.data() != nullptr);
-    stack.fill(g, jac.data(), hess.data());
-    VALGRIND_CONDITIONAL_JUMP_TEST(g);
-    TRACE_END;
-}
-
-const double& InnerConstraint::getNextValue(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return data[idx++].d;
-}
-
-Idx InnerConstraint::getNextCounter(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return data[idx++].idx;
+void InnerConstraint::remapHess(const vector<Idx>& perm){
+    FOREACH(pos, hess_map)
+    //for (auto& pos: hess_map){
+        pos = perm[pos];
+    }
 }
 
-const Idx& InnerConstraint::getNextPos(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return (data[idx++].iVar)->getPos();
+bool InnerConstraint::hasVariables()const{
+    return std::count(operators.begin(), operators.end(), OP_VAR_POINTER)
+        || std::count(operators.begin(), operators.end(), OP_MONOMIAL);
 }
 
-const double& InnerConstraint::getNextParamValue(Idx& idx){
-    ASSERT_LE(idx, data.size()-1);
-    return (data[idx++].iParam)->value();
+Idx InnerConstraint::tapeLength(const Expr& expr){
+    vector<OPType> tape_operators;
+    vector<Value> tape_data;
+    writeTape(expr.begin(), tape_operators, tape_data);
+    return tape_operators.size();
 }
 
-#define MADOPTCASE(a) case OP_##a: case##a(stack); break;
-void InnerConstraint::computeFinalStack(Stack& stack){
-    TRACE_START;
-    ASSERT_EQ(stack.getDataI(), 0);
+TapeInfo InnerConstraint::tapeInfo(){
+    TapeInfo info;
+    info.operators = operators.size();
+    info.jac_nnz = jac.size();
+    info.hess_nnz = hess.size();
+    info.plan = jac_plan.size() + hess_plan.size();
+    Idx data_i = 0;
+    Idx stack_size = 0;
     FOREACH(op, operators)
     //for (auto& op: operators){
+        hash_combine(info.shape, (int)op);
         switch(op){
-            MADOPTCASE(VAR_POINTER)
-            MADOPTCASE(CONST)
-            MADOPTCASE(ADD)
-            MADOPTCASE(MUL)
-            MADOPTCASE(POW)
-            MADOPTCASE(PARAM_POINTER)
-            MADOPTCASE(SIN)
-            MADOPTCASE(COS)
-            MADOPTCASE(TAN)
-              MADOPTCASE(LOG2)
-              MADOPTCASE(LN)
-
-            default:
-                throw MadOptError("unknown operator type found");
+            case OP_VAR_POINTER:
+            case OP_VAR_IDX:
+            case OP_PARAM_POINTER:
+            case OP_CONST:
+                stack_size++;
+                data_i++;
+                break;
+            case OP_ADD:
+            case OP_MUL:
+                hash_combine(info.shape, data[data_i].idx);
+                stack_size -= data[data_i++].idx - 1;
+                break;
+            case OP_POW:
+            case OP_POW_INT:
+            case OP_MUL_CONST:
+            case OP_ADD_CONST:
+                data_i++;
+                break;
+            case OP_DIV:
+                stack_size--;
+                break;
+            case OP_MONOMIAL:{
+                // the variables are pushed before their product
+                const Idx n = data[data_i].idx;
+                hash_combine(info.shape, n);
+                info.max_stack = std::max(info.max_stack, stack_size + n);
+                stack_size++;
+                data_i += 1 + 2*n;
+                break;
+            }
         }
+        info.max_stack = std::max(info.max_stack, stack_size);
     }
-    TRACE_END;
-}
-
-void InnerConstraint::caseADD(Stack& stack){
-    TRACE_START;
-    const auto& size = getNextCounter(stack.getDataI());
-    stack.doAdd(size);
-    TRACE_END;
-}
-
-void InnerConstraint::caseMUL(Stack& stack){
-   TRACE_START;
-   const auto& size = getNextCounter(stack.getDataI());
-   for (Idx i=0; i<size-1; i++){
-       stack.doMull();
-   }
-   TRACE_END;
-}
-
-void InnerConstraint::caseVAR_POINTER(Stack& stack){
-    TRACE_START;
-    const auto& pos = getNextPos(stack.getDataI());
-    stack.emplace_back(pos);
-    TRACE_END;
-}
-
-void InnerConstraint::casePARAM_POINTER(Stack& stack){
-    TRACE_START;
-    stack.emplace_back(getNextParamValue(stack.getDataI()));
-    TRACE_END;
-}
-
-void InnerConstraint::caseCONST(Stack& stack){
-   TRACE_START;
-    stack.emplace_back(getNextValue(stack.getDataI()));
-   TRACE_END;
-}
-
-void InnerConstraint::casePOW(Stack& stack){
-   TRACE_START;
-    double value = getNextValue(stack.getDataI());
-    double& g = stack.lastG();
-    double pow_hess(1);
-    if (value != 2)
-        pow_hess = std::pow(g, value-2);
-    double hess = pow_hess * value * (value-1);
-    double jac = pow_hess * g * value;
-    g = pow_hess * g * g;
-    stack.doUnaryOp(jac, hess);
-   TRACE_END;
-}
-
-void InnerConstraint::caseSIN(Stack& stack){
-   TRACE_START;
-    double& g = stack.lastG();
-    double v1 = std::cos(g);
-    g = std::sin(g);
-    stack.doUnaryOp(v1, -g);
-   TRACE_END;
-}
-
-void InnerConstraint::caseCOS(Stack& stack){
-   TRACE_START;
-    double& g = stack.lastG();
-    double v1 = -std::sin(g);
-    g = std::cos(g);
-    stack.doUnaryOp(v1, -g);
-   TRACE_END;
-}
-
-void InnerConstraint::caseTAN(Stack& stack){
-   TRACE_START;
-    double& g = stack.lastG();
-    double v1 = 1 + std::pow(g, 2);
-    g = std::tan(g);
-    stack.doUnaryOp(v1, -g);
-   TRACE_END;
-}
-
-void InnerConstraint::caseLOG2(Stack& stack){
-  TRACE_START;
-  double& g = stack.lastG();
-  double v1 = 1.0 / (g * std::log(2));
-  double hess = -std::log(2) * std::pow(v1, 2);
-  g = std::log2(g);
-  stack.doUnaryOp(v1, hess);
-  TRACE_END;
-}
-
-void InnerConstraint::caseLN(Stack& stack){
-  TRACE_START;
-  double& g = stack.lastG();
-  double v1 = 1.0/g;
-  double hess = - std::pow(v1, 2);
-  g = std::log(g);
-  stack.doUnaryOp(v1, hess);
-  TRACE_END;
+    return info;
+}
+
+void InnerConstraint::addMemory(MemoryReport& report)const{
+    report.add("constraint", sizeof(InnerConstraint));
+    report.add("constraint.operators", heapBytes(operators));
+    report.add("constraint.data", heapBytes(data));
+    report.add("constraint.jac", heapBytes(jac));
+    report.add("constraint.hess", heapBytes(hess));
+    report.add("constraint.hess_map", heapBytes(hess_map));
+    report.add("constraint.jac_entries", heapBytes(jac_entries));
+    report.add("constraint.jac_plan", jac_plan.bytes());
+    report.add("constraint.hess_plan", hess_plan.bytes());
+    report.add("constraint.align", heapBytes(jac_align) + heapBytes(hess_align));
 }
 
 }
@@ -28,16 +28,16 @@ namespace MadOpt {
 class Solution;
 class Expr;
 typedef char OPType;
-class Stack;
 class CStack;
 class SimStack;
 
 class InnerConstraint: public ConstraintInterface{
     public:
+        //! all arrays are allocated in arena, the global heap if NULL
         InnerConstraint(const Expr& expr, const double _lb, const double _ub,
-                HessPosMap& hess_pos_map, SimStack& stack);
+                HessStructure& hess_structure, SimStack& stack, Arena* arena=NULL);
 
-        //InnerConstraint(const Expr& expr, HessPosMap& hess_pos_map, SimStack& stack);
+        //InnerConstraint(const Expr& expr, HessStructure& hess_structure, SimStack& stack);
 
         // bounds
         //
@@ -60,38 +60,50 @@ class InnerConstraint: public ConstraintInterface{
         // compute next point
         //
         //
-        void setEvals(CStack&);
+        void setEvals(CStack& stack){ setEvals(stack, EVAL_HESS); }
+
+        void setEvals(CStack&, EvalLevel level);
 
         // access next points solution
         //
         //
         const double& getG()const ;
 
-        const vector<double>& getJac()const ;
+        //! the jacobian lives in the arena, so there is no getJac()
+        const double* getJacValues()const ;
 
         void eval_h(double* values, const double& lambda);
 
+        void remapHess(const vector<Idx>& perm);
+
+        TapeInfo tapeInfo();
+
+        //! number of operators of the tape of expr
+        static Idx tapeLength(const Expr& expr);
+
+        void addMemory(MemoryReport& report)const;
+
         // for debug and testing
         //
         //
-        const vector<double>& getHess()const ;
+        const ArenaVector<double>& getHess()const ;
 
-        const vector<Idx>& getHessMap()const;
+        const ArenaVector<Idx>& getHessMap()const;
 
-        const vector<Idx>& getJacEntries();
+        const ArenaVector<Idx>& getJacEntries();
 
     private:
-        vector<double> jac;
+        ArenaVector<double> jac;
 
-        vector<double> hess;
+        ArenaVector<double> hess;
 
-        vector<Idx> hess_map;
+        ArenaVector<Idx> hess_map;
 
-        vector<Idx> jac_entries;
+        ArenaVector<Idx> jac_entries;
 
-        vector<OPType> operators;
+        ArenaVector<OPType> operators;
 
-        vector<Value> data;
+        ArenaVector<Value> data;
 
         double g;
 
@@ -99,7 +111,17 @@ class InnerConstraint: public ConstraintInterface{
 
         double _ub;
 
-        Array<Idx> conflicts;
+        //! evaluation plans of the jacobian and the hessian compiled by the
+        //symbolic pass, \sa ListSimStack::merge()
+        Array<Idx> jac_plan;
+
+        Array<Idx> hess_plan;
+
+        //! where ENGINE_ONE_PASS puts its entries in jac and hess, set by
+        //the first evaluation, \sa VStack::optimizeAlignment()
+        ArenaVector<Idx> jac_align;
+
+        ArenaVector<Idx> hess_align;
 
         inline const double& getNextValue(Idx& idx); 
 
@@ -109,30 +131,66 @@ class InnerConstraint: public ConstraintInterface{
 
         inline const double& getNextParamValue(Idx& idx);
 
-        void computeFinalStack(Stack&);
+        //! true if the tape reads variables, otherwise it has no jacobian
+        bool hasVariables()const;
+
+        //! evaluates up to level, \sa setEvals()
+        template<EvalLevel level> void sweep(CStack&);
+
+        //! evaluates up to level with the stack of ENGINE_ONE_PASS
+        template<EvalLevel level> void onePass(CStack&);
+
+        /*! \brief runs the tape on stack
+         * \details a template over the stack type, SimStack records the
+         * structure and CSweep evaluates up to its level. Each
+         * instantiation only contains the work its stack needs, e.g. a
+         * value only sweep computes no derivatives of the operators.
+         */
+        template<class S> void computeFinalStack(S&);
+
+        template<class S> void caseVAR_POINTER(S&);
+
+        template<class S> void caseADD(S&);
+
+        template<class S> void caseMUL(S&);
+
+        template<class S> void caseDIV(S&);
+
+        template<class S> void caseNEG(S&);
+
+        template<class S> void caseMUL_CONST(S&);
+
+        template<class S> void caseADD_CONST(S&);
+
+        template<class S> void casePARAM_POINTER(S&);
+
+        template<class S> void caseCONST(S&);
+
+        template<class S> void casePOW(S&);
+
+        template<class S> void caseSQUARE(S&);
 
-        void caseVAR_POINTER(Stack&);
+        template<class S> void caseCUBE(S&);
 
-        void caseSQR_VAR(Stack&);
+        template<class S> void caseINV(S&);
 
-        void caseADD(Stack&);
+        template<class S> void caseSQRT(S&);
 
-        void caseMUL(Stack&);
+        template<class S> void caseRSQRT(S&);
 
-        void casePARAM_POINTER(Stack&);
+        template<class S> void casePOW_INT(S&);
 
-        void caseCONST(Stack&);
+        template<class S> void caseMONOMIAL(S&);
 
-        void casePOW(Stack&);
+        template<class S> void caseSIN(S&);
 
-        void caseSIN(Stack&);
+        template<class S> void caseCOS(S&);
 
-        void caseCOS(Stack&);
+        template<class S> void caseTAN(S&);
 
-        void caseTAN(Stack&);
+        template<class S> void caseLOG2(S&);
 
-  void caseLOG2(Stack&);
-  void caseLN(Stack&);
+        template<class S> void caseLN(S&);
 };
 }
 #endif
@@ -0,0 +1,423 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include "inner_constraint.hpp"
+#include "logger.hpp"
+#include "exceptions.hpp"
+#include "common.hpp"
+#include "operator.hpp"
+#include "inner_var.hpp"
+#include "inner_param.hpp"
+#include "simstack.hpp"
+#include "cstack.hpp"
+#include "vstack.hpp"
+#include "tracing.hpp"
+
+// the tape interpreter, separate from the tape writer so that FAST_MATH
+// only changes the evaluation
+
+namespace MadOpt {
+
+//! x^n by squaring
+static inline double powInt(double x, int n){
+    if (n < 0)
+        return 1/powInt(x, -n);
+    double res = 1;
+    while (n){
+        if (n & 1)
+            res *= x;
+        x *= x;
+        n >>= 1;
+    }
+    return res;
+}
+
+//! sin and cos with one call where the platform has it
+static inline void sinCos(const double& x, double& s, double& c){
+#if defined(__GLIBC__)
+    ::sincos(x, &s, &c);
+#else
+    s = std::sin(x);
+    c = std::cos(x);
+#endif
+}
+
+void InnerConstraint::setEvals(CStack& stack, EvalLevel level){
+    TRACE_START;
+    stack.clear();
+    stack.setPlan(&jac_plan, &hess_plan);
+    ASSERT_EQ(stack.size(), 0);
+    ASSERT_IF(hasVariables(), jac.data() != nullptr);
+    switch(level){
+        case EVAL_NONE:
+            break;
+        case EVAL_VALUE:
+            sweep<EVAL_VALUE>(stack);
+            break;
+        case EVAL_JAC:
+            if (stack.getEngine() == ENGINE_ONE_PASS)
+                onePass<EVAL_JAC>(stack);
+            else
+                sweep<EVAL_JAC>(stack);
+            break;
+        case EVAL_HESS:
+            if (stack.getEngine() == ENGINE_ONE_PASS)
+                onePass<EVAL_HESS>(stack);
+            else
+                sweep<EVAL_HESS>(stack);
+            break;
+    }
+    VALGRIND_CONDITIONAL_JUMP_TEST(g);
+    TRACE_END;
+}
+
+template<EvalLevel level>
+void InnerConstraint::sweep(CStack& stack){
+    CSweep<level> sweep(stack);
+    computeFinalStack(sweep);
+    ASSERT_EQ(stack.size(), 1);
+    sweep.fill(g, jac.data(), hess.data());
+}
+
+template<EvalLevel level>
+void InnerConstraint::onePass(CStack& stack){
+    VStack& vstack = stack.getVStack();
+    vstack.setX(stack.getX(), stack.getXSize());
+    vstack.clear();
+    if (jac_align.size() != jac.size() || hess_align.size() != hess.size()){
+        // the first evaluation aligns the entries, hence it needs all of them
+        VSweep<EVAL_HESS> sweep(vstack);
+        computeFinalStack(sweep);
+        vstack.optimizeAlignment(jac_entries, hess_map, jac_align, hess_align);
+        sweep.fill(g, jac.data(), hess.data(), jac_align.data(), hess_align.data());
+        return;
+    }
+    VSweep<level> sweep(vstack);
+    computeFinalStack(sweep);
+    sweep.fill(g, jac.data(), hess.data(), jac_align.data(), hess_align.data());
+}
+
+const double& InnerConstraint::getNextValue(Idx& idx){
+    ASSERT_LE(idx, data.size()-1);
+    return data[idx++].d;
+}
+
+Idx InnerConstraint::getNextCounter(Idx& idx){
+    ASSERT_LE(idx, data.size()-1);
+    return data[idx++].idx;
+}
+
+const Idx& InnerConstraint::getNextPos(Idx& idx){
+    ASSERT_LE(idx, data.size()-1);
+    return (data[idx++].iVar)->getPos();
+}
+
+const double& InnerConstraint::getNextParamValue(Idx& idx){
+    ASSERT_LE(idx, data.size()-1);
+    return (data[idx++].iParam)->value();
+}
+
+#define MADOPTCASE(a) case OP_##a: case##a(stack); break;
+template<class S>
+void InnerConstraint::computeFinalStack(S& stack){
+    TRACE_START;
+    ASSERT_EQ(stack.getDataI(), 0);
+    FOREACH(op, operators)
+    //for (auto& op: operators){
+        switch(op){
+            MADOPTCASE(VAR_POINTER)
+            MADOPTCASE(CONST)
+            MADOPTCASE(ADD)
+            MADOPTCASE(MUL)
+            MADOPTCASE(POW)
+            MADOPTCASE(SQUARE)
+            MADOPTCASE(CUBE)
+            MADOPTCASE(INV)
+            MADOPTCASE(SQRT)
+            MADOPTCASE(RSQRT)
+            MADOPTCASE(POW_INT)
+            MADOPTCASE(MONOMIAL)
+            MADOPTCASE(DIV)
+            MADOPTCASE(NEG)
+            MADOPTCASE(MUL_CONST)
+            MADOPTCASE(ADD_CONST)
+            MADOPTCASE(PARAM_POINTER)
+            MADOPTCASE(SIN)
+            MADOPTCASE(COS)
+            MADOPTCASE(TAN)
+              MADOPTCASE(LOG2)
+              MADOPTCASE(LN)
+
+            default:
+                throw MadOptError("unknown operator type found");
+        }
+    }
+    TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseADD(S& stack){
+    TRACE_START;
+    const auto& size = getNextCounter(stack.getDataI());
+    stack.doAdd(size);
+    TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseMUL(S& stack){
+   TRACE_START;
+   const auto& size = getNextCounter(stack.getDataI());
+   stack.doMul(size);
+   TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseDIV(S& stack){
+   TRACE_START;
+   stack.doDiv();
+   TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseVAR_POINTER(S& stack){
+    TRACE_START;
+    const auto& pos = getNextPos(stack.getDataI());
+    stack.emplace_back(pos);
+    TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::casePARAM_POINTER(S& stack){
+    TRACE_START;
+    stack.emplace_back(getNextParamValue(stack.getDataI()));
+    TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseCONST(S& stack){
+   TRACE_START;
+    stack.emplace_back(getNextValue(stack.getDataI()));
+   TRACE_END;
+}
+
+// the unary operators compute their derivatives only if the stack needs
+// them, S::level is a constant, hence the branches are resolved at compile
+// time
+
+template<class S>
+void InnerConstraint::casePOW(S& stack){
+   TRACE_START;
+    double value = getNextValue(stack.getDataI());
+    double& g = stack.lastG();
+    double pow_hess(1);
+    if (value != 2)
+        pow_hess = std::pow(g, value-2);
+    if (S::level < EVAL_JAC){
+        // same rounding as with the derivatives
+        g = pow_hess * g * g;
+        return;
+    }
+    double hess = pow_hess * value * (value-1);
+    double jac = pow_hess * g * value;
+    g = pow_hess * g * g;
+    stack.doUnaryOp(jac, hess);
+   TRACE_END;
+}
+
+// the linear operators only scale the derivatives
+
+template<class S>
+void InnerConstraint::caseNEG(S& stack){
+    double& g = stack.lastG();
+    g = -g;
+    if (S::level >= EVAL_JAC)
+        stack.doScale(-1);
+}
+
+template<class S>
+void InnerConstraint::caseMUL_CONST(S& stack){
+    const double& factor = getNextValue(stack.getDataI());
+    stack.lastG() *= factor;
+    if (S::level >= EVAL_JAC)
+        stack.doScale(factor);
+}
+
+template<class S>
+void InnerConstraint::caseADD_CONST(S& stack){
+    stack.lastG() += getNextValue(stack.getDataI());
+}
+
+// the specialised powers compute the value the same way on all levels
+
+template<class S>
+void InnerConstraint::caseSQUARE(S& stack){
+    double& g = stack.lastG();
+    const double u = g;
+    g = u*u;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(2*u, 2);
+}
+
+template<class S>
+void InnerConstraint::caseCUBE(S& stack){
+    double& g = stack.lastG();
+    const double u = g;
+    const double u2 = u*u;
+    g = u2*u;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(3*u2, 6*u);
+}
+
+template<class S>
+void InnerConstraint::caseINV(S& stack){
+    double& g = stack.lastG();
+    const double v = 1/g;
+    g = v;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(-v*v, 2*v*v*v);
+}
+
+template<class S>
+void InnerConstraint::caseSQRT(S& stack){
+    double& g = stack.lastG();
+    const double u = g;
+    const double s = std::sqrt(u);
+    g = s;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(0.5/s, -0.25/(s*u));
+}
+
+template<class S>
+void InnerConstraint::caseRSQRT(S& stack){
+    double& g = stack.lastG();
+    const double u = g;
+    const double r = 1/std::sqrt(u);
+    g = r;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(-0.5*r/u, 0.75*r/(u*u));
+}
+
+//! raises the last element to the integer power n
+template<class S>
+static inline void raise(S& stack, const int& n){
+    double& g = stack.lastG();
+    const double u = g;
+    const double p = powInt(u, n-2);
+    g = p*u*u;
+    if (S::level >= EVAL_JAC)
+        stack.doUnaryOp(n*p*u, n*(n-1)*p);
+}
+
+template<class S>
+void InnerConstraint::casePOW_INT(S& stack){
+    raise(stack, getNextValue(stack.getDataI()));
+}
+
+template<class S>
+void InnerConstraint::caseMONOMIAL(S& stack){
+    TRACE_START;
+    const Idx n = getNextCounter(stack.getDataI());
+    for (Idx i=0; i<n; i++){
+        stack.emplace_back(getNextPos(stack.getDataI()));
+        const int exponent = getNextValue(stack.getDataI());
+        if (exponent > 1)
+            raise(stack, exponent);
+    }
+    if (n > 1)
+        stack.doMul(n);
+    TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseSIN(S& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    if (S::level < EVAL_JAC){
+        g = std::sin(g);
+        return;
+    }
+    double s, c;
+    sinCos(g, s, c);
+    g = s;
+    stack.doUnaryOp(c, -s);
+   TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseCOS(S& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    if (S::level < EVAL_JAC){
+        g = std::cos(g);
+        return;
+    }
+    double s, c;
+    sinCos(g, s, c);
+    g = c;
+    stack.doUnaryOp(-s, -c);
+   TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseTAN(S& stack){
+   TRACE_START;
+    double& g = stack.lastG();
+    if (S::level < EVAL_JAC){
+        g = std::tan(g);
+        return;
+    }
+    const double t = std::tan(g);
+    const double v1 = 1 + t*t;
+    g = t;
+    stack.doUnaryOp(v1, 2*t*v1);
+   TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseLOG2(S& stack){
+  TRACE_START;
+  double& g = stack.lastG();
+  if (S::level < EVAL_JAC){
+      g = std::log2(g);
+      return;
+  }
+  double v1 = 1.0 / (g * std::log(2));
+  double hess = -std::log(2) * std::pow(v1, 2);
+  g = std::log2(g);
+  stack.doUnaryOp(v1, hess);
+  TRACE_END;
+}
+
+template<class S>
+void InnerConstraint::caseLN(S& stack){
+  TRACE_START;
+  double& g = stack.lastG();
+  if (S::level < EVAL_JAC){
+      g = std::log(g);
+      return;
+  }
+  double v1 = 1.0/g;
+  double hess = - std::pow(v1, 2);
+  g = std::log(g);
+  stack.doUnaryOp(v1, hess);
+  TRACE_END;
+}
+
+// the constructor records the plans with the symbolic stack
+template void InnerConstraint::computeFinalStack<SimStack>(SimStack&);
+
+}
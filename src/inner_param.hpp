@@ -16,21 +16,24 @@
 #ifndef MADOPT_INNER_PARAM_H
 #define MADOPT_INNER_PARAM_H
 
+#include "arena.hpp"
+
 namespace MadOpt {
 
 class InnerParam{
     public:
-        InnerParam(const double v, const string& n): _value(v), _name(n){}
+        InnerParam(const double v, const string& n, Arena* arena=NULL):
+            _value(v), _name(n.c_str(), n.size(), ArenaAllocator<char>(arena)){}
 
         void value(const double v){ _value = v; }
 
         const double& value()const { return _value; }
 
-        string name()const { return _name;}
+        string name()const { return string(_name.c_str(), _name.size());}
 
     private:
         double _value;
-        string _name;
+        ArenaString _name;
 };
 
 }
@@ -27,12 +27,13 @@ InnerVar::InnerVar(double _lb,
         double xi, 
         VarType type, 
         string name, 
-        const Solution& sol):
+        const Solution& sol,
+        Arena* arena):
         pos(-1), 
         _ub(_ub), 
         _lb(_lb), 
         xi(xi), 
-        _name(name), 
+        _name(name.c_str(), name.size(), ArenaAllocator<char>(arena)), 
         type(type), 
         sol(sol), 
 	is_fixed(false){
@@ -44,7 +45,7 @@ bool InnerVar::isActive(){
 }
 
 string InnerVar::name()const {
-    return _name;
+    return string(_name.c_str(), _name.size());
 }
 
 VarType InnerVar::getType()const {
@@ -77,6 +78,10 @@ void InnerVar::ub(double u){
     _ub=u; checkBounds(); 
 }
 
+void InnerVar::bounds(double l, double u){
+    _lb=l; _ub=u; checkBounds(); 
+}
+
 double InnerVar::init()const {
     return xi;
 }
@@ -125,7 +130,7 @@ const string InnerVar::toString()const {
 
     return "" 
         + lbstr + "<" 
-        + _name 
+        + name() 
         + st
         + "=" + to_string(xi) 
         + "<" + ubstr;
@@ -133,9 +138,9 @@ const string InnerVar::toString()const {
 
 void InnerVar::checkBounds(){
     if (_lb > _ub)
-        throw MadOptError("lb larger than ub for variable " + _name);
+        throw MadOptError("lb larger than ub for variable " + name());
     if (_lb > xi || _ub < xi)
-        throw MadOptError("init not in bounds var " + _name);
+        throw MadOptError("init not in bounds var " + name());
 }
 
 
@@ -17,6 +17,7 @@
 #define MADOPT_INNER_VAR_H
 
 #include "common.hpp"
+#include "arena.hpp"
 
 namespace MadOpt {
 
@@ -29,7 +30,8 @@ class InnerVar{
                 double xi,
                 VarType type,
                 string name,
-                const Solution& sol);
+                const Solution& sol,
+                Arena* arena=NULL);
 
         bool isActive();
         string name()const ;
@@ -44,6 +46,9 @@ class InnerVar{
         void lb(double l);
         void ub(double u);
 
+        //! set both bounds before they are checked
+        void bounds(double l, double u);
+
         double init()const ;
         void init(double v);
 
@@ -64,7 +69,7 @@ class InnerVar{
         double _ub;
         double _lb;
         double xi;
-        const string _name;
+        const ArenaString _name;
         VarType type;
         const Solution& sol;
 
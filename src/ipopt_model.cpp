@@ -15,17 +15,39 @@
  */
 #include "ipopt_model.hpp"
 #include "ipopt_nlp.hpp"
+#include "solver_options.hpp"
+#include "solve_executor.hpp"
+#include "tracing.hpp"
 
 using namespace MadOpt;
 
 namespace MadOpt {
+    //! ipopt application of a SolveExecutor worker, initialised once and
+    //reused for every model the worker solves
+    struct IpoptWorkspaceEntry: public SolverWorkspace::Entry {
+        IpoptWorkspaceEntry(): Iapp(new IpoptApplication()){
+            Iapp->Initialize();
+            defaults = *Iapp->Options();
+        }
+        Ipopt::SmartPtr<IpoptApplication> Iapp;
+        Ipopt::OptionsList defaults;
+    };
+
     struct IpoptModelImpl {
-        IpoptModelImpl(IpoptModel* model){
-            Iapp.Initialize();
-            ipopt_callback = new IpoptUserClass(model);
+        IpoptModelImpl(IpoptModel* model): app_loaded(false){
+            nlp = new IpoptUserClass(model);
+            ipopt_callback = nlp;
         }
-        IpoptApplication Iapp;
+        //! created on the first solve(), models that are only solved by a
+        //SolveExecutor never initialise their own application
+        Ipopt::SmartPtr<IpoptApplication> Iapp;
         Ipopt::SmartPtr<Ipopt::TNLP> ipopt_callback;
+        //! owned by ipopt_callback
+        IpoptUserClass* nlp;
+        SolverOptions options;
+        //! true if Iapp holds the current structure of the model, hence
+        //ReOptimizeTNLP can be used
+        bool app_loaded;
     };
 }
 
@@ -38,30 +60,63 @@ IpoptModel::~IpoptModel(){
 }
 
 void IpoptModel::solve(){
-    if (not show_solver){
-        setIntegerOption("print_level", 0);
-        setStringOption("sb", "yes");
+    if (IsNull(impl->Iapp)){
+        impl->Iapp = new IpoptApplication();
+        impl->Iapp->Initialize();
     }
 
-    if (timelimit >= 0)
-        setNumericOption("max_cpu_time", timelimit);
+    if (model_changed)
+        impl->app_loaded = false;
+
+    solve(*impl->Iapp, impl->app_loaded);
+    impl->app_loaded = true;
+}
+
+void IpoptModel::solve(SolverWorkspace& workspace){
+    auto& entry = workspace.get<IpoptWorkspaceEntry>();
+    *entry.Iapp->Options() = entry.defaults;
 
     if (model_changed)
-        impl->Iapp.OptimizeTNLP(impl->ipopt_callback);
+        impl->app_loaded = false;
+
+    solve(*entry.Iapp, false);
+}
+
+void IpoptModel::solve(IpoptApplication& app, bool reoptimize){
+    STATS(solve_stats.clear());
+    STATS_TIMER(solve_stats.solve);
+    TRACE_SPAN("IpoptModel::solve");
+    finalize();
+    auto options = app.Options();
+    impl->options.applyTo(*options);
+
+    if (not show_solver){
+        options->SetIntegerValue("print_level", 0);
+        options->SetStringValue("sb", "yes");
+    }
+
+    // a wall clock deadline per model, \sa IpoptUserClass::setTimelimit
+    impl->nlp->setTimelimit(timelimit);
+
+    if (reoptimize)
+        app.ReOptimizeTNLP(impl->ipopt_callback);
     else
-        impl->Iapp.ReOptimizeTNLP(impl->ipopt_callback);
+        app.OptimizeTNLP(impl->ipopt_callback);
 
     model_changed = false;
 }
 
 void IpoptModel::setStringOption(std::string key, std::string value){
-    impl->Iapp.Options()->SetStringValue(key, value);
+    impl->options.strings[key] = value;
+    // eval_h is never called if the solver approximates the hessian
+    if (key == "hessian_approximation")
+        setEvalLevel(value == "limited-memory" ? EVAL_JAC : EVAL_HESS);
 }
 
 void IpoptModel::setNumericOption(std::string key, double value){
-    impl->Iapp.Options()->SetNumericValue(key, value);
+    impl->options.numerics[key] = value;
 }
 
 void IpoptModel::setIntegerOption(std::string key, int value){
-    impl->Iapp.Options()->SetIntegerValue(key, value);
+    impl->options.integers[key] = value;
 }
@@ -18,6 +18,10 @@
 
 #include "model.hpp"
 
+namespace Ipopt {
+class IpoptApplication;
+}
+
 namespace MadOpt {
 
 struct IpoptModelImpl;
@@ -37,8 +41,14 @@ class IpoptModel: public Model {
 
         void solve();
 
+        //! solve with the ipopt application of the workspace, the options
+        //of the application are reset to the state after Initialize() first
+        void solve(SolverWorkspace& workspace);
+
     private:
         IpoptModelImpl* impl;
+
+        void solve(Ipopt::IpoptApplication& app, bool reoptimize);
 };
 
 }
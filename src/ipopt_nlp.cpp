@@ -15,14 +15,19 @@
  */
 #include "ipopt_nlp.hpp"
 
+#include <coin/IpIpoptData.hpp>
+
 #include "logger.hpp"
 #include "model.hpp"
+#include "tracing.hpp"
 
 using namespace MadOpt;
 
 bool IpoptUserClass::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
                             Index& nnz_h_lag, Ipopt::TNLP::IndexStyleEnum& index_style){
     TRACE_START;
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("ipopt::get_nlp_info");
     n = solver->nx();
     m = solver->ng();
     nnz_jac_g = solver->getNNZ_Jac();
@@ -52,13 +57,26 @@ void IpoptUserClass::finalize_solution(
     TRACE_START;
     Solution& sol = solver->getSolution();
     Solution::SolverStatus s = (Solution::SolverStatus)status;
-    sol.set(s, n, m, obj_value, x, lambda);
+    if (s == Solution::USER_REQUESTED_STOP and deadlinePassed())
+        s = Solution::CPUTIME_EXCEEDED;
+    sol.set(s, n, m, obj_value, x, lambda, z_L, z_U);
+#ifdef ENABLE_STATS
+    if (ip_data != NULL){
+        SolveStats& stats = solver->getStats();
+        stats.iterations = ip_data->iter_count();
+        // TimingStats() is not const, the timings are only read
+        stats.solver_seconds = const_cast<Ipopt::IpoptData*>(ip_data)->TimingStats()
+            .OverallAlgorithm().TotalWallclockTime();
+    }
+#endif
     TRACE_END;
 }
 
 bool IpoptUserClass::get_bounds_info(Index n, Number* x_l, Number* x_u,
                                Index m, Number* g_l, Number* g_u){
     TRACE_START;
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("ipopt::get_bounds_info");
     assert((Idx)n==solver->nx());
     assert((Idx)m==solver->ng());
     solver->getBounds(x_l, x_u, g_l, g_u);
@@ -75,6 +93,8 @@ bool IpoptUserClass::get_starting_point(Index n, bool init_x, Number* x,
                                   Index m, bool init_lambda,
                                   Number* lambda){
     TRACE_START;
+    STATS_TIMER(solver->getStats().structure);
+    TRACE_SPAN("ipopt::get_starting_point");
     assert((Idx)n==solver->nx());
     if (init_x)
         solver->getInits(x);
@@ -93,6 +113,8 @@ bool IpoptUserClass::get_starting_point(Index n, bool init_x, Number* x,
 
 bool IpoptUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_value){
     TRACE_START;
+    STATS_TIMER(solver->getStats().eval_f);
+    TRACE_SPAN("ipopt::eval_f");
     assert((Idx)n==solver->nx());
     solver->eval_f(x, new_x, obj_value);
     VALGRIND_CONDITIONAL_JUMP_TEST(obj_value);
@@ -102,6 +124,8 @@ bool IpoptUserClass::eval_f(Index n, const Number* x, bool new_x, Number& obj_va
 
 bool IpoptUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad_f){
     TRACE_START;
+    STATS_TIMER(solver->getStats().eval_grad_f);
+    TRACE_SPAN("ipopt::eval_grad_f");
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
     solver->eval_grad_f(x, new_x, grad_f);
@@ -112,6 +136,8 @@ bool IpoptUserClass::eval_grad_f(Index n, const Number* x, bool new_x, Number* g
 
 bool IpoptUserClass::eval_g(Index n, const Number* x, bool new_x, Index m, Number* g){
     TRACE_START;
+    STATS_TIMER(solver->getStats().eval_g);
+    TRACE_SPAN("ipopt::eval_g");
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
     solver->eval_g(x, new_x, g);
@@ -124,6 +150,8 @@ bool IpoptUserClass::eval_jac_g(Index n, const Number* x, bool new_x,
                         Index m, Index nele_jac, Index* iRow, Index *jCol,
                         Number* values){
     TRACE_START;
+    STATS_TIMER(values == NULL ? solver->getStats().structure : solver->getStats().eval_jac_g);
+    TRACE_SPAN("ipopt::eval_jac_g");
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
     assert((Idx)m==solver->ng());
@@ -145,6 +173,8 @@ bool IpoptUserClass::eval_h(Index n, const Number* x, bool new_x,
                     bool new_lambda, Index nele_hess, Index* iRow,
                     Index* jCol, Number* values){
     TRACE_START;
+    STATS_TIMER(values == NULL ? solver->getStats().structure : solver->getStats().eval_h);
+    TRACE_SPAN("ipopt::eval_h");
     TRACE("new_x=", new_x);
     assert((Idx)n==solver->nx());
     assert((Idx)m==solver->ng());
@@ -162,6 +192,27 @@ bool IpoptUserClass::eval_h(Index n, const Number* x, bool new_x,
     return true;
 }
 
+bool IpoptUserClass::intermediate_callback(Ipopt::AlgorithmMode mode, Index iter,
+                    Number obj_value, Number inf_pr, Number inf_du,
+                    Number mu, Number d_norm, Number regularization_size,
+                    Number alpha_du, Number alpha_pr, Index ls_trials,
+                    const Ipopt::IpoptData* ip_data,
+                    Ipopt::IpoptCalculatedQuantities* ip_cq){
+    return not deadlinePassed();
+}
+
+void IpoptUserClass::setTimelimit(double timelimit){
+    has_deadline = timelimit >= 0;
+    if (has_deadline)
+        deadline = std::chrono::steady_clock::now() +
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(timelimit));
+}
+
+bool IpoptUserClass::deadlinePassed()const{
+    return has_deadline and std::chrono::steady_clock::now() >= deadline;
+}
+
 bool IpoptUserClass::get_variables_linearity(Index n, Ipopt::TNLP::LinearityType* var_types){
   return false;
 }
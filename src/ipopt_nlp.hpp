@@ -16,6 +16,8 @@
 #ifndef MADOPT_IPOPT_NLP_H
 #define MADOPT_IPOPT_NLP_H
 
+#include <chrono>
+
 #include <coin/IpIpoptApplication.hpp>
 #include <coin/IpTNLP.hpp>
 
@@ -29,7 +31,7 @@ class Model;
 
 class IpoptUserClass : public Ipopt::TNLP {
 public:
-    IpoptUserClass(Model* solver):solver(solver){}
+    IpoptUserClass(Model* solver):solver(solver), has_deadline(false){}
 
     ~IpoptUserClass(){}
 
@@ -96,11 +98,28 @@ public:
       return false;
   }
 
+  /** stops the solve once the deadline has passed */
+  virtual bool intermediate_callback(Ipopt::AlgorithmMode mode, Index iter,
+                                     Number obj_value, Number inf_pr, Number inf_du,
+                                     Number mu, Number d_norm, Number regularization_size,
+                                     Number alpha_du, Number alpha_pr, Index ls_trials,
+                                     const Ipopt::IpoptData* ip_data,
+                                     Ipopt::IpoptCalculatedQuantities* ip_cq);
+
+  /** starts the wall clock of the next solve, a negative timelimit means
+   * no deadline. max_cpu_time counts the cpu time of the whole process,
+   * hence concurrent solves would stop each other early */
+  void setTimelimit(double timelimit);
+
 //  virtual const SosInfo * sosConstraints() const{return NULL;}
 //  virtual const BranchingInfo* branchingInfo() const{return NULL;}
 
 private:
   Model* solver;
+  bool has_deadline;
+  std::chrono::steady_clock::time_point deadline;
+
+  bool deadlinePassed()const;
 };
 }
 #endif
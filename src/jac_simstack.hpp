@@ -40,6 +40,11 @@ class JacSimStack : public ListSimStack<Idx> {
             last_pos_map.resize(size, 0);
         }
 
+        std::size_t bytes()const {
+            return ListSimStack<Idx>::bytes()
+                + last_pos_map.capacity()*sizeof(Idx);
+        }
+
     private:
         vector<Idx> last_pos_map;
 
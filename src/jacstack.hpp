@@ -25,22 +25,49 @@
 namespace MadOpt {
 using namespace std;
 
-class JacStack : public ListStack<Idx> {
+class JacStack final : public ListStack<Idx> {
     public:
-        void emplace_back(const Idx& id, const double& value);
+        void emplace_back(const Idx& id, const double& value){
+            if (stack_end == stack.size())
+                stack.resize(stack.size()+1);
+            StackElem& elem = stack[stack_end];
+            elem.id = id;
+            elem.value = value;
+            elem.conflict = getAndUpdateLastStackPos(id, stack_end);
+            if (positions_end == positions.size())
+                positions.resize(positions.size()+1);
+            positions[positions_end] = stack_end;
+            positions_end++;
+            stack_end++;
+        }
 
-        void setXSize(const Idx& size);
+        //! the last stack position of every variable
+        void setXSize(const Idx& size){
+            last_pos_map.resize(size);
+        }
 
-        void mulAll(const double& value);
+        std::size_t bytes()const {
+            return ListStack<Idx>::bytes() + last_pos_map.capacity()*sizeof(Idx);
+        }
 
     private:
         vector<Idx> last_pos_map;
 
-        void clearLastStackPos();
+        void clearLastStackPos(){
+            for (Idx i=1; i<stack_end; i++){
+                last_pos_map[stack[i].id] = 0;
+            }
+        }
 
-        Idx getAndUpdateLastStackPos(const Idx& id, const Idx& new_conflict_pos);
+        Idx getAndUpdateLastStackPos(const Idx& id, const Idx& new_conflict_pos){
+            Idx conflict=last_pos_map[id];
+            last_pos_map[id] = new_conflict_pos;
+            return conflict;
+        }
 
-        void setLastStackPos(const Idx& id, const Idx& conflict);
+        void setLastStackPos(const Idx& id, const Idx& conflict){
+            last_pos_map[id] = conflict;
+        }
 };
 
 
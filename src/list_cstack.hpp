@@ -17,6 +17,8 @@
 #ifndef MADOPT_LISTCSTACK
 #define MADOPT_LISTCSTACK
 
+#include <algorithm>
+
 #include "common.hpp"
 #include "logger.hpp"
 #include "array.hpp"
@@ -25,27 +27,73 @@ namespace MadOpt {
 
 class ListCStack{
     public:
-        ListCStack(): stack(1) {}
+        ListCStack(): stack(1), plan(nullptr), products_header(0) {}
 
+        //! merges the last nofelems lists with the next plan entries,
+        //\sa ListSimStack::merge()
         void merge(const Idx& nofelems){
             TRACE_START;
-            TRACE("conf elems", conflicts->str());
-            Idx& counter = conflicts->next();
-            for (Idx i=0; i<counter; i++){
-                Idx& to = conflicts->next();
-                Idx& from = conflicts->next();
-                ASSERT_BETWEEN(1, to, stack.size()-2, to, from);
-                ASSERT_BETWEEN(1, from, stack.size()-1);
-                ASSERT_LE(to, from);
-                TRACE("sol conf", to, from);
-                stack[to] += stack[from];
-                if (from != stack.size())
-                    stack[from] = stack.pop();
+            TRACE("plan", plan->str());
+            const Idx nof_removed = plan->next();
+            if (nof_removed){
+                const Idx nof_adds = products_header & 1 ? plan->next() : nof_removed;
+                for (Idx i=0; i<nof_adds; i++){
+                    const Idx& to = plan->next();
+                    const Idx& from = plan->next();
+                    ASSERT_BETWEEN(1, to, stack.size()-1, to, from);
+                    ASSERT_BETWEEN(1, from, stack.size()-1);
+                    stack[to] += stack[from];
+                }
+                const Idx nof_moves = plan->next();
+                for (Idx i=0; i<nof_moves; i++){
+                    const Idx& to = plan->next();
+                    const Idx& from = plan->next();
+                    ASSERT_LE(to, from);
+                    stack[to] = stack[from];
+                }
+                stack.pop(nof_removed);
             }
+            products_header = 0;
             positions.pop(nofelems-1);
             TRACE_END;
         }
 
+        /*! \brief starts the products of the next merge, \sa
+         * ListSimStack::merge()
+         * \return true if the products stay in place and are pushed, false
+         * if they are added with scatter()
+         */
+        bool beginProducts(const Idx& nof){
+            products_header = plan->next();
+            if ((products_header & 1) == 0)
+                return true;
+            for (Idx i=0; i<nof; i++)
+                stack.pushSave(0);
+            return false;
+        }
+
+        //! adds the next product to its destination
+        void scatter(const double& value){
+            stack[plan->next()] += value;
+        }
+
+        //! adds the products that count twice once more, factor(a, b) is
+        //the factor of the product of jac[a] and jac[b]
+        template<class F>
+        void addDoubled(const Array<double>& jac, const F& factor){
+            const Idx nof = products_header >> 1;
+            if (products_header & 1){
+                for (Idx i=0; i<nof; i++){
+                    const Idx& a = plan->next();
+                    const Idx& b = plan->next();
+                    stack[plan->next()] += jac[a]*jac[b]*factor(a, b);
+                }
+            } else {
+                for (Idx i=0; i<nof; i++)
+                    stack[plan->next()] *= 2;
+            }
+        }
+
         void mulAllLast(const double& value){
             for (Idx i=positions.back(1); i<stack.size(); i++)
                 stack[i] *= value;
@@ -56,13 +104,20 @@ class ListCStack{
                 stack[i] *= value;
         }
 
+        //! multiplies the pos-th last list with value
+        void mulList(const Idx& pos, const double& value){
+            const Idx end = pos == 1 ? stack.size() : positions.back(pos-1);
+            for (Idx i=positions.back(pos); i<end; i++)
+                stack[i] *= value;
+        }
+
         void emplace_back_empty(){
             positions.pushSave(stack.size());
         }
 
         void clear(){
             stack.clear();
-            stack.getEndAndPush();
+            stack.getEndAndPushSave();
             positions.clear();
         }
 
@@ -77,9 +132,8 @@ class ListCStack{
             TRACE_END;
         }
 
-        void setConflicts(Array<Idx>* c){
-            //ASSERT(c != nullptr);
-            conflicts = c;
+        void setPlan(Array<Idx>* p){
+            plan = p;
         }
 
         void emplace_back(const double& value){
@@ -89,9 +143,11 @@ class ListCStack{
             TRACE(value, stack.size(), stack.back());
         }
 
+        //! reserves the space for the evaluation, never shrinks, element 0
+        //is a sentinel hence at least 1
         void resize(const Idx& stack_size, const Idx& pos_size){
-            stack.resize(stack_size);
-            positions.resize(pos_size);
+            stack.grow(std::max(stack_size, (Idx)1));
+            positions.grow(pos_size);
         }
 
         const Array<double>& getStack()const {
@@ -116,6 +172,10 @@ class ListCStack{
             return positions.size();
         }
 
+        std::size_t bytes()const {
+            return stack.bytes() + positions.bytes();
+        }
+
         Idx stackSize()const {
             return stack.size()-1;
         }
@@ -135,7 +195,8 @@ class ListCStack{
     private:
         Array<double> stack;
         Array<Idx> positions;
-        Array<Idx>* conflicts;
+        Array<Idx>* plan;
+        Idx products_header;
 };
 }
 #endif
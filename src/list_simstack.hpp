@@ -28,7 +28,7 @@ namespace MadOpt {
 template<class T>
 class ListSimStack{
     public:
-        ListSimStack():stack(1), _max_size(0){}
+        ListSimStack():stack(1), products(0), _max_size(0){}
 
         virtual ~ListSimStack(){}
 
@@ -37,43 +37,120 @@ class ListSimStack{
             Idx conflict;
         };
 
+        /*! \brief merges the last nofelems lists and writes the evaluation
+         * plan of the merge
+         * \details the elements are merged like before, the last element
+         * of the same id moves to its earlier position and the top of the
+         * stack fills the hole. The plan describes the result instead of the
+         * steps, every element that is merged away is added directly to the
+         * element that holds its sum in the end (the carrier) and every
+         * carrier that does not stay in place is moved to its slot once:
+         *   products header, 2*nof doubled + 1 if the products are scattered
+         *   dest of every product if they are scattered
+         *   (i, k, dest) of each doubled product if they are scattered,
+         *   dest otherwise
+         *   number of removed elements
+         *   number of adds if the products are scattered, otherwise every
+         *   removed element is added
+         *   (to, from) of each add
+         *   number of moves
+         *   (to, from) of each move
+         * The products only exist if they were pushed since the last merge,
+         * the adds and moves only if elements are removed. No add reads a
+         * carrier and no move writes one, hence the order within each
+         * section does not matter.
+         */
         void merge(const Idx& nofelems){
             TRACE_START;
             ASSERT_LE(2, nofelems);
             ASSERT_LE(nofelems, positions.size());
             ASSERT_LE(positions.back(), stack.size());
-            Idx conflict_counter_pos = conflicts->getEndPosAndPush();
-            (*conflicts)[conflict_counter_pos] = 0;
-            const Idx& prev_start = positions.back(nofelems);
-            const Idx& last_start = positions.back(nofelems-1);
-            TRACE(str());
+            const Idx prev_start = positions.back(nofelems);
+            const Idx last_start = positions.back(nofelems-1);
+            const Idx end = stack.size();
+            const Idx products_start = end - products;
             TRACE("nof elems to merge=", nofelems,
                     "prev begin=", prev_start,
                     "last begin=", last_start);
             ASSERT_BETWEEN(1, prev_start, stack.size());
             ASSERT_BETWEEN(1, last_start, stack.size());
-            for (Idx i=stack.size()-1; i>=last_start; i--){
+            ASSERT_BETWEEN(last_start, products_start, end);
+            // slot i - last_start of both buffers belongs to stack position i
+            carrier.resize(end - last_start);
+            merged_into.assign(end - last_start, 0);
+            for (Idx i=last_start; i<end; i++)
+                carrier[i-last_start] = i;
+            for (Idx i=end-1; i>=last_start; i--){
                 auto& elem = stack[i];
                 if (prev_start <= elem.conflict){
-                    (*conflicts)[conflict_counter_pos]++;
-                    ASSERT_LE(1, (*conflicts)[conflict_counter_pos]);
-                    ASSERT_BETWEEN(1, elem.conflict, stack.size()-2);
+                    const Idx& to = elem.conflict;
+                    ASSERT_BETWEEN(1, to, stack.size()-2);
                     ASSERT_BETWEEN(1, i, stack.size()-1);
-                    ASSERT_LE(elem.conflict, i);
-                    conflicts->push(elem.conflict);
-                    conflicts->push(i);
-                    TRACE("ins conf", 
-                            "counter=", (*conflicts)[conflict_counter_pos], 
-                            "to=", elem.conflict, 
-                            "form=", i, 
-                            "nof confs=", conflicts->size());
-                    setLastStackPos(elem.id, elem.conflict);
-                    if (stack.size() != i){
-                        elem = stack.pop();
+                    ASSERT_LE(to, i);
+                    ASSERT_EQ(carrier[i-last_start], i);
+                    merged_into[i-last_start] = to < last_start ? to : carrier[to-last_start];
+                    TRACE("ins conf", "to=", to, "form=", i);
+                    setLastStackPos(elem.id, to);
+                    if (i != stack.size()-1){
+                        elem = stack.back();
+                        carrier[i-last_start] = carrier[stack.size()-1-last_start];
                         setLastStackPos(elem.id, i);
                     }
+                    stack.pop();
                 }
             }
+
+            bool scattered = false;
+            if (products){
+                // 2*nof doubled + 1 if the products are scattered
+                Idx header_pos = plan->getEndPosAndPush();
+                for (Idx i=products_start; i<end; i++){
+                    Idx dest = resolve(i, last_start);
+                    plan->push(dest);
+                    scattered |= dest != i;
+                }
+                (*plan)[header_pos] = 2*(doubled.size()/3) + scattered;
+                // the destinations are only needed if a product moves,
+                // otherwise the doubled products are doubled in place
+                if (!scattered)
+                    plan->pop(products);
+                for (Idx i=0; i<doubled.size(); i+=3){
+                    if (scattered){
+                        plan->push(doubled[i]);
+                        plan->push(doubled[i+1]);
+                    }
+                    plan->push(resolve(doubled[i+2], last_start));
+                }
+            }
+            // without removed elements there is nothing to add or move, only
+            // scattered products are removed without an add
+            plan->push(end - stack.size());
+            if (stack.size() != end){
+                Idx counter_pos = 0;
+                if (scattered){
+                    counter_pos = plan->getEndPosAndPush();
+                    (*plan)[counter_pos] = 0;
+                }
+                for (Idx i=last_start; i<products_start; i++){
+                    if (merged_into[i-last_start] != 0){
+                        if (scattered)
+                            (*plan)[counter_pos]++;
+                        plan->push(resolve(i, last_start));
+                        plan->push(i);
+                    }
+                }
+                counter_pos = plan->getEndPosAndPush();
+                (*plan)[counter_pos] = 0;
+                for (Idx i=last_start; i<stack.size(); i++){
+                    if (carrier[i-last_start] != i){
+                        (*plan)[counter_pos]++;
+                        plan->push(i);
+                        plan->push(carrier[i-last_start]);
+                    }
+                }
+            }
+            products = 0;
+            doubled.clear();
             positions.pop(nofelems-1);
             ASSERT_UEQ(positions.size(), 0);
             TRACE(str());
@@ -87,13 +164,15 @@ class ListSimStack{
 
         void clear(){
             clearLastStackPos();
+            products = 0;
+            doubled.clear();
             stack.clear();
             stack.getEndAndPushSave();
             positions.clear();
         }
 
-        void setConflicts(Array<Idx>* c){
-            conflicts = c;
+        void setPlan(Array<Idx>* p){
+            plan = p;
         }
 
         const Array<ListSimStackElem>& getStack()const {
@@ -114,6 +193,12 @@ class ListSimStack{
             return _max_size;
         }
 
+        virtual std::size_t bytes()const {
+            return stack.bytes() + positions.bytes()
+                + (carrier.capacity() + merged_into.capacity()
+                        + doubled.capacity())*sizeof(Idx);
+        }
+
         virtual string str(){
             if (positions.size() == 0)
                 return "-";
@@ -133,13 +218,32 @@ class ListSimStack{
     protected:
         Array<ListSimStackElem> stack;
         Array<Idx> positions;
-        Array<Idx>* conflicts;
+        Array<Idx>* plan;
+        //! number of products pushed since the last merge, they are the
+        //end of the last list
+        Idx products;
+        //! (jac pos, jac pos, stack pos) of the products that count twice
+        vector<Idx> doubled;
 
         Idx _max_size;
 
+        //! stack position of the carrier whose sum contains the element
+        //that was at pos before the merge
+        Idx resolve(Idx pos, const Idx& last_start)const {
+            while (pos >= last_start && merged_into[pos-last_start] != 0)
+                pos = merged_into[pos-last_start];
+            return pos;
+        }
+
         virtual void setLastStackPos(const T& id, const Idx& conflict)=0;
         virtual void clearLastStackPos()=0;
         virtual void setXSize(const Idx&)=0;
+
+    private:
+        //! merge buffers, the carrier of each position of the last list and
+        //the carrier each element is merged into, 0 if it is a carrier
+        vector<Idx> carrier;
+        vector<Idx> merged_into;
 };
 }
 #endif
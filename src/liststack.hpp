@@ -75,6 +75,19 @@ class ListStack {
             TRACE_END;
         }
 
+        //! multiplies the last list with value
+        void mulAll(const double& value){
+            for (Idx i=getLast(); i<stack_end; i++)
+                stack[i].value *= value;
+        }
+
+        //! multiplies the pos-th last list with value
+        void mulList(const Idx& pos, const double& value){
+            const Idx end = pos == 1 ? stack_end : positions[positions_end-pos+1];
+            for (Idx i=positions[positions_end-pos]; i<end; i++)
+                stack[i].value *= value;
+        }
+
         const vector<StackElem>& getStack(){
             return stack;
         }
@@ -140,6 +153,11 @@ class ListStack {
 
         virtual void setXSize(const Idx& size)=0;
 
+        //! allocated heap memory
+        std::size_t bytes()const {
+            return stack.capacity()*sizeof(StackElem) + positions.capacity()*sizeof(Idx);
+        }
+
     protected:
         vector<StackElem> stack;
         vector<Idx> positions;
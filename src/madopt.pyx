@@ -14,8 +14,13 @@
 # limitations under the License.
 #
 import signal
+import concurrent.futures
+import numpy
 from libcpp.string cimport string
+from libcpp.vector cimport vector
 from libcpp cimport bool
+from cpython.ref cimport Py_INCREF, Py_DECREF
+from cpython.buffer cimport PyBUF_WRITABLE
 
 
 signal.signal(signal.SIGINT, signal.SIG_DFL)
@@ -39,6 +44,7 @@ cdef extern from "model.hpp":
         Expr_& operator-()
         string toString()
         double xe "x"()
+        char getType()
 
     cdef Expr_ esin "MadOpt::sin" (Expr_&)
 
@@ -50,6 +56,22 @@ cdef extern from "model.hpp":
 
     cdef Expr_ epow "MadOpt::pow" (Expr_&, double)
 
+cdef extern from "expr_array.hpp":
+    cdef Expr_ asum "MadOpt::sum" (const vector[Expr_]&)
+    cdef Expr_ adot "MadOpt::dot" (const double*, const vector[Expr_]&)
+    cdef Expr_ asumsq "MadOpt::sumsq" (const vector[Expr_]&)
+    cdef vector[Expr_] aadd "MadOpt::add" (const vector[Expr_]&, const vector[Expr_]&) except +
+    cdef vector[Expr_] aaddc "MadOpt::add" (const vector[Expr_]&, const double*)
+    cdef vector[Expr_] amul "MadOpt::mul" (const vector[Expr_]&, const vector[Expr_]&) except +
+    cdef vector[Expr_] amulc "MadOpt::mul" (const vector[Expr_]&, const double*)
+    cdef vector[Expr_] adiv "MadOpt::div" (const vector[Expr_]&, const vector[Expr_]&) except +
+    cdef vector[Expr_] apow "MadOpt::pow" (const vector[Expr_]&, double)
+    cdef vector[Expr_] asin "MadOpt::sin" (const vector[Expr_]&)
+    cdef vector[Expr_] acos "MadOpt::cos" (const vector[Expr_]&)
+    cdef vector[Expr_] aln "MadOpt::ln" (const vector[Expr_]&)
+    cdef vector[Expr_] alog2 "MadOpt::log2" (const vector[Expr_]&)
+
+cdef extern from "model.hpp":
     cdef cppclass Var_ "MadOpt::Var"(Expr_):
         Var_()
         bool fixed()
@@ -76,39 +98,197 @@ cdef extern from "model.hpp":
         double lam()
         void lb(double)
         void ub(double)
+        const string& tag()
+        void tag(const string&)
+
+    cdef cppclass Solution_ "MadOpt::Solution":
+        const vector[double]& getX()
+        const vector[double]& getLam()
+        const vector[double]& getZ_L()
+        const vector[double]& getZ_U()
+
+    cdef cppclass Evaluation_ "MadOpt::Evaluation":
+        double f
+        vector[double] grad_f
+        vector[double] g
+        vector[double] jac
+        vector[int] jac_row
+        vector[int] jac_col
+        vector[double] hess
+        vector[int] hess_row
+        vector[int] hess_col
+
+    cdef cppclass SolveCounter_ "MadOpt::SolveStats::Counter":
+        unsigned long calls
+        double seconds
+
+    cdef cppclass SolveStats_ "MadOpt::SolveStats":
+        SolveCounter_ eval_f
+        SolveCounter_ eval_grad_f
+        SolveCounter_ eval_g
+        SolveCounter_ eval_jac_g
+        SolveCounter_ eval_h
+        SolveCounter_ structure
+        SolveCounter_ set_evals
+        SolveCounter_ solve
+        long iterations
+        double solver_seconds
+        double callbackSeconds()
+
+    cdef cppclass MemoryEntry_ "MadOpt::MemoryReport::Entry":
+        string name
+        size_t objects
+        size_t bytes
+        size_t max_bytes
+        double mean()
+
+    cdef cppclass MemoryReport_ "MadOpt::MemoryReport":
+        vector[MemoryEntry_] entries
+        size_t total()
+        string str()
+
+    cdef cppclass TapeInfo_ "MadOpt::TapeInfo":
+        unsigned int operators
+        unsigned int jac_nnz
+        unsigned int hess_nnz
+        unsigned int plan
+        unsigned int max_stack
+        size_t shape
+
+    cdef cppclass ConstraintProfile_ "MadOpt::ConstraintProfile":
+        string name
+        string tag
+        unsigned int rows
+        long example
+        unsigned long calls
+        double seconds
+        double build_seconds
+        TapeInfo_ tape
+
+    cdef cppclass PolynomialStats_ "MadOpt::PolynomialStats":
+        unsigned int expressions
+        unsigned int operators_before
+        unsigned int operators_after
+        double saved()
+
+    cdef enum ProfilerGroup_ "MadOpt::Profiler::Group":
+        PROFILER_ROW "MadOpt::Profiler::ROW"
+        PROFILER_TAG "MadOpt::Profiler::TAG"
+        PROFILER_SHAPE "MadOpt::Profiler::SHAPE"
 
     cdef cppclass Model_ "MadOpt::Model":
-        void solAsInit()
+        void solAsInit() nogil
         bool show_solver
         double timelimit
-        void solve()
+        void solve() except + nogil
         int status()
         double objValue()
         Var_ addCVar(double, double, double, string)
         Var_ addIVar(double, double, double, string)
         Var_ addBVar(double, string)
         Param_ addParam(double, string)
+        vector[Var_] addVars(int, const double*, const double*, const double*, string)
+        int addLinearConstrs(int, const int*, const int*, const double*,
+                const double*, const double*) except + nogil
         void setNumericOption(string, double)
         void setIntegerOption(string, int)
         void setStringOption(string, string)
-        void setObj(Expr_&)
+        void setObj(Expr_&) except + nogil
         int nx()
         int ng()
         int np()
-        Constraint_ addConstr(double, Expr_&, double)
+        Constraint_ addConstr(double, Expr_&, double) except + nogil
         bool hasSolution()
-
-ctypedef double (*g_type)(void *param, void *g_data)
+        Solution_& getSolution()
+        void setInits(const double*) except + nogil
+        void setVarBounds(const double*, const double*) except + nogil
+        void setConstrBounds(const double*, const double*) except + nogil
+        void evaluate(const double*, double, const double*) except + nogil
+        const Evaluation_& getEvaluation()
+        const SolveStats_& stats()
+        MemoryReport_ memoryReport()
+        void finalize()
+        bool isFinalized()
+        void enableProfiling(bool, unsigned int) except +
+        bool profilingEnabled()
+        void clearProfile()
+        vector[ConstraintProfile_] profile(unsigned int, ProfilerGroup_)
+        string profileString(unsigned int, ProfilerGroup_)
+        int addCallbackConstrs(CallbackBlock_*, const double*, const double*) except +
+        void canonicalisePolynomials(bool)
+        bool canonicalisingPolynomials()
+        const PolynomialStats_& polynomialStats()
+
+ctypedef bool (*block_callback_type)(void *data, const double *x, unsigned int nx,
+        double *g, double *jac, double *hess) noexcept
 
 cdef extern from "python_callback.hpp":
-    cdef cppclass PythonCallback:
-        PythonCallback(g_type gtype, void *g_data)
-
-cdef double callback_template(void *parameter, void *method):
-    return (<object>method)(<object>parameter)
+    cdef cppclass CallbackBlock_ "MadOpt::CallbackBlock":
+        CallbackBlock_(int, int, const int*, const int*,
+                int, const int*, const int*, const int*,
+                block_callback_type, void*) except +
 
 INFINITY = INF
 
+cdef class ArrayView:
+    """buffer over memory owned by a Model, keeps the model alive"""
+    cdef object owner
+    cdef const void* data
+    cdef Py_ssize_t shape[1]
+    cdef Py_ssize_t itemsize
+    cdef bytes format
+    cdef bint writable
+
+    def __getbuffer__(self, Py_buffer* buffer, int flags):
+        if flags & PyBUF_WRITABLE and not self.writable:
+            raise BufferError('madopt arrays are read only')
+        buffer.buf = <void*>self.data
+        buffer.format = self.format
+        buffer.internal = NULL
+        buffer.itemsize = self.itemsize
+        buffer.len = self.shape[0]*self.itemsize
+        buffer.ndim = 1
+        buffer.obj = self
+        buffer.readonly = not self.writable
+        buffer.shape = self.shape
+        buffer.strides = &self.itemsize
+        buffer.suboffsets = NULL
+
+    def __releasebuffer__(self, Py_buffer* buffer):
+        pass
+
+cdef double empty_data[1]
+
+cdef object pointer_view(object owner, const void* data, Py_ssize_t size,
+        Py_ssize_t itemsize, bytes format, bint writable=False):
+    view = ArrayView()
+    view.owner = owner
+    view.data = <const void*>empty_data
+    if size > 0:
+        view.data = data
+    view.shape[0] = size
+    view.itemsize = itemsize
+    view.format = format
+    view.writable = writable
+    return numpy.asarray(view)
+
+cdef object double_view(object owner, const vector[double]& v):
+    return pointer_view(owner, v.data(), v.size(), sizeof(double), b'd')
+
+cdef object int_view(object owner, const vector[int]& v):
+    return pointer_view(owner, v.data(), v.size(), sizeof(int), b'i')
+
+cdef const int* int_ptr(const int[::1] v):
+    if v.shape[0] == 0:
+        return NULL
+    return &v[0]
+
+cdef const double[::1] as_doubles(values, Py_ssize_t size):
+    cdef const double[::1] res = numpy.ascontiguousarray(values, dtype=numpy.float64)
+    if res.shape[0] != size:
+        raise ValueError('expected %d values, got %d' % (size, res.shape[0]))
+    return res
+
 def convert(e):
     if isinstance(e, (float, int)):
         return Expr(e)
@@ -191,25 +371,183 @@ cdef class Expr:
         return self.toString().decode("UTF-8")
 
 
-def sin(Expr ip):
+def sin(ip):
+    cdef Expr e_ip
+    if isinstance(ip, ExprArray):
+        return wrap_array(asin((<ExprArray>ip).exprs))
+    e_ip = ip
     e = Expr()
-    e.expr_ = esin(ip.expr_)
+    e.expr_ = esin(e_ip.expr_)
     return e
 
 
-def cos(Expr ip):
+def cos(ip):
+    cdef Expr e_ip
+    if isinstance(ip, ExprArray):
+        return wrap_array(acos((<ExprArray>ip).exprs))
+    e_ip = ip
     e = Expr()
-    e.expr_ = ecos(ip.expr_)
+    e.expr_ = ecos(e_ip.expr_)
     return e
 
-def ln(Expr ip):
+def ln(ip):
+    cdef Expr e_ip
+    if isinstance(ip, ExprArray):
+        return wrap_array(aln((<ExprArray>ip).exprs))
+    e_ip = ip
     e = Expr()
-    e.expr_ = eln(ip.expr_)
+    e.expr_ = eln(e_ip.expr_)
     return e
 
-def log2(Expr ip):
+def log2(ip):
+    cdef Expr e_ip
+    if isinstance(ip, ExprArray):
+        return wrap_array(alog2((<ExprArray>ip).exprs))
+    e_ip = ip
     e = Expr()
-    e.expr_ = elog2(ip.expr_)
+    e.expr_ = elog2(e_ip.expr_)
+    return e
+
+# expression arrays
+#
+#
+cdef object wrap_expr(const Expr_& expr):
+    if expr.getType() == 0:
+        e = Var()
+    else:
+        e = Expr()
+    (<Expr>e).expr_ = expr
+    return e
+
+cdef ExprArray wrap_array(vector[Expr_] exprs):
+    cdef ExprArray res = ExprArray.__new__(ExprArray)
+    res.exprs.swap(exprs)
+    return res
+
+cdef vector[Expr_] as_exprs(obj, Py_ssize_t size) except *:
+    cdef vector[Expr_] res
+    if isinstance(obj, ExprArray):
+        res = (<ExprArray>obj).exprs
+        if <Py_ssize_t>res.size() != size:
+            raise ValueError('expected %d expressions, got %d' % (size, res.size()))
+    else:
+        res.assign(size, (<Expr?>obj).expr_)
+    return res
+
+cdef const double[::1] broadcast_doubles(values, Py_ssize_t size):
+    return as_doubles(numpy.broadcast_to(numpy.asarray(values, dtype=numpy.float64), (size,)), size)
+
+cdef bint is_expr(obj):
+    return isinstance(obj, (Expr, ExprArray))
+
+cdef object array_op(a, b, char op):
+    cdef Py_ssize_t n = len(a) if isinstance(a, ExprArray) else len(b)
+    cdef vector[Expr_] ea
+    cdef vector[Expr_] eb
+    cdef const double[::1] c
+    if op == b'-':
+        if is_expr(b):
+            b = array_op(b, -1.0, b'*')
+        else:
+            b = -numpy.asarray(b, dtype=numpy.float64)
+        op = b'+'
+    elif op == b'/':
+        if is_expr(b):
+            if not is_expr(a):
+                return array_op(b**-1, a, b'*')
+            ea = as_exprs(a, n)
+            eb = as_exprs(b, n)
+            return wrap_array(adiv(ea, eb))
+        b = 1.0/numpy.asarray(b, dtype=numpy.float64)
+        op = b'*'
+
+    if not is_expr(a):
+        a, b = b, a
+    ea = as_exprs(a, n)
+    if is_expr(b):
+        eb = as_exprs(b, n)
+        return wrap_array(aadd(ea, eb) if op == b'+' else amul(ea, eb))
+    c = broadcast_doubles(b, n)
+    if n == 0:
+        return wrap_array(ea)
+    return wrap_array(aaddc(ea, &c[0]) if op == b'+' else amulc(ea, &c[0]))
+
+cdef class ExprArray:
+    """one dimensional array of expressions, the elementwise operations,
+    sum(), dot() and sumsq() are executed in C++ with one call per array"""
+    cdef vector[Expr_] exprs
+
+    __array_ufunc__ = None
+
+    def __len__(self):
+        return self.exprs.size()
+
+    def __getitem__(self, idx):
+        cdef vector[Expr_] res
+        if isinstance(idx, slice):
+            for i in range(*idx.indices(self.exprs.size())):
+                res.push_back(self.exprs[i])
+            return wrap_array(res)
+        i = int(idx)
+        if i < 0:
+            i += self.exprs.size()
+        if i < 0 or i >= <Py_ssize_t>self.exprs.size():
+            raise IndexError('ExprArray index out of range')
+        return wrap_expr(self.exprs[i])
+
+    def __add__(self, other):
+        return array_op(self, other, b'+')
+
+    def __radd__(self, other):
+        return array_op(other, self, b'+')
+
+    def __sub__(self, other):
+        return array_op(self, other, b'-')
+
+    def __rsub__(self, other):
+        return array_op(other, self, b'-')
+
+    def __mul__(self, other):
+        return array_op(self, other, b'*')
+
+    def __rmul__(self, other):
+        return array_op(other, self, b'*')
+
+    def __truediv__(self, other):
+        return array_op(self, other, b'/')
+
+    def __rtruediv__(self, other):
+        return array_op(other, self, b'/')
+
+    def __div__(self, other):
+        return array_op(self, other, b'/')
+
+    def __neg__(self):
+        return array_op(self, -1.0, b'*')
+
+    def __pow__(ExprArray self, double expo, mod):
+        return wrap_array(apow(self.exprs, expo))
+
+    def sum(self):
+        e = Expr()
+        e.expr_ = asum(self.exprs)
+        return e
+
+    def __str__(self):
+        return '[' + ', '.join(str(self[i]) for i in range(len(self))) + ']'
+
+def dot(c, ExprArray x):
+    """sum of c[i]*x[i]"""
+    cdef const double[::1] c_ = broadcast_doubles(c, len(x))
+    e = Expr()
+    if len(x) > 0:
+        e.expr_ = adot(&c_[0], x.exprs)
+    return e
+
+def sumsq(ExprArray x):
+    """sum of x[i]**2"""
+    e = Expr()
+    e.expr_ = asumsq(x.exprs)
     return e
 
 cdef class Var(Expr):
@@ -287,21 +625,98 @@ cdef class Constraint:
     def lam(self):
         return self.constraint_.lam()
 
-cdef class CustomConstraint:
-    def __init__(self, g_func, jac_func, hess_func):
-        self.g_func = g_func
-        self.jac_func = jac_func
-        self.hess_func = hess_func
+    property tag:
+        """constraints with the same tag are aggregated by
+        Model.profile(group="tag")"""
+        def __get__(self):
+            return self.constraint_.tag().decode('UTF-8')
+
+        def __set__(self, tag):
+            self.constraint_.tag(tag.encode('UTF-8'))
+
+cdef class CallbackConstraints:
+    """block of constraints that is evaluated by one python function
+    func(x, g, jac, hess), it is called once per new x and fills the numpy
+    arrays g, jac and hess in place. x is a copy that func may keep, g, jac
+    and hess refer to the solver buffers and are only valid inside the call,
+    \sa Model.addCallbackConstrs"""
+    cdef object func
+    cdef int rows
+    cdef int nnz_jac
+    cdef int nnz_hess
+    cdef object error
+
+    def __cinit__(self, func, int rows, int nnz_jac, int nnz_hess):
+        self.func = func
+        self.rows = rows
+        self.nnz_jac = nnz_jac
+        self.nnz_hess = nnz_hess
+        self.error = None
+
+cdef bool block_callback(void *data, const double *x, unsigned int nx,
+        double *g, double *jac, double *hess) noexcept with gil:
+    cdef CallbackConstraints block = <CallbackConstraints>data
+    try:
+        # x is copied as func may keep it, the solver reuses its buffer
+        block.func(numpy.array(pointer_view(block, x, nx, sizeof(double), b'd')),
+                pointer_view(block, g, block.rows, sizeof(double), b'd', True),
+                pointer_view(block, jac, block.nnz_jac, sizeof(double), b'd', True),
+                pointer_view(block, hess, block.nnz_hess, sizeof(double), b'd', True))
+        return True
+    except BaseException as e:
+        block.error = e
+        return False
+
+cdef dict counter_dict(const SolveCounter_& c):
+    return {"calls": c.calls, "seconds": c.seconds}
+
+cdef ProfilerGroup_ profiler_group(group) except *:
+    if group == "row":
+        return PROFILER_ROW
+    if group == "tag":
+        return PROFILER_TAG
+    if group == "shape":
+        return PROFILER_SHAPE
+    raise ValueError("unknown profile group " + str(group))
+
+cdef dict profile_dict(const ConstraintProfile_& p):
+    return {"name": p.name.decode('UTF-8'),
+            "tag": p.tag.decode('UTF-8'),
+            "rows": p.rows,
+            "example": p.example,
+            "calls": p.calls,
+            "seconds": p.seconds,
+            "build_seconds": p.build_seconds,
+            "operators": p.tape.operators,
+            "jac_nnz": p.tape.jac_nnz,
+            "hess_nnz": p.tape.hess_nnz,
+            "plan": p.tape.plan,
+            "max_stack": p.tape.max_stack}
 
 cdef class Model:
     cdef Model_* model_
+    cdef list callbacks
 
     def __init__(self, timelimit=-1, show_solver=False):
         self.model_.show_solver = show_solver
         self.model_.timelimit = timelimit
+        self.callbacks = []
 
     def solve(self):
-        self.model_.solve()
+        try:
+            with nogil:
+                self.model_.solve()
+        except RuntimeError:
+            self._raiseCallbackError()
+            raise
+        self._raiseCallbackError()
+
+    def _raiseCallbackError(self):
+        cdef CallbackConstraints block
+        for block in self.callbacks:
+            if block.error is not None:
+                error, block.error = block.error, None
+                raise error
 
     # add Variables
     #
@@ -330,6 +745,24 @@ cdef class Model:
         e.expr_ = self.model_.addBVar(init, name.encode('UTF-8'))
         return e
 
+    def addVars(self, int n, lb=-INF, ub=INF, init=None, name='v'):
+        """adds n continuous variables and returns them as ExprArray"""
+        cdef const double[::1] lb_ = broadcast_doubles(lb, n)
+        cdef const double[::1] ub_ = broadcast_doubles(ub, n)
+        cdef const double[::1] init_
+        cdef vector[Var_] vars_
+        cdef vector[Expr_] exprs
+        if init is None:
+            init = numpy.clip(0.0, lb_, ub_)
+        init_ = broadcast_doubles(init, n)
+        if n == 0:
+            return ExprArray()
+        vars_ = self.model_.addVars(n, &lb_[0], &ub_[0], &init_[0], name.encode('UTF-8'))
+        exprs.reserve(n)
+        for i in range(n):
+            exprs.push_back(vars_[i])
+        return wrap_array(exprs)
+
     # add Param
     #
     #
@@ -343,16 +776,84 @@ cdef class Model:
     #
     #
     def setObj(self, Expr expr):
-        self.model_.setObj(expr.expr_)
+        with nogil:
+            self.model_.setObj(expr.expr_)
 
     # add Constraint
     #
     #
     def addConstr(self, Expr expr, double lb=-INFINITY, double ub=INFINITY):
+        cdef Constraint_ constraint
+        with nogil:
+            constraint = self.model_.addConstr(lb, expr.expr_, ub)
         c = Constraint()
-        c.constraint_ = self.model_.addConstr(lb, expr.expr_, ub)
+        c.constraint_ = constraint
         return c
 
+    def addLinearConstrs(self, A, lb=-INF, ub=INF):
+        """adds lb <= A*x <= ub where x are all variables of the model, A is
+        a scipy.sparse.csr_matrix or a tuple (indptr, indices, data) in CSR
+        format. Returns the range of the added constraint positions."""
+        if isinstance(A, tuple):
+            indptr, indices, data = A
+        else:
+            indptr, indices, data = A.indptr, A.indices, A.data
+        cdef const int[::1] indptr_ = numpy.ascontiguousarray(indptr, dtype=numpy.intc)
+        cdef const int[::1] indices_ = numpy.ascontiguousarray(indices, dtype=numpy.intc)
+        cdef const double[::1] data_ = as_doubles(data, indices_.shape[0])
+        cdef int rows = indptr_.shape[0] - 1
+        cdef const double[::1] lb_ = broadcast_doubles(lb, rows)
+        cdef const double[::1] ub_ = broadcast_doubles(ub, rows)
+        cdef int first = self.model_.ng()
+        if rows <= 0:
+            return range(first, first)
+        if indptr_[0] < 0 or indptr_[rows] > indices_.shape[0]:
+            raise ValueError('indptr of A refers to %d..%d but A has %d entries'
+                    % (indptr_[0], indptr_[rows], indices_.shape[0]))
+        if indices_.shape[0] == 0:
+            indices_ = numpy.zeros(1, dtype=numpy.intc)
+            data_ = numpy.zeros(1)
+        with nogil:
+            first = self.model_.addLinearConstrs(rows, &indptr_[0], &indices_[0],
+                    &data_[0], &lb_[0], &ub_[0])
+        return range(first, first + rows)
+
+    def addCallbackConstrs(self, func, jac, hess=None, lb=-INF, ub=INF, rows=None):
+        """adds a block of constraints lb <= g(x) <= ub that is evaluated by
+        func(x, g, jac, hess). x are all variable values, func writes the
+        constraint values into g, the jacobian values in the order of
+        jac=(rows, cols) into jac and the second derivatives of the single
+        constraints in the order of hess=(rows, i, j) into hess. Without a
+        hess pattern the hessian is assumed to be zero. x is a copy, g, jac
+        and hess must not be used after func returns. Returns the range of
+        the added constraint positions."""
+        if hess is None:
+            hess = ([], [], [])
+        cdef const int[::1] jac_rows = numpy.ascontiguousarray(jac[0], dtype=numpy.intc)
+        cdef const int[::1] jac_cols = numpy.ascontiguousarray(jac[1], dtype=numpy.intc)
+        cdef const int[::1] hess_rows = numpy.ascontiguousarray(hess[0], dtype=numpy.intc)
+        cdef const int[::1] hess_i = numpy.ascontiguousarray(hess[1], dtype=numpy.intc)
+        cdef const int[::1] hess_j = numpy.ascontiguousarray(hess[2], dtype=numpy.intc)
+        if jac_rows.shape[0] != jac_cols.shape[0]:
+            raise ValueError('jacobian pattern rows and cols differ in size')
+        if hess_rows.shape[0] != hess_i.shape[0] or hess_rows.shape[0] != hess_j.shape[0]:
+            raise ValueError('hessian pattern rows, i and j differ in size')
+        if rows is None:
+            rows = numpy.max(jac_rows) + 1 if jac_rows.shape[0] > 0 else 0
+        cdef const double[::1] lb_ = broadcast_doubles(lb, rows)
+        cdef const double[::1] ub_ = broadcast_doubles(ub, rows)
+        if rows == 0:
+            return range(self.model_.ng(), self.model_.ng())
+
+        block = CallbackConstraints(func, rows, jac_rows.shape[0], hess_rows.shape[0])
+        cdef CallbackBlock_* block_ = new CallbackBlock_(rows,
+                jac_rows.shape[0], int_ptr(jac_rows), int_ptr(jac_cols),
+                hess_rows.shape[0], int_ptr(hess_rows), int_ptr(hess_i), int_ptr(hess_j),
+                block_callback, <void*>block)
+        first = self.model_.addCallbackConstrs(block_, &lb_[0], &ub_[0])
+        self.callbacks.append(block)
+        return range(first, first + rows)
+
     def addEqConstr(self, Expr expr, double eq=0):
         return self.addConstr(expr, lb=eq, ub=eq)
 
@@ -376,7 +877,120 @@ cdef class Model:
         return self.model_.status()
 
     def solAsInit(self):
-        self.model_.solAsInit()
+        with nogil:
+            self.model_.solAsInit()
+
+    # arrays, read only views that are valid until the next solve/evaluate
+    #
+    #
+    def _checkSolution(self):
+        if not self.model_.hasSolution():
+            raise RuntimeError('trying to access solution but non is loaded')
+
+    @property
+    def x(self):
+        self._checkSolution()
+        return double_view(self, self.model_.getSolution().getX())
+
+    @property
+    def lam(self):
+        self._checkSolution()
+        return double_view(self, self.model_.getSolution().getLam())
+
+    @property
+    def z_L(self):
+        self._checkSolution()
+        return double_view(self, self.model_.getSolution().getZ_L())
+
+    @property
+    def z_U(self):
+        self._checkSolution()
+        return double_view(self, self.model_.getSolution().getZ_U())
+
+    def evaluate(self, x=None, double obj_factor=1.0, lam=None):
+        """evaluates the model at x (default the solution if loaded,
+        otherwise the init values), the results are available via f, grad_f,
+        g, jac, jac_row, jac_col, hess, hess_row and hess_col"""
+        cdef const double[::1] x_
+        cdef const double[::1] lam_
+        cdef const double* lam_ptr = NULL
+        if x is None:
+            if self.model_.hasSolution():
+                x = self.x
+            else:
+                raise ValueError('x is needed if no solution is loaded')
+        x_ = as_doubles(x, self.model_.nx())
+        if lam is not None:
+            lam_ = as_doubles(lam, self.model_.ng())
+            if lam_.shape[0] > 0:
+                lam_ptr = &lam_[0]
+        if x_.shape[0] == 0:
+            return
+        try:
+            with nogil:
+                self.model_.evaluate(&x_[0], obj_factor, lam_ptr)
+        except RuntimeError:
+            self._raiseCallbackError()
+            raise
+
+    @property
+    def f(self):
+        return self.model_.getEvaluation().f
+
+    @property
+    def grad_f(self):
+        return double_view(self, self.model_.getEvaluation().grad_f)
+
+    @property
+    def g(self):
+        return double_view(self, self.model_.getEvaluation().g)
+
+    @property
+    def jac(self):
+        return double_view(self, self.model_.getEvaluation().jac)
+
+    @property
+    def jac_row(self):
+        return int_view(self, self.model_.getEvaluation().jac_row)
+
+    @property
+    def jac_col(self):
+        return int_view(self, self.model_.getEvaluation().jac_col)
+
+    @property
+    def hess(self):
+        return double_view(self, self.model_.getEvaluation().hess)
+
+    @property
+    def hess_row(self):
+        return int_view(self, self.model_.getEvaluation().hess_row)
+
+    @property
+    def hess_col(self):
+        return int_view(self, self.model_.getEvaluation().hess_col)
+
+    # bulk setters
+    #
+    #
+    def setInits(self, x):
+        cdef const double[::1] x_ = as_doubles(x, self.model_.nx())
+        if x_.shape[0] > 0:
+            with nogil:
+                self.model_.setInits(&x_[0])
+
+    def setVarBounds(self, lb, ub):
+        cdef const double[::1] lb_ = as_doubles(lb, self.model_.nx())
+        cdef const double[::1] ub_ = as_doubles(ub, self.model_.nx())
+        if lb_.shape[0] > 0:
+            with nogil:
+                self.model_.setVarBounds(&lb_[0], &ub_[0])
+
+    def setConstrBounds(self, lb, ub):
+        cdef const double[::1] lb_ = as_doubles(lb, self.model_.ng())
+        cdef const double[::1] ub_ = as_doubles(ub, self.model_.ng())
+        if lb_.shape[0] > 0:
+            with nogil:
+                self.model_.setConstrBounds(&lb_[0], &ub_[0])
 
     # get info
     #
@@ -411,6 +1025,97 @@ cdef class Model:
         def __get__(self):
             return self.model_.hasSolution()
 
+    property stats:
+        """statistics of the last solve as dict, every counter is a dict with
+        calls and seconds, iterations and solver_seconds are -1 if unknown.
+        The counters stay 0 if madopt is built without ENABLE_STATS"""
+        def __get__(self):
+            cdef const SolveStats_* s = &self.model_.stats()
+            return {"eval_f": counter_dict(s.eval_f),
+                    "eval_grad_f": counter_dict(s.eval_grad_f),
+                    "eval_g": counter_dict(s.eval_g),
+                    "eval_jac_g": counter_dict(s.eval_jac_g),
+                    "eval_h": counter_dict(s.eval_h),
+                    "structure": counter_dict(s.structure),
+                    "set_evals": counter_dict(s.set_evals),
+                    "solve": counter_dict(s.solve),
+                    "callback_seconds": s.callbackSeconds(),
+                    "iterations": s.iterations,
+                    "solver_seconds": s.solver_seconds}
+
+    def memoryReport(self):
+        """bytes used by the model as dict name: {objects, bytes, mean, max},
+        the constraint fields are reported per constraint, "total" is the
+        sum of all entries"""
+        cdef MemoryReport_ report = self.model_.memoryReport()
+        res = {}
+        for e in report.entries:
+            res[e.name.decode('UTF-8')] = {"objects": e.objects,
+                    "bytes": e.bytes,
+                    "mean": e.mean(),
+                    "max": e.max_bytes}
+        res["total"] = report.total()
+        return res
+
+    def finalize(self):
+        """frees the memory that is only needed while adding constraints,
+        solve() calls it, adding a constraint afterwards is still possible"""
+        self.model_.finalize()
+
+    property finalized:
+        def __get__(self):
+            return self.model_.isFinalized()
+
+    # Profiling
+    #
+    #
+    def enableProfiling(self, bool on=True, unsigned int every=1):
+        """times the evaluation of every single constraint in every n-th
+        evaluation, see profile()"""
+        self.model_.enableProfiling(on, every)
+
+    property profiling:
+        def __get__(self):
+            return self.model_.profilingEnabled()
+
+    def clearProfile(self):
+        self.model_.clearProfile()
+
+    def profile(self, unsigned int top=10, group="row"):
+        """the top most expensive constraints and the objective as list of
+        dicts sorted by seconds, group is "row", "tag" or "shape", top=0
+        returns all"""
+        cdef ProfilerGroup_ g = profiler_group(group)
+        return [profile_dict(p) for p in self.model_.profile(top, g)]
+
+    def profileString(self, unsigned int top=10, group="row"):
+        cdef ProfilerGroup_ g = profiler_group(group)
+        return self.model_.profileString(top, g).decode('UTF-8')
+
+    # Polynomials
+    #
+    #
+    def canonicalisePolynomials(self, bool on=True):
+        """rewrites the polynomials of the constraints and of the objective
+        that are added from now on: identical monomials are collected and
+        univariate polynomials written in Horner form, see polynomialStats"""
+        self.model_.canonicalisePolynomials(on)
+
+    property canonicalising_polynomials:
+        def __get__(self):
+            return self.model_.canonicalisingPolynomials()
+
+    property polynomialStats:
+        """tape operators of the rewritten expressions as dict
+        expressions, operators_before, operators_after and saved, the saved
+        fraction of the operators"""
+        def __get__(self):
+            cdef const PolynomialStats_* s = &self.model_.polynomialStats()
+            return {"expressions": s.expressions,
+                    "operators_before": s.operators_before,
+                    "operators_after": s.operators_after,
+                    "saved": s.saved()}
+
     # set Option
     #
     #
@@ -446,4 +1151,87 @@ cdef class BonminModel(Model):
     def __dealloc__(self):
         del self.model_
 
+ctypedef void (*done_type)(void *data, const char *error)
+
+cdef extern from "solve_executor.hpp":
+    cdef cppclass SolveExecutor_ "MadOpt::SolveExecutor":
+        SolveExecutor_(int, int) except +
+        void submit(Model_&, double, done_type, void*) except + nogil
+        int nofWorkers()
+        int nofQueued()
+
+cdef void executor_done(void *data, const char *error) noexcept with gil:
+    job = <object>data
+    Py_DECREF(job)
+    future, model = job
+    if error == NULL:
+        future.set_result(model)
+    else:
+        future.set_exception(RuntimeError(error.decode('UTF-8')))
+
+cdef class SolveExecutor:
+    """Pool of worker threads that solves independent models, submit()
+    returns a concurrent.futures.Future that resolves to the solved model.
+    A submitted model must not be used until its future is done."""
+    cdef SolveExecutor_* executor_
+
+    def __cinit__(self, int workers=1, int max_queued=0):
+        self.executor_ = new SolveExecutor_(workers, max_queued)
+
+    def __dealloc__(self):
+        with nogil:
+            del self.executor_
+
+    def submit(self, Model model, double timelimit=-1):
+        cdef Model_* model_ = model.model_
+        cdef void* data
+        future = concurrent.futures.Future()
+        future.set_running_or_notify_cancel()
+        job = (future, model)
+        data = <void*>job
+        Py_INCREF(job)
+        try:
+            with nogil:
+                self.executor_.submit(model_[0], timelimit, executor_done, data)
+        except:
+            Py_DECREF(job)
+            raise
+        return future
+
+    property workers:
+        def __get__(self):
+            return self.executor_.nofWorkers()
+
+    property queued:
+        def __get__(self):
+            return self.executor_.nofQueued()
+
+cdef extern from "tracing.hpp":
+    cdef cppclass Tracing_ "MadOpt::Tracing":
+        @staticmethod
+        void enable(bool)
+        @staticmethod
+        bool enabled()
+        @staticmethod
+        void clear() except +
+        @staticmethod
+        bool dump(const string&) except +
+
+def enableTracing(bool on=True):
+    """switches the recording of spans (setEvals, callbacks, ...) on or off"""
+    Tracing_.enable(on)
+
+def tracingEnabled():
+    return Tracing_.enabled()
+
+def clearTrace():
+    """drops the recorded spans, tracing has to be disabled"""
+    Tracing_.clear()
+
+def dumpTrace(path):
+    """writes the recorded spans as chrome trace json to path, tracing has
+    to be disabled"""
+    if not Tracing_.dump(path.encode('UTF-8')):
+        raise IOError("can not write trace to " + path)
+
 # ex: set tabstop=4 shiftwidth=4 expandtab:
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+
+#include "memory_report.hpp"
+
+namespace MadOpt {
+
+MemoryReport::Entry& MemoryReport::entry(const char* name){
+    FOREACH(e, entries)
+    //for (auto& e: entries){
+        if (e.name == name)
+            return e;
+    }
+    entries.push_back(Entry(name));
+    return entries.back();
+}
+
+void MemoryReport::add(const char* name, std::size_t bytes){
+    Entry& e = entry(name);
+    e.objects++;
+    e.bytes += bytes;
+    e.max_bytes = std::max(e.max_bytes, bytes);
+}
+
+void MemoryReport::addShared(const char* name, std::size_t bytes){
+    entry(name).bytes += bytes;
+}
+
+MemoryReport::Entry MemoryReport::get(const string& name)const{
+    FOREACH(e, entries)
+    //for (auto& e: entries){
+        if (e.name == name)
+            return e;
+    }
+    return Entry(name);
+}
+
+std::size_t MemoryReport::total()const{
+    std::size_t res = 0;
+    FOREACH(e, entries)
+    //for (auto& e: entries){
+        res += e.bytes;
+    }
+    return res;
+}
+
+string MemoryReport::str()const{
+    std::ostringstream os;
+    os<<std::left<<std::setw(24)<<"name"<<std::right
+        <<std::setw(12)<<"objects"
+        <<std::setw(16)<<"bytes"
+        <<std::setw(12)<<"mean"
+        <<std::setw(12)<<"max"<<std::endl;
+    FOREACH(e, entries)
+    //for (auto& e: entries){
+        os<<std::left<<std::setw(24)<<e.name<<std::right
+            <<std::setw(12)<<e.objects
+            <<std::setw(16)<<e.bytes
+            <<std::setw(12)<<std::fixed<<std::setprecision(1)<<e.mean()
+            <<std::setw(12)<<e.max_bytes<<std::endl;
+    }
+    os<<std::left<<std::setw(24)<<"total"<<std::right
+        <<std::setw(12)<<""
+        <<std::setw(16)<<total()<<std::endl;
+    return os.str();
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
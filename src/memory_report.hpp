@@ -0,0 +1,73 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_MEMORY_REPORT_H
+#define MADOPT_MEMORY_REPORT_H
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+//! heap bytes of a vector
+template<class T, class A>
+std::size_t heapBytes(const vector<T, A>& v){
+    return v.capacity()*sizeof(T);
+}
+
+//! heap bytes of a string, strings in the small string buffer have none
+template<class A>
+std::size_t heapBytes(const std::basic_string<char, std::char_traits<char>, A>& s){
+    return s.capacity() >= sizeof(s) ? s.capacity() + 1 : 0;
+}
+
+//! bytes used by a model broken down by its parts, \sa Model::memoryReport()
+struct MemoryReport {
+    struct Entry {
+        Entry(const string& name=""): name(name), objects(0), bytes(0), max_bytes(0){}
+        string name;
+        //! number of objects that were added
+        std::size_t objects;
+        std::size_t bytes;
+        //! largest single object
+        std::size_t max_bytes;
+
+        double mean()const { return objects ? (double)bytes/objects : 0; }
+    };
+
+    //! adds one object of the entry name, no allocation if name exists
+    void add(const char* name, std::size_t bytes);
+
+    //! adds bytes to the entry name that do not belong to a single object,
+    //e.g. the container of the objects
+    void addShared(const char* name, std::size_t bytes);
+
+    //! the entry name, an empty one if it does not exist
+    Entry get(const string& name)const;
+
+    std::size_t total()const;
+
+    //! report as table
+    string str()const;
+
+    //! entries in the order they were first added
+    vector<Entry> entries;
+
+    private:
+        Entry& entry(const char* name);
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
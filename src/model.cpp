@@ -23,28 +23,18 @@
 #include "inner_constraint.hpp"
 #include "constraint.hpp"
 #include "logger.hpp"
+#include "python_callback.hpp"
+#include "tracing.hpp"
 
 using namespace MadOpt;
 
 Model::~Model(){
-    FOREACH(p, vars)
-    //for (auto& p: vars){
+    // variables, parameters and expression constraints live in the arena,
+    // the objective is deleted by obj
+    FOREACH(p, owned_constraints)
+    //for (auto& p: owned_constraints){
         delete p;
     }
-
-    FOREACH(p, params)
-    //for (auto& p: params){
-        delete p;
-    }
-
-    FOREACH(p, constraints)
-    //for (auto& p: constraints){
-        delete p;
-    }
-
-    if (obj != 0){
-        delete obj;
-    }
 }
 
 // Var stuff
@@ -92,11 +82,25 @@ Var Model::addBVar(string name){
     return addBVar(0, name);
 }
 
+vector<Var> Model::addVars(Idx n, const double* lb, const double* ub,
+        const double* init, string name){
+    TRACE_START;
+    vector<Var> res;
+    res.reserve(n);
+    vars.reserve(vars.size() + n);
+    for (Idx i=0; i<n; i++)
+        res.push_back(addCVar(lb[i], ub[i], init[i],
+                    name + std::to_string((long long int)nx())));
+    TRACE_END;
+    return res;
+}
+
 //Constraint stuff
 //
 //
 Constraint Model::addConstr(const double lb, const Expr& expr, const double ub){
     TRACE_START;
+    TRACE_SPAN("Model::addConstr");
     if (lb > ub)
         throw MadOptError("lower bound is greater then upper bound for expr=" 
                 + expr.toString() 
@@ -110,20 +114,75 @@ Constraint Model::addConstr(const double lb, const Expr& expr, const double ub){
             throw MadOptError("cannot add variable from other model to this model");
     }
     TRACE(expr.toString());
-    simstack.setXSize(nx());
-    auto con = new InnerConstraint(expr, lb, ub, hess_pos_map, simstack);
-    cstack.resize(simstack);
-    return addConstr(con);
+    if (canonical_polynomials)
+        return insertConstr(buildConstraint(rewritePolynomials(expr), lb, ub, ng()));
+    return insertConstr(buildConstraint(expr, lb, ub, ng()));
+}
+
+Idx Model::addLinearConstrs(Idx rows, const int* indptr, const int* indices,
+        const double* data, const double* lb, const double* ub){
+    TRACE_START;
+    // all rows are checked first, a failing call adds none of them
+    if (rows > 0 && indptr[0] < 0)
+        throw MadOptError("linear constraints have a negative indptr");
+    for (Idx r=0; r<rows; r++){
+        if (indptr[r+1] < indptr[r])
+            throw MadOptError("indptr of linear constraints is decreasing at row "
+                    + std::to_string((long long int)r));
+        for (int k=indptr[r]; k<indptr[r+1]; k++)
+            if (indices[k] < 0 || (Idx)indices[k] >= nx())
+                throw MadOptError("linear constraint refers to unknown variable "
+                        + std::to_string((long long int)indices[k]));
+        if (lb[r] > ub[r])
+            throw MadOptError("lower bound is greater then upper bound for linear constraint "
+                    + std::to_string((long long int)r));
+    }
+    const Idx first = ng();
+    constraints.reserve(first + rows);
+    for (Idx r=0; r<rows; r++){
+        Expr expr(0);
+        for (int k=indptr[r]; k<indptr[r+1]; k++)
+            if (data[k] != 0)
+                expr += data[k]*Var(vars[indices[k]]);
+        addConstr(lb[r], expr, ub[r]);
+    }
+    TRACE_END;
+    return first;
 }
 
 Constraint Model::addConstr(ConstraintInterface* con) {
+  owned_constraints.push_back(con);
+  return insertConstr(con);
+}
+
+Constraint Model::insertConstr(ConstraintInterface* con) {
   TRACE_START;
+  unfinalize();
+  evaluated = EVAL_NONE;
+  con->setHessStructure(hess_structure);
   constraints.push_back(con);
   model_changed = true;
   TRACE_END;
   return Constraint(this, constraints.size()-1);
 }
 
+Idx Model::addCallbackConstrs(CallbackBlock* block, const double* lb, const double* ub){
+    TRACE_START;
+    shared_ptr<CallbackBlock> shared(block);
+    if (block->rows() > 0 && block->maxPos() >= nx())
+        throw MadOptError("callback constraints refer to unknown variable "
+                + std::to_string((long long int)block->maxPos()));
+    for (Idx r=0; r<block->rows(); r++)
+        if (lb[r] > ub[r])
+            throw MadOptError("lower bound is greater then upper bound for callback constraint "
+                    + std::to_string((long long int)r));
+    const Idx first = ng();
+    for (Idx r=0; r<block->rows(); r++)
+        addConstr(new PythonCallback(shared, r, lb[r], ub[r]));
+    TRACE_END;
+    return first;
+}
+
 Constraint Model::addEqConstr(const Expr& expr, const double equal){
     return addConstr(equal, expr, equal);
 }
@@ -140,17 +199,152 @@ Constraint Model::addConstr(const double lb, const Expr& expr){
 //
 //
 void Model::setObj(const Expr& expr){
+    TRACE_SPAN("Model::setObj");
     model_changed = true;
-    if (obj != 0)
-        delete obj;
-    simstack.setXSize(nx());
-    obj = new InnerConstraint(expr, 0, 0, hess_pos_map, simstack);
-    cstack.resize(simstack);
+    if (canonical_polynomials)
+        obj.reset(buildConstraint(rewritePolynomials(expr), 0, 0, -1));
+    else
+        obj.reset(buildConstraint(expr, 0, 0, -1));
     obj_jac_map.clear();
     obj_jac_map.resize(obj->getNNZ_Jac());
     obj->getNZ_Jac(obj_jac_map.data());
 }
 
+InnerConstraint* Model::buildConstraint(const Expr& expr, double lb, double ub,
+        long row){
+    unfinalize();
+    evaluated = EVAL_NONE;
+    simstack->setXSize(nx());
+    if (!profiler.enabled()){
+        auto con = newConstraint(expr, lb, ub, row);
+        cstack.resize(*simstack);
+        return con;
+    }
+    auto start = Profiler::Clock::now();
+    auto con = newConstraint(expr, lb, ub, row);
+    cstack.resize(*simstack);
+    profiler.addBuildTime(row, std::chrono::duration<double>(
+                Profiler::Clock::now() - start).count());
+    return con;
+}
+
+InnerConstraint* Model::newConstraint(const Expr& expr, double lb, double ub,
+        long row){
+    // setObj() replaces the objective, in the arena it would stay until the
+    // model is destroyed
+    if (row < 0)
+        return new InnerConstraint(expr, lb, ub, hess_structure, *simstack);
+    return arena.create<InnerConstraint>(expr, lb, ub, hess_structure, *simstack, &arena);
+}
+
+Expr Model::rewritePolynomials(const Expr& expr){
+    TRACE_SPAN("Model::rewritePolynomials");
+    Expr res = canonicalise(expr);
+    const Idx before = InnerConstraint::tapeLength(expr);
+    const Idx after = InnerConstraint::tapeLength(res);
+    // an expression that is not shortened keeps its exact values
+    if (after >= before){
+        polynomial_stats.add(before, before);
+        return expr;
+    }
+    polynomial_stats.add(before, after);
+    return res;
+}
+
+SimStack& Model::getSimStack(){
+    unfinalize();
+    return *simstack;
+}
+
+void Model::finalize(){
+    if (finalized)
+        return;
+    TRACE_SPAN("Model::finalize");
+    compressHess();
+    hess_structure.shrink();
+    simstack.reset();
+    obj->finalize();
+    FOREACH(c, constraints)
+    //for (auto& c: constraints){
+        c->finalize();
+    }
+    finalized = true;
+}
+
+void Model::unfinalize(){
+    if (!finalized)
+        return;
+    TRACE_SPAN("Model::unfinalize");
+    simstack.reset(new SimStack());
+    finalized = false;
+}
+
+void Model::compressHess(){
+    if (hess_structure.compressed())
+        return;
+    TRACE_SPAN("Model::compressHess");
+    vector<Idx> perm;
+    hess_structure.compress(perm);
+    obj->remapHess(perm);
+    FOREACH(c, constraints)
+    //for (auto& c: constraints){
+        c->remapHess(perm);
+    }
+}
+
+MemoryReport Model::memoryReport()const{
+    MemoryReport report;
+    FOREACH(v, vars)
+    //for (auto& v: vars){
+        report.add("variables", sizeof(InnerVar) + heapBytes(v->name()));
+    }
+    report.addShared("variables", heapBytes(vars));
+
+    FOREACH(p, params)
+    //for (auto& p: params){
+        report.add("parameters", sizeof(InnerParam) + heapBytes(p->name()));
+    }
+    report.addShared("parameters", heapBytes(params));
+
+    MemoryReport obj_report;
+    obj->addMemory(obj_report);
+    report.add("objective", obj_report.total() + heapBytes(obj_jac_map));
+
+    FOREACH(c, constraints)
+    //for (auto& c: constraints){
+        c->addMemory(report);
+    }
+    report.addShared("constraint", heapBytes(constraints));
+
+    report.addShared("hess_structure", hess_structure.bytes());
+    report.addShared("simstack", simstack ? simstack->bytes() : 0);
+    report.addShared("cstack", cstack.bytes());
+    report.addShared("solution", solution.bytes());
+    report.addShared("evaluation", heapBytes(evaluation.grad_f)
+            + heapBytes(evaluation.g) + heapBytes(evaluation.jac)
+            + heapBytes(evaluation.jac_row) + heapBytes(evaluation.jac_col)
+            + heapBytes(evaluation.hess) + heapBytes(evaluation.hess_row)
+            + heapBytes(evaluation.hess_col));
+    report.addShared("arena slack", arena.bytes() - arena.used());
+    return report;
+}
+
+//Profiling
+//
+//
+void Model::enableProfiling(bool on, Idx every){
+    profiler.enable(on, every);
+    profiler.resize(ng());
+}
+
+vector<ConstraintProfile> Model::profile(Idx top_k, Profiler::Group group){
+    return profiler.report(obj.get(), constraints, top_k, group);
+}
+
+string Model::profileString(Idx top_k, Profiler::Group group){
+    return Profiler::str(profile(top_k, group));
+}
+
 //NLP init stuff
 //
 //
@@ -165,7 +359,8 @@ Idx Model::getNNZ_Jac(){
 }
 
 Idx Model::getNNZ_Hess(){
-    return hess_pos_map.size();
+    compressHess();
+    return hess_structure.size();
 }
 
 void Model::getNZ_Jac(int* iRow, int* jCol){
@@ -188,11 +383,9 @@ void Model::getNZ_Jac(int* iRow, int* jCol){
 }
 
 void Model::getNZ_Hess(int* iRow, int* jCol){
-    FOREACH(it, hess_pos_map)
-    //for (auto& it: hess_pos_map){
-        iRow[it.second] = it.first.first;
-        jCol[it.second] = it.first.second;
-    }
+    compressHess();
+    std::copy(hess_structure.rows().begin(), hess_structure.rows().end(), iRow);
+    std::copy(hess_structure.cols().begin(), hess_structure.cols().end(), jCol);
 }
 
 void Model::getBounds(double* xl, double* xu, double* gl, double* gu){
@@ -225,6 +418,37 @@ void Model::solAsInit(){
     }
 }
 
+void Model::setInits(const double* x){
+    // checked first, a MadOptError leaves the model unchanged
+    for (Idx i=0; i<nx(); i++)
+        if (vars[i]->lb() > x[i] || vars[i]->ub() < x[i])
+            throw MadOptError("init not in bounds var " + vars[i]->name());
+    for (Idx i=0; i<nx(); i++)
+        vars[i]->init(x[i]);
+}
+
+void Model::setVarBounds(const double* lb, const double* ub){
+    for (Idx i=0; i<nx(); i++){
+        if (lb[i] > ub[i])
+            throw MadOptError("lb larger than ub for variable " + vars[i]->name());
+        if (lb[i] > vars[i]->init() || ub[i] < vars[i]->init())
+            throw MadOptError("init not in bounds var " + vars[i]->name());
+    }
+    for (Idx i=0; i<nx(); i++)
+        vars[i]->bounds(lb[i], ub[i]);
+}
+
+void Model::setConstrBounds(const double* lb, const double* ub){
+    for (Idx i=0; i<ng(); i++)
+        if (lb[i] > ub[i])
+            throw MadOptError("lower bound is greater then upper bound for constraint "
+                    + std::to_string((long long int)i));
+    for (Idx i=0; i<ng(); i++){
+        constraints[i]->lb(lb[i]);
+        constraints[i]->ub(ub[i]);
+    }
+}
+
 Idx Model::nx() const{
     return vars.size();
 }
@@ -241,36 +465,68 @@ Idx Model::np() const{
 // 
 // 
 
-void Model::setEvals(const double* x){
-    cstack.setX(x);
-    obj->setEvals(cstack);
+void Model::setEvals(const double* x, EvalLevel level){
+    cstack.setX(x, nx());
+    sweep(level);
+}
+
+void Model::prepareEvals(const double* x, bool new_x, EvalLevel level){
+    if (new_x){
+        cstack.setX(x, nx());
+    } else {
+        if (evaluated >= level)
+            return;
+        // the callback blocks keep their results since the id is the same
+        cstack.rebindX(x);
+    }
+    sweep(std::max(level, eval_level));
+}
+
+void Model::setEngine(Engine engine){
+    cstack.setEngine(engine, &hess_structure);
+    evaluated = EVAL_NONE;
+}
+
+void Model::sweep(EvalLevel level){
+    STATS_TIMER(solve_stats.set_evals);
+    TRACE_SPAN("Model::setEvals");
+    // the one pass engine aligns its entries by the positions
+    if (level >= EVAL_JAC && cstack.getEngine() == ENGINE_ONE_PASS)
+        compressHess();
+    evaluated = level;
+    if (profiler.sample()){
+        profiler.setEvals(obj.get(), cstack, -1, level);
+        for (Idx i=0; i<constraints.size(); i++)
+            profiler.setEvals(constraints[i], cstack, i, level);
+        return;
+    }
+    obj->setEvals(cstack, level);
     FOREACH(constraint, constraints)
     //for (auto& constraint: constraints){
-        constraint->setEvals(cstack);
+        constraint->setEvals(cstack, level);
     }
 }
 
 void Model::eval_f(const double* x, bool new_x, double& obj_value){
-    if (new_x) setEvals(x);
+    prepareEvals(x, new_x, EVAL_VALUE);
     obj_value = obj->getG();
     VALGRIND_CONDITIONAL_JUMP_TEST(obj_value);
 }
 
 void Model::eval_grad_f(const double* x, bool new_x, double* grad_f){
-    if (new_x) setEvals(x);
+    prepareEvals(x, new_x, EVAL_JAC);
     for (Idx i=0; i<nx(); i++)
         grad_f[i] = 0;
 
-    Idx i=0;
-    FOREACH(value, obj->getJac())
-    //for (auto& value: obj->getJac()){
-        VALGRIND_CONDITIONAL_JUMP_TEST(value);
-        grad_f[obj_jac_map[i++]] = value;
+    const double* jac = obj->getJacValues();
+    for (Idx i=0; i<obj_jac_map.size(); i++){
+        VALGRIND_CONDITIONAL_JUMP_TEST(jac[i]);
+        grad_f[obj_jac_map[i]] = jac[i];
     }
 }
 
 void Model::eval_g(const double* x, bool new_x, double* g){
-    if (new_x) setEvals(x);
+    prepareEvals(x, new_x, EVAL_VALUE);
     for (Idx i=0; i<ng(); i++){
         g[i] = constraints[i]->getG();
         VALGRIND_CONDITIONAL_JUMP_TEST(g[i]);
@@ -278,20 +534,24 @@ void Model::eval_g(const double* x, bool new_x, double* g){
 }
 
 void Model::eval_jac_g(const double* x, bool new_x, double* values){
-    if (new_x) setEvals(x);
+    prepareEvals(x, new_x, EVAL_JAC);
+    TRACE_SPAN("Model::eval_jac_g");
     int nz = 0;
     FOREACH(constraint, constraints)
     //for (auto& constraint: constraints){
-        auto& jac = constraint->getJac();
-        std::copy(jac.begin(), jac.end(), &(values[nz]));
-        nz += jac.size();
+        const Idx n = constraint->getNNZ_Jac();
+        const double* jac = constraint->getJacValues();
+        std::copy(jac, jac + n, &(values[nz]));
+        nz += n;
     }
 }
 
 void Model::eval_h(const double* x, bool new_x, double* values, double obj_factor, const double* lambda){
-    if (new_x) setEvals(x);
+    prepareEvals(x, new_x, EVAL_HESS);
+    TRACE_SPAN("Model::eval_h");
 
-    for (Idx i=0; i<hess_pos_map.size(); i++)
+    const Idx nnz_hess = getNNZ_Hess();
+    for (Idx i=0; i<nnz_hess; i++)
         values[i] = 0;
 
     for (Idx i=0; i<ng(); i++)
@@ -300,6 +560,35 @@ void Model::eval_h(const double* x, bool new_x, double* values, double obj_facto
     obj->eval_h(values, obj_factor);
 }
 
+void Model::evaluate(const double* x, double obj_factor, const double* lambda){
+    TRACE_START;
+    const Idx nnz_jac = getNNZ_Jac();
+    const Idx nnz_hess = getNNZ_Hess();
+    evaluation.grad_f.resize(nx());
+    evaluation.g.resize(ng());
+    evaluation.jac.resize(nnz_jac);
+    evaluation.jac_row.resize(nnz_jac);
+    evaluation.jac_col.resize(nnz_jac);
+    evaluation.hess.resize(nnz_hess);
+    evaluation.hess_row.resize(nnz_hess);
+    evaluation.hess_col.resize(nnz_hess);
+
+    vector<double> zeros;
+    if (lambda == NULL){
+        zeros.resize(ng(), 0);
+        lambda = zeros.data();
+    }
+
+    eval_f(x, true, evaluation.f);
+    eval_grad_f(x, false, evaluation.grad_f.data());
+    eval_g(x, false, evaluation.g.data());
+    eval_jac_g(x, false, evaluation.jac.data());
+    eval_h(x, false, evaluation.hess.data(), obj_factor, lambda);
+    getNZ_Jac(evaluation.jac_row.data(), evaluation.jac_col.data());
+    getNZ_Hess(evaluation.hess_row.data(), evaluation.hess_col.data());
+    TRACE_END;
+}
+
 double Model::objValue()const { 
     return solution.obj_value(); 
 }
@@ -310,7 +599,7 @@ Solution::SolverStatus Model::status()const {
 
 Var Model::addVar(double lb, double ub, VarType type, double init, string name){
     TRACE_START;
-    InnerVar* v = new InnerVar(lb, ub, init, type, name, solution);
+    InnerVar* v = arena.create<InnerVar>(lb, ub, init, type, name, solution, &arena);
     v->setPos(vars.size());
     vars.push_back(v);
     model_changed = true;
@@ -320,7 +609,7 @@ Var Model::addVar(double lb, double ub, VarType type, double init, string name){
 
 Param Model::addParam(const double value, const string name){
     TRACE_START;
-    InnerParam* p = new InnerParam(value, name);
+    InnerParam* p = arena.create<InnerParam>(value, name, &arena);
     params.push_back(p);
     TRACE_END;
     return Param(p);
@@ -364,5 +653,14 @@ void Model::ub(Idx idx, double v){
     constraints[idx]->ub(v);
 }
 
+const string& Model::tag(Idx idx)const {
+    ASSERT_LE(idx, constraints.size()-1);
+    return profiler.tag(idx);
+}
+
+void Model::tag(Idx idx, const string& v){
+    ASSERT_LE(idx, constraints.size()-1);
+    profiler.tag(idx, v);
+}
 
 /* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -25,16 +25,40 @@
 #include "constraint.hpp"
 #include "solution.hpp"
 #include "constraint_interface.hpp"
+#include "solve_stats.hpp"
+#include "profiler.hpp"
+#include "arena.hpp"
+#include "polynomial.hpp"
 
 namespace MadOpt {
 
 //class ThreadPool;
+class SolverWorkspace;
+class CallbackBlock;
+
+//! results of Model::evaluate(), jacobian and hessian are stored in triplet
+//format with the same structure that is passed to the solver
+struct Evaluation {
+    double f;
+    vector<double> grad_f;
+    vector<double> g;
+    vector<double> jac;
+    vector<int> jac_row;
+    vector<int> jac_col;
+    vector<double> hess;
+    vector<int> hess_row;
+    vector<int> hess_col;
+};
 
 //! generic Model class, not for direct use hence the constructor is protected
 class Model {
     public:
         Model(): show_solver(false), timelimit(-1), model_changed(false),
-                 obj(new InnerConstraint(Expr(0), 0, 0, hess_pos_map, simstack)){}
+                 simstack(new SimStack()), finalized(false),
+                 evaluated(EVAL_NONE), eval_level(EVAL_HESS),
+                 canonical_polynomials(false){
+            obj.reset(buildConstraint(Expr(0), 0, 0, -1));
+        }
 
   Model(Model const &) = delete;
   Model(Model&&) = delete;
@@ -44,6 +68,10 @@ class Model {
         //! starts the solver
         virtual void solve()=0; 
 
+        //! starts the solver with the solver application kept in workspace,
+        //used by the SolveExecutor, the default simply calls solve()
+        virtual void solve(SolverWorkspace& workspace){ solve(); }
+
         // Options 
 
         //! set string option, the options depend on the solver, this method
@@ -107,6 +135,17 @@ class Model {
          */
         Var addBVar(string name);
 
+        /*! \brief add n continuous variables, the i-th one is named
+         * name + its position in the model
+         * @param[in] n number of variables
+         * @param[in] lb n lower bounds
+         * @param[in] ub n upper bounds
+         * @param[in] init n initial values
+         * @param[in] name name prefix
+         */
+        vector<Var> addVars(Idx n, const double* lb, const double* ub,
+                const double* init, string name);
+
         //Param stuff
         /*! \brief add a new parameter to the model,
          * @param[in] value value
@@ -142,12 +181,36 @@ class Model {
          */
         Constraint addConstr(const double lb, const Expr& expr);
 
+        /*! \brief add the linear constraints lb <= A*x <= ub, where x are
+         * all variables of the model in the order they were added
+         * @param[in] rows number of rows of A
+         * @param[in] indptr rows+1 row offsets of A in CSR format
+         * @param[in] indices column (variable position) of each entry
+         * @param[in] data value of each entry
+         * @param[in] lb rows lower bounds
+         * @param[in] ub rows upper bounds
+         * \return the position of the first added constraint
+         * \details all rows are checked before the first one is added, a
+         * MadOptError leaves the model unchanged
+         */
+        Idx addLinearConstrs(Idx rows, const int* indptr, const int* indices,
+                const double* data, const double* lb, const double* ub);
+
         /*! add new custom constraint
         * expr
-        * \param[in] pointer to custom constraint, do not del mem on your own 
+        * \param[in] pointer to custom constraint, do not del mem on your own,
+        * it is deleted with the model
         */
         Constraint addConstr(ConstraintInterface* con);
 
+        /*! \brief add all rows of a CallbackBlock as constraints
+         * \param[in] block the callback block, do not del mem on your own
+         * \param[in] lb block->rows() lower bounds
+         * \param[in] ub block->rows() upper bounds
+         * \return the position of the first added constraint
+         */
+        Idx addCallbackConstrs(CallbackBlock* block, const double* lb, const double* ub);
+
         //Objective Stuff
         /*! set objective based on custom objective implementation that is
          * derived from InnerConstraint
@@ -157,6 +220,16 @@ class Model {
         //! set objective based on Expr 
         void setObj(const Expr& expr);
 
+        /*! \brief fixes the hessian structure and frees the structures that
+         * are only needed while adding constraints,
+         * \details called by solve(), adding a constraint afterwards
+         * rebuilds them
+         */
+        void finalize();
+
+        //! true if finalize() was called and no constraint was added since
+        bool isFinalized()const { return finalized; }
+
         //NLP init stuff
         Idx getNNZ_Jac();
         Idx getNNZ_Hess();
@@ -168,6 +241,18 @@ class Model {
         //! set the currently loaded solution as initial values, 
         void solAsInit();
 
+        //! set the initial values of all variables, x has nx() entries.
+        //All entries are checked first, a MadOptError changes nothing
+        void setInits(const double* x);
+
+        //! set the bounds of all variables, lb and ub have nx() entries,
+        //\sa setInits()
+        void setVarBounds(const double* lb, const double* ub);
+
+        //! set the bounds of all constraints, lb and ub have ng() entries,
+        //\sa setInits()
+        void setConstrBounds(const double* lb, const double* ub);
+
         //! number of variables
         Idx nx() const;
 
@@ -177,8 +262,11 @@ class Model {
         //! number of parameters
         Idx np() const;
 
-        // Eval functions
-        void setEvals(const double* x);
+        // Eval functions, once the buffers are sized by the first evaluation
+        // they do not allocate, checked by tests/alloc_tests.hpp
+
+        //! evaluates the objective and all constraints at x up to level
+        void setEvals(const double* x, EvalLevel level=EVAL_HESS);
         void eval_f(const double* x, bool new_x, double& obj_value);
         void eval_grad_f(const double* x, bool new_x, double* grad_f);
         void eval_g(const double* x, bool new_x, double* g);
@@ -186,6 +274,37 @@ class Model {
         void eval_h(const double* x, bool new_x, double* values,
                 double obj_factor, const double* lambda);
 
+        /*! \brief evaluates the model at x and stores all results, they are
+         * valid until the next call, \sa getEvaluation()
+         * @param[in] x nx() values
+         * @param[in] obj_factor factor of the objective in the hessian of the lagrangian
+         * @param[in] lambda ng() constraint multipliers, NULL means all 0
+         */
+        void evaluate(const double* x, double obj_factor=1, const double* lambda=NULL);
+
+        //! results of the last evaluate()
+        const Evaluation& getEvaluation()const { return evaluation; }
+
+        /*! \brief the level the eval functions evaluate a new x at,
+         * \details EVAL_HESS by default, then one sweep per x computes
+         * everything. EVAL_JAC skips the hessian, e.g. if the solver
+         * approximates it, EVAL_VALUE evaluates only the values of trial
+         * points that may be rejected. A function that needs more than was
+         * evaluated repeats the sweep at its level.
+         */
+        void setEvalLevel(EvalLevel level){ eval_level = level; }
+
+        EvalLevel getEvalLevel()const { return eval_level; }
+
+        /*! \brief the engine that evaluates the derivatives
+         * \details ENGINE_PLAN (default) replays the conflicts the symbolic
+         * pass recorded, ENGINE_ONE_PASS resolves them while evaluating,
+         * which is faster if a constraint repeats its variables often.
+         */
+        void setEngine(Engine engine);
+
+        Engine getEngine()const { return cstack.getEngine(); }
+
         //! objective value 
         double objValue() const;
 
@@ -200,11 +319,52 @@ class Model {
         //! returns the solution object that is currently loaded
         Solution& getSolution(){ return solution; }
 
+        //! bytes used by the model broken down by its parts, \sa MemoryReport
+        MemoryReport memoryReport()const;
+
+        //! statistics of the last solve(), \sa SolveStats
+        const SolveStats& stats()const { return solve_stats; }
+
+        SolveStats& getStats(){ return solve_stats; }
+
+        /*! \brief switches the per constraint profiling on or off, \sa
+         * Profiler
+         * @param[in] on enable or disable
+         * @param[in] every time every n-th evaluation only
+         */
+        void enableProfiling(bool on=true, Idx every=1);
+
+        bool profilingEnabled()const { return profiler.enabled(); }
+
+        //! resets the recorded timings
+        void clearProfile(){ profiler.clear(); }
+
+        //! the top_k most expensive constraints (incl. the objective),
+        //0 means all, \sa Profiler::report()
+        vector<ConstraintProfile> profile(Idx top_k=10,
+                Profiler::Group group=Profiler::ROW);
+
+        //! profile() as table
+        string profileString(Idx top_k=10, Profiler::Group group=Profiler::ROW);
+
+        /*! \brief rewrites the polynomials of the constraints and of the
+         * objective that are added from now on, off by default, \sa
+         * canonicalise()
+         * \details an expression is only replaced if its tape gets shorter
+         */
+        void canonicalisePolynomials(bool on=true){ canonical_polynomials = on; }
+
+        bool canonicalisingPolynomials()const { return canonical_polynomials; }
+
+        //! tape lengths of the rewritten expressions
+        const PolynomialStats& polynomialStats()const { return polynomial_stats; }
+
         //! enable/disable printing options of the solver, Overwrites! the
         //options
         bool show_solver;
 
-        //! timelimit, a negative value is interpreted as no time limit
+        //! timelimit in seconds, ipopt measures it in wall clock time of the
+        //solve, a negative value is interpreted as no time limit
         double timelimit;
 
         const vector<InnerVar*>& getVars()const { return vars; }
@@ -215,26 +375,80 @@ class Model {
         double ub(Idx idx) const;
         void ub(Idx idx, double v);
 
+        //! tag of a constraint, used to aggregate the profile
+        const string& tag(Idx idx) const;
+        void tag(Idx idx, const string& v);
+
         const string toString()const;
 
-        SimStack& getSimStack(){ return simstack; }
+        SimStack& getSimStack();
         CStack& getCStack(){ return cstack; }
 
+        //! memory of the variables, parameters and constraints
+        const Arena& getArena()const { return arena; }
+
     protected:
         bool model_changed;
         vector<InnerVar*> vars;
   Solution solution;
 
+        SolveStats solve_stats;
+
+        Profiler profiler;
+
     private:
+        //! memory of the variables, parameters and expression constraints,
+        //the model teardown frees only its blocks
+        Arena arena;
         vector<InnerParam*> params;
         vector<ConstraintInterface*> constraints;
+        //! custom constraints, deleted by the model
+        vector<ConstraintInterface*> owned_constraints;
         CStack cstack;
-        SimStack simstack;
-        ConstraintInterface* obj;
+        //! symbolic stack of the constraint construction, NULL once finalized
+        unique_ptr<SimStack> simstack;
+        //! not in the arena, setObj() deletes the old one
+        unique_ptr<ConstraintInterface> obj;
         vector<Idx> obj_jac_map;
-        HessPosMap hess_pos_map;
+        HessStructure hess_structure;
+        bool finalized;
+        //! level of the evaluation at the current x
+        EvalLevel evaluated;
+        EvalLevel eval_level;
+        Evaluation evaluation;
+        //! \sa canonicalisePolynomials()
+        bool canonical_polynomials;
+        PolynomialStats polynomial_stats;
 
         Var addVar(double lb, double ub, VarType type, double init, string name);
+
+        Constraint insertConstr(ConstraintInterface* con);
+
+        //! makes sure that the current x is evaluated up to level, x is the
+        //current one if new_x is false
+        void prepareEvals(const double* x, bool new_x, EvalLevel level);
+
+        //! evaluates everything at the x of cstack up to level
+        void sweep(EvalLevel level);
+
+        //! undoes finalize() before a constraint is added
+        void unfinalize();
+
+        //! sorts the new hessian entries into the structure and updates the
+        //positions of the constraints
+        void compressHess();
+
+        //! the objective (row -1) is built outside of the arena, the caller
+        //owns it
+        InnerConstraint* buildConstraint(const Expr& expr, double lb, double ub,
+                long row);
+
+        InnerConstraint* newConstraint(const Expr& expr, double lb, double ub,
+                long row);
+
+        //! canonicalise(expr) if its tape is shorter, recorded in the
+        //polynomial_stats
+        Expr rewritePolynomials(const Expr& expr);
 };
 }
 #endif
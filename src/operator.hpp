@@ -38,6 +38,23 @@
 #define OP_MUL_CONST 21
 #define OP_ADD_CONST 22
 
+// only in the tapes, InnerConstraint specialises OP_POW by its exponent
+#define OP_SQUARE 23
+#define OP_CUBE 24
+#define OP_INV 25
+#define OP_SQRT 26
+#define OP_RSQRT 27
+//! integer exponent, evaluated by multiplications
+#define OP_POW_INT 28
+
+// only in the tapes, InnerConstraint writes the quotients and negations of
+// the products as their own operators
+#define OP_DIV 29
+#define OP_NEG 30
+//! product of variables with integer exponents, the data are the number
+//of variables and each variable with its exponent
+#define OP_MONOMIAL 31
+
 namespace MadOpt {
 
 typedef char OPType;
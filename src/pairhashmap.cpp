@@ -17,41 +17,86 @@
 #include "logger.hpp"
 
 namespace MadOpt {
-PairHashMap::PairHashMap(const Idx& max_range): max_range(max_range){
-    mapping.resize(2*max_range);
+static const Idx MIN_CAPACITY = 16;
+
+PairHashMap::PairHashMap(const Idx& capacity): mask(0), generation(1), _size(0){
+    reserve(capacity);
+}
+
+Idx PairHashMap::find(const uint64_t& key)const{
+    // fibonacci hashing, the upper bits are mixed best
+    Idx i = Idx((key*0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    while (slots[i].generation == generation && slots[i].key != key)
+        i = (i+1) & mask;
+    return i;
 }
 
 Idx& PairHashMap::operator[](const HashPair& p){
-    Idx key = p.first+ p.second;
-    ASSERT_LE(key, mapping.size()-1, max_range);
-    auto& bucket = mapping[key];
-    TRACE(key, bucket.size(), str());
-    
-    FOREACH(ht, bucket)
-    //for (auto& ht: bucket){
-        TRACE(ht.p, ht.value);
-        if (ht.p == p)
-            return ht.value;
+    const uint64_t key = toKey(p);
+    Idx i = find(key);
+    if (slots[i].generation == generation)
+        return slots[i].value;
+    // at most half of the slots are used, keeps the probe sequences short
+    if (2*(_size+1) > slots.size()){
+        rehash(2*slots.size());
+        i = find(key);
+    }
+    auto& slot = slots[i];
+    slot.key = key;
+    slot.value = 0;
+    slot.generation = generation;
+    _size++;
+    TRACE(p, i, _size);
+    return slot.value;
+}
+
+void PairHashMap::clear(){
+    _size = 0;
+    if (++generation != 0)
+        return;
+    // the generation wrapped around, the slots have to be reset once
+    FOREACH(slot, slots)
+    //for (auto& slot: slots){
+        slot.generation = 0;
+    }
+    generation = 1;
+}
+
+void PairHashMap::reserve(const Idx& n){
+    Idx capacity = MIN_CAPACITY;
+    while (capacity < 2*n)
+        capacity *= 2;
+    if (capacity > slots.size())
+        rehash(capacity);
+}
+
+Idx PairHashMap::size()const{
+    return _size;
+}
+
+void PairHashMap::rehash(const Idx& capacity){
+    ASSERT((capacity & (capacity-1)) == 0, "capacity is not a power of 2", capacity);
+    vector<Slot> old(capacity, Slot{0, 0, 0});
+    old.swap(slots);
+    mask = capacity-1;
+    FOREACH(slot, old)
+    //for (auto& slot: old){
+        if (slot.generation == generation)
+            slots[find(slot.key)] = slot;
     }
-    bucket.emplace_back(p, 0);
-    return bucket.back().value;
 }
 
-void PairHashMap::resize(const Idx& max_range){
-    this->max_range = max_range;
-    mapping.resize(2*max_range);
+std::size_t PairHashMap::bytes()const{
+    return slots.capacity()*sizeof(Slot);
 }
 
 string PairHashMap::str()const{
-    string res = "nofb=" + to_string(mapping.size()) + "::";
-    Idx key = 0;
-    FOREACH(bucket, mapping)
-    //for (auto& bucket: mapping){
-        res += "k=" + to_string(key++) + " ";
-        FOREACH(elem, bucket)
-        //for (auto& elem: bucket){
-            res += to_string(elem.p) + ":" + to_string(elem.value) + " ";
-        }
+    string res = "nofs=" + to_string(slots.size()) + " size=" + to_string(_size) + "::";
+    FOREACH(slot, slots)
+    //for (auto& slot: slots){
+        if (slot.generation == generation)
+            res += to_string(PII(Idx(slot.key >> 32), Idx(slot.key)))
+                + ":" + to_string(slot.value) + " ";
     }
     return res;
 }
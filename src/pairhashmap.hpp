@@ -18,6 +18,7 @@
 
 #include <vector>
 #include <map>
+#include <cstdint>
 
 #include "common.hpp"
 
@@ -26,25 +27,48 @@ namespace MadOpt {
 using namespace std;
 
 typedef pair<Idx, Idx> HashPair;
+
+//! open addressing map from a pair to an Idx, new entries are 0, the slots of
+//other generations are empty so that clear() is O(1)
 class PairHashMap {
     public:
-        PairHashMap(const Idx& max_range=0);
+        PairHashMap(const Idx& capacity=0);
 
         Idx& operator[](const HashPair&);
-        void resize(const Idx& max_range);
+
+        //! removes all entries without touching the slots
+        void clear();
+
+        //! room for n entries without rehashing
+        void reserve(const Idx& n);
+
+        Idx size()const;
+
+        //! allocated heap memory
+        std::size_t bytes()const;
 
         string str()const;
 
     private:
-        struct HashTuple {
-            HashTuple(const HashPair& p, const Idx& value): p(p), value(value){}
-            HashPair p;
+        struct Slot {
+            uint64_t key;
             Idx value;
+            Idx generation;
         };
 
-        vector< vector<HashTuple> > mapping;
+        vector<Slot> slots;
+        Idx mask;
+        Idx generation;
+        Idx _size;
+
+        static uint64_t toKey(const HashPair& p){
+            return (uint64_t(p.first) << 32) | p.second;
+        }
+
+        //! slot of key, or the empty slot it belongs to
+        Idx find(const uint64_t& key)const;
 
-        Idx max_range;
+        void rehash(const Idx& capacity);
 };
 }
 #endif
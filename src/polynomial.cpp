@@ -0,0 +1,233 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "polynomial.hpp"
+#include "expr.hpp"
+#include "var.hpp"
+#include "param.hpp"
+#include "inner_var.hpp"
+#include "inner_constraint.hpp"
+
+namespace MadOpt {
+
+typedef list<Operator>::const_iterator OpIter;
+
+//! largest exponent of a monomial, as the integer powers of the tape
+static const int MAX_DEGREE = 16;
+
+//! coefficient*x1^e1*...*xn^en, the variables sorted by position
+struct Monomial {
+    Monomial(): coefficient(1){}
+    double coefficient;
+    //! (variable, exponent)
+    vector<pair<InnerVar*, int>> factors;
+
+    //! the positions and exponents, identical monomials have the same key
+    vector<PII> key()const {
+        vector<PII> res;
+        res.reserve(factors.size());
+        FOREACH(f, factors)
+        //for (auto& f: factors){
+            res.push_back(PII(f.first->getPos(), f.second));
+        }
+        return res;
+    }
+};
+
+//! adds the factor at iter to m and moves iter past it, false if it is
+//none of c, v or pow(v, e)
+static bool addFactor(OpIter& iter, Monomial& m){
+    if (iter->getType() == OP_CONST){
+        m.coefficient *= iter->getValue();
+        iter++;
+        return true;
+    }
+    double exponent = 1;
+    if (iter->getType() == OP_POW){
+        exponent = iter->getValue();
+        if (exponent != std::floor(exponent) || exponent < 1 || exponent > MAX_DEGREE)
+            return false;
+        iter++;
+    }
+    if (iter->getType() != OP_VAR_POINTER)
+        return false;
+    m.factors.push_back(std::make_pair(iter->getIVar(), (int)exponent));
+    iter++;
+    return true;
+}
+
+//! false if term is not a monomial, a constant has no factors
+static bool toMonomial(const Expr& term, Monomial& m){
+    OpIter iter = term.begin();
+    if (iter->getType() != OP_MUL){
+        if (!addFactor(iter, m))
+            return false;
+    } else {
+        const Idx n = iter->getCounter();
+        iter++;
+        for (Idx i=0; i<n; i++)
+            if (!addFactor(iter, m))
+                return false;
+    }
+    // repeated variables, e.g. x*y*x
+    std::sort(m.factors.begin(), m.factors.end(),
+            [](const pair<InnerVar*, int>& a, const pair<InnerVar*, int>& b){
+                return a.first->getPos() < b.first->getPos(); });
+    Idx n = 0;
+    for (Idx i=0; i<m.factors.size(); i++){
+        if (n && m.factors[n-1].first == m.factors[i].first)
+            m.factors[n-1].second += m.factors[i].second;
+        else
+            m.factors[n++] = m.factors[i];
+    }
+    m.factors.resize(n);
+    FOREACH(f, m.factors)
+    //for (auto& f: m.factors){
+        if (f.second > MAX_DEGREE)
+            return false;
+    }
+    return true;
+}
+
+static Expr power(InnerVar* var, int exponent){
+    return exponent == 1 ? Expr(Var(var)) : pow(Var(var), exponent);
+}
+
+static Expr toExpr(const Monomial& m){
+    Expr res(m.coefficient);
+    FOREACH(f, m.factors)
+    //for (auto& f: m.factors){
+        res *= power(f.first, f.second);
+    }
+    return res;
+}
+
+//! c[d]*x^d + ... + c[1]*x as (...(c[d]*x + c[d-1])*x + ...)*x, c[0] is
+//ignored
+static Expr horner(InnerVar* var, const vector<double>& c){
+    const Var x(var);
+    Expr res(c.back());
+    for (Idx k=c.size()-2; k>0; k--)
+        res = res*x + c[k];
+    return res*x;
+}
+
+//! c[d]*x^d + ... + c[1]*x as sum of monomials, c[0] is ignored
+static Expr expanded(InnerVar* var, const vector<double>& c){
+    Expr res;
+    for (Idx k=1; k<c.size(); k++)
+        if (c[k] != 0)
+            res += c[k]*power(var, k);
+    return res;
+}
+
+static Expr rewrite(OpIter& iter);
+
+static Expr rewriteSum(const Idx n, OpIter& iter){
+    Expr res;
+    double constant = 0;
+    vector<Monomial> monomials;
+    map<vector<PII>, Idx> index;
+    for (Idx i=0; i<n; i++){
+        const Expr term = rewrite(iter);
+        Monomial m;
+        if (!toMonomial(term, m)){
+            res += term;
+        } else if (m.factors.empty()){
+            constant += m.coefficient;
+        } else {
+            auto it = index.insert(std::make_pair(m.key(), (Idx)monomials.size()));
+            if (it.second)
+                monomials.push_back(m);
+            else
+                monomials[it.first->second].coefficient += m.coefficient;
+        }
+    }
+
+    // coefficients of the univariate polynomials by degree
+    map<InnerVar*, vector<double>> polynomials;
+    FOREACH(m, monomials)
+    //for (auto& m: monomials){
+        if (m.factors.size() != 1 || m.coefficient == 0)
+            continue;
+        vector<double>& c = polynomials[m.factors[0].first];
+        c.resize(std::max((Idx)c.size(), (Idx)m.factors[0].second + 1), 0.);
+        c[m.factors[0].second] = m.coefficient;
+    }
+
+    FOREACH(m, monomials)
+    //for (auto& m: monomials){
+        if (m.coefficient == 0)
+            continue;
+        if (m.factors.size() == 1){
+            vector<double>& c = polynomials[m.factors[0].first];
+            if (c.empty())
+                continue;
+            if (c.size() - std::count(c.begin(), c.end(), 0.) > 1){
+                // written at the first monomial of the variable, the Horner
+                // form needs fewer powers but for unit coefficients more
+                // operators, the sum is merged into res
+                const Expr h = horner(m.factors[0].first, c);
+                const Expr e = expanded(m.factors[0].first, c);
+                if (InnerConstraint::tapeLength(h) < InnerConstraint::tapeLength(e))
+                    res += h;
+                else
+                    res += e;
+                c.clear();
+                continue;
+            }
+        }
+        res += toExpr(m);
+    }
+    res += constant;
+    return res;
+}
+
+//! the subexpression at iter rewritten, moves iter past it
+static Expr rewrite(OpIter& iter){
+    const Operator& op = *iter;
+    iter++;
+    switch(op.getType()){
+        case OP_VAR_POINTER:
+            return Var(op.getIVar());
+        case OP_PARAM_POINTER:
+            return Param(op.getIParam());
+        case OP_CONST:
+            return Expr(op.getValue());
+        case OP_ADD:
+            return rewriteSum(op.getCounter(), iter);
+        case OP_MUL: {
+            Expr res(1);
+            for (Idx i=0; i<op.getCounter(); i++)
+                res *= rewrite(iter);
+            return res;
+        }
+        case OP_POW:
+            return pow(rewrite(iter), op.getValue());
+    }
+    return Expr(rewrite(iter), op.getType());
+}
+
+Expr canonicalise(const Expr& expr){
+    OpIter iter = expr.begin();
+    return rewrite(iter);
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
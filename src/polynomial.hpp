@@ -0,0 +1,61 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_POLYNOMIAL_H
+#define MADOPT_POLYNOMIAL_H
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+class Expr;
+
+//! tape lengths of the rewritten expressions, \sa
+//Model::canonicalisePolynomials()
+struct PolynomialStats {
+    PolynomialStats(): expressions(0), operators_before(0), operators_after(0){}
+
+    //! number of rewritten expressions (incl. the objective)
+    Idx expressions;
+    //! tape operators without and with the rewrite
+    Idx operators_before;
+    Idx operators_after;
+
+    void add(Idx before, Idx after){
+        expressions++;
+        operators_before += before;
+        operators_after += after;
+    }
+
+    //! fraction of the operators that were saved
+    double saved()const {
+        return operators_before ? 1 - (double)operators_after/operators_before : 0;
+    }
+};
+
+/*! \brief rewrites the polynomials in expr
+ * \details in every sum the monomials c*x1^e1*...*xn^en with positive
+ * integer exponents are collected, identical ones get one coefficient, and
+ * the univariate monomials of a variable with at least two of them are
+ * written in Horner form if that gives the shorter tape, e.g.
+ * 3*x^3 + x*y + 2*x + 4 + y*x becomes (3*x*x + 2)*x + 2*x*y + 4. Other
+ * terms are kept, their subexpressions are rewritten as well. The value is
+ * the same up to rounding.
+ */
+Expr canonicalise(const Expr& expr);
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
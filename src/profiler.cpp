@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <map>
+
+#include "profiler.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+void Profiler::enable(bool on, Idx n){
+    if (n == 0)
+        throw MadOptError("profiling interval must be positive");
+    _enabled = on;
+    every = n;
+    evaluations = 0;
+}
+
+void Profiler::clear(){
+    obj = Entry();
+    entries.assign(entries.size(), Entry());
+    evaluations = 0;
+}
+
+void Profiler::resize(Idx rows){
+    if (entries.size() < rows)
+        entries.resize(rows);
+}
+
+Profiler::Entry& Profiler::entry(long row){
+    if (row < 0)
+        return obj;
+    resize(row + 1);
+    return entries[row];
+}
+
+void Profiler::setEvals(ConstraintInterface* constraint, CStack& cstack, long row,
+        EvalLevel level){
+    Entry& e = entry(row);
+    auto start = Clock::now();
+    constraint->setEvals(cstack, level);
+    e.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    e.calls++;
+}
+
+void Profiler::addBuildTime(long row, double seconds){
+    entry(row).build_seconds += seconds;
+}
+
+void Profiler::tag(Idx row, const string& tag){
+    if (tags.size() <= row)
+        tags.resize(row + 1);
+    tags[row] = tag;
+}
+
+const string& Profiler::tag(Idx row)const{
+    static const string untagged;
+    return row < tags.size() ? tags[row] : untagged;
+}
+
+static void add(ConstraintProfile& p, const TapeInfo& tape){
+    p.tape.operators += tape.operators;
+    p.tape.jac_nnz += tape.jac_nnz;
+    p.tape.hess_nnz += tape.hess_nnz;
+    p.tape.plan += tape.plan;
+    p.tape.max_stack = std::max(p.tape.max_stack, tape.max_stack);
+}
+
+static string shapeName(size_t shape){
+    if (shape == 0)
+        return "opaque";
+    std::ostringstream os;
+    os<<std::hex<<std::setw(16)<<std::setfill('0')<<shape;
+    return os.str();
+}
+
+vector<ConstraintProfile> Profiler::report(ConstraintInterface* objective,
+        const vector<ConstraintInterface*>& constraints,
+        Idx top_k, Group group)const{
+    vector<ConstraintProfile> res;
+    std::map<string, Idx> groups;
+
+    auto account = [&](const string& key, const string& tag, long row,
+            const Entry& e, const TapeInfo& tape){
+        auto iter = groups.find(key);
+        if (iter == groups.end()){
+            iter = groups.insert({key, res.size()}).first;
+            ConstraintProfile p;
+            p.name = key;
+            p.tag = tag;
+            p.rows = 0;
+            p.example = row;
+            p.calls = 0;
+            p.seconds = 0;
+            p.build_seconds = 0;
+            res.push_back(p);
+        }
+        ConstraintProfile& p = res[iter->second];
+        if (p.tag != tag)
+            p.tag.clear();
+        p.rows++;
+        p.calls += e.calls;
+        p.seconds += e.seconds;
+        p.build_seconds += e.build_seconds;
+        add(p, tape);
+    };
+
+    // the objective is never merged with constraints
+    account("objective", "", -1, obj, objective->tapeInfo());
+
+    const Entry none;
+    for (Idx i=0; i<constraints.size(); i++){
+        const Entry& e = i < entries.size() ? entries[i] : none;
+        const TapeInfo tape = constraints[i]->tapeInfo();
+        const string& t = tag(i);
+        string key;
+        if (group == ROW)
+            key = "row " + std::to_string((long long int)i);
+        else if (group == TAG)
+            key = t.empty() ? "untagged" : t;
+        else
+            key = shapeName(tape.shape);
+        account(key, t, i, e, tape);
+    }
+
+    std::stable_sort(res.begin(), res.end(),
+            [](const ConstraintProfile& a, const ConstraintProfile& b){
+                return a.seconds > b.seconds;
+            });
+    if (top_k > 0 && res.size() > top_k)
+        res.resize(top_k);
+    return res;
+}
+
+string Profiler::str(const vector<ConstraintProfile>& report){
+    std::ostringstream os;
+    os<<std::left<<std::setw(20)<<"name"<<std::right
+        <<std::setw(8)<<"rows"
+        <<std::setw(10)<<"calls"
+        <<std::setw(12)<<"seconds"
+        <<std::setw(10)<<"ns/call"
+        <<std::setw(8)<<"ops"
+        <<std::setw(8)<<"jac"
+        <<std::setw(8)<<"hess"
+        <<std::setw(10)<<"plan"
+        <<std::setw(7)<<"stack"
+        <<"  tag"<<std::endl;
+    FOREACH(p, report)
+    //for (auto& p: report){
+        os<<std::left<<std::setw(20)<<p.name<<std::right
+            <<std::setw(8)<<p.rows
+            <<std::setw(10)<<p.calls
+            <<std::setw(12)<<std::setprecision(6)<<p.seconds
+            <<std::setw(10)<<std::setprecision(4)
+            <<(p.calls ? 1e9*p.seconds/p.calls : 0.0)
+            <<std::setw(8)<<p.tape.operators
+            <<std::setw(8)<<p.tape.jac_nnz
+            <<std::setw(8)<<p.tape.hess_nnz
+            <<std::setw(10)<<p.tape.plan
+            <<std::setw(7)<<p.tape.max_stack
+            <<"  "<<p.tag<<std::endl;
+    }
+    return os.str();
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_PROFILER_H
+#define MADOPT_PROFILER_H
+
+#include <chrono>
+
+#include "common.hpp"
+#include "constraint_interface.hpp"
+
+namespace MadOpt {
+
+//! cost of a constraint or of a group of constraints, \sa Model::profile()
+struct ConstraintProfile {
+    //! "objective", "row <i>", the tag or the shape hash, depending on the
+    //grouping
+    string name;
+    string tag;
+    //! number of aggregated constraints
+    Idx rows;
+    //! first aggregated row, -1 for the objective
+    long example;
+    //! number of timed setEvals calls
+    unsigned long calls;
+    //! time spent in setEvals (computeFinalStack and filling the results)
+    double seconds;
+    //! time spent in building the tape, only recorded while profiling
+    double build_seconds;
+    //! summed over the rows, except max_stack which is the maximum
+    TapeInfo tape;
+};
+
+/*! \brief attributes the evaluation time to the single constraints
+ * \details switched off by default, if enabled every n-th Model::setEvals()
+ * times the setEvals() of the objective and of every constraint separately.
+ * The costs can be reported per row, per user tag (Constraint::tag()) or per
+ * tape shape, constraints with the same shape differ only in their
+ * variables, parameters and constants.
+ */
+class Profiler {
+    public:
+        enum Group {
+            ROW,
+            TAG,
+            SHAPE
+        };
+
+        typedef std::chrono::steady_clock Clock;
+
+        Profiler(): every(1), evaluations(0), _enabled(false){}
+
+        //! profile every n-th setEvals, n > 1 reduces the overhead
+        void enable(bool on, Idx n=1);
+
+        bool enabled()const { return _enabled; }
+
+        //! true if the current setEvals is timed
+        bool sample(){
+            return _enabled && evaluations++ % every == 0;
+        }
+
+        //! resets the timings, keeps the tags
+        void clear();
+
+        //! makes sure that rows constraints can be recorded
+        void resize(Idx rows);
+
+        //! runs and times setEvals of a constraint, row -1 is the objective
+        void setEvals(ConstraintInterface* constraint, CStack& cstack, long row,
+                EvalLevel level=EVAL_HESS);
+
+        void addBuildTime(long row, double seconds);
+
+        void tag(Idx row, const string& tag);
+
+        const string& tag(Idx row)const;
+
+        /*! \brief the top_k most expensive entries, sorted by time
+         * @param[in] objective the objective
+         * @param[in] constraints all constraints of the model
+         * @param[in] top_k maximal number of entries, 0 means all
+         * @param[in] group aggregation of the entries
+         */
+        vector<ConstraintProfile> report(ConstraintInterface* objective,
+                const vector<ConstraintInterface*>& constraints,
+                Idx top_k, Group group)const;
+
+        //! report as table
+        static string str(const vector<ConstraintProfile>& report);
+
+    private:
+        struct Entry {
+            Entry(): calls(0), seconds(0), build_seconds(0){}
+            unsigned long calls;
+            double seconds;
+            double build_seconds;
+        };
+
+        Entry& entry(long row);
+
+        Idx every;
+        unsigned long evaluations;
+        bool _enabled;
+        Entry obj;
+        vector<Entry> entries;
+        vector<string> tags;
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
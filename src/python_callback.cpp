@@ -13,23 +13,159 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "python_callback.hpp"
+#include "cstack.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include "tracing.hpp"
+#include "memory_report.hpp"
 
 namespace MadOpt {
 
+CallbackBlock::CallbackBlock(Idx rows,
+        Idx nnz_jac, const int* jac_rows, const int* jac_cols,
+        Idx nnz_hess, const int* hess_rows, const int* hess_i, const int* hess_j,
+        callback_type callback, void* data):
+    CallbackBlock(callback, data)
+{
+    setPattern(rows, nnz_jac, jac_rows, jac_cols, nnz_hess, hess_rows, hess_i, hess_j);
+}
+
+CallbackBlock::CallbackBlock(callback_type callback, void* data):
+    callback(callback),
+    data(data),
+    eval_id(0),
+    evaluated(false),
+    max_pos(0){}
+
+void CallbackBlock::setPattern(Idx rows,
+        Idx nnz_jac, const int* jac_rows, const int* jac_cols,
+        Idx nnz_hess, const int* hess_rows, const int* hess_i, const int* hess_j){
+    g.assign(rows, 0);
+    jac.assign(nnz_jac, 0);
+    hess.assign(nnz_hess, 0);
+    row_jac.assign(rows, vector<Idx>());
+    row_jac_cols.assign(rows, vector<Idx>());
+    row_hess.assign(rows, vector<Idx>());
+    row_hess_pairs.assign(rows, vector<PII>());
+    max_pos = 0;
+
+    for (Idx k=0; k<nnz_jac; k++){
+        if (jac_rows[k] < 0 || (Idx)jac_rows[k] >= rows || jac_cols[k] < 0)
+            throw MadOptError("invalid jacobian entry of callback constraints");
+        row_jac[jac_rows[k]].push_back(k);
+        row_jac_cols[jac_rows[k]].push_back(jac_cols[k]);
+        max_pos = std::max(max_pos, (Idx)jac_cols[k]);
+    }
+
+    for (Idx k=0; k<nnz_hess; k++){
+        if (hess_rows[k] < 0 || (Idx)hess_rows[k] >= rows || hess_i[k] < 0 || hess_j[k] < 0)
+            throw MadOptError("invalid hessian entry of callback constraints");
+        row_hess[hess_rows[k]].push_back(k);
+        row_hess_pairs[hess_rows[k]].push_back(uPII((Idx)hess_i[k], (Idx)hess_j[k]));
+        max_pos = std::max(max_pos, (Idx)std::max(hess_i[k], hess_j[k]));
+    }
+}
+
+void CallbackBlock::evaluate(CStack& cstack){
+    if (evaluated && eval_id == cstack.getEvalId())
+        return;
+    TRACE_START;
+    TRACE_SPAN("CallbackBlock::evaluate");
+    if (!callback(data, cstack.getX(), cstack.getXSize(),
+                g.data(), jac.data(), hess.data()))
+        throw MadOptError("evaluation of callback constraints failed");
+    eval_id = cstack.getEvalId();
+    evaluated = true;
+    TRACE_END;
+}
+
+PythonCallback::PythonCallback(shared_ptr<CallbackBlock> block, Idx row,
+        double _lb, double _ub):
+    block(block),
+    row(row),
+    _lb(_lb),
+    _ub(_ub),
+    jac(block->row_jac[row].size()){}
+
 double PythonCallback::lb(){
-  return _lb; 
+    return _lb; 
 }
 
 void PythonCallback::lb(double v){
-  _lb=v;
+    _lb=v;
 }
 
 double PythonCallback::ub(){
-  return _ub; 
+    return _ub; 
 }
 
 void PythonCallback::ub(double v){
-  _ub=v;
+    _ub=v;
+}
+
+Idx PythonCallback::getNNZ_Jac(){
+    return jac.size();
+}
+
+void PythonCallback::getNZ_Jac(unsigned int* jCol){
+    const auto& cols = block->row_jac_cols[row];
+    std::copy(cols.begin(), cols.end(), jCol);
+}
+
+void PythonCallback::setHessStructure(HessStructure& hess){
+    hess_map.clear();
+    FOREACH(p, block->row_hess_pairs[row])
+    //for (auto& p: block->row_hess_pairs[row]){
+        hess_map.push_back(hess.add(p));
+    }
+}
+
+void PythonCallback::remapHess(const vector<Idx>& perm){
+    FOREACH(pos, hess_map)
+    //for (auto& pos: hess_map){
+        pos = perm[pos];
+    }
+}
+
+void PythonCallback::finalize(){
+    // the pairs are only read by setHessStructure()
+    vector<PII>().swap(block->row_hess_pairs[row]);
+    hess_map.shrink_to_fit();
+}
+
+void PythonCallback::setEvals(CStack& cstack, EvalLevel level){
+    block->evaluate(cstack);
+    const auto& entries = block->row_jac[row];
+    for (Idx i=0; i<entries.size(); i++)
+        jac[i] = block->jac[entries[i]];
+}
+
+const double& PythonCallback::getG()const{
+    return block->g[row];
+}
+
+const vector<double>& PythonCallback::getJac()const{
+    return jac;
+}
+
+void PythonCallback::eval_h(double* values, const double& lambda){
+    const auto& entries = block->row_hess[row];
+    for (Idx i=0; i<entries.size(); i++)
+        values[hess_map[i]] += lambda*block->hess[entries[i]];
+}
+
+void PythonCallback::addMemory(MemoryReport& report)const{
+    // the block is shared by its rows and not counted
+    report.add("callback", sizeof(PythonCallback) + heapBytes(jac) + heapBytes(hess_map));
+}
+
+TapeInfo PythonCallback::tapeInfo(){
+    TapeInfo info;
+    info.jac_nnz = jac.size();
+    info.hess_nnz = hess_map.size();
+    return info;
 }
 
 }
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
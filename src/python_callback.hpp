@@ -20,31 +20,119 @@
 
 namespace MadOpt {
 
-  class PythonCallback: public ConstraintInterface {
+/*! \brief block of constraints that are evaluated by one external callback,
+ * e.g. a python function
+ * \details the callback is called at most once per new x and fills the
+ * values of all rows of the block at once. The structure of the jacobian and
+ * the hessian is declared in triplet format, the values are written in the
+ * same order. The hessian entries are the second derivatives of the single
+ * rows, hence they do not depend on the multipliers.
+ */
+class CallbackBlock {
     public:
-      typedef double (*g_type)(void *param, void *g_data);
+        /*! \brief callback type, returns false if the evaluation failed
+         * @param[in] data user data given to the constructor
+         * @param[in] x all variable values
+         * @param[in] nx number of variables
+         * @param[out] g rows values
+         * @param[out] jac values of the declared jacobian entries
+         * @param[out] hess values of the declared hessian entries
+         */
+        typedef bool (*callback_type)(void* data, const double* x, Idx nx,
+                double* g, double* jac, double* hess);
+
+        /*!
+         * @param[in] rows number of constraints
+         * @param[in] nnz_jac number of jacobian entries
+         * @param[in] jac_rows row of each jacobian entry
+         * @param[in] jac_cols variable position of each jacobian entry
+         * @param[in] nnz_hess number of hessian entries
+         * @param[in] hess_rows row of each hessian entry
+         * @param[in] hess_i first variable position of each hessian entry
+         * @param[in] hess_j second variable position of each hessian entry
+         * @param[in] callback evaluation callback
+         * @param[in] data passed to the callback
+         */
+        CallbackBlock(Idx rows,
+                Idx nnz_jac, const int* jac_rows, const int* jac_cols,
+                Idx nnz_hess, const int* hess_rows, const int* hess_i, const int* hess_j,
+                callback_type callback, void* data);
+
+        virtual ~CallbackBlock(){}
+
+        //! number of constraints
+        Idx rows()const { return g.size(); }
+
+        //! calls the callback if x changed since the last call
+        void evaluate(CStack& cstack);
+
+        //! largest variable position used by the block
+        Idx maxPos()const { return max_pos; }
+
+    protected:
+        //! for derived blocks that declare their structure with setPattern()
+        CallbackBlock(callback_type callback, void* data);
 
-      PythonCallback(g_type, void *g_data, double _lb, double _ub);
+        //! declares the structure, \sa CallbackBlock()
+        void setPattern(Idx rows,
+                Idx nnz_jac, const int* jac_rows, const int* jac_cols,
+                Idx nnz_hess, const int* hess_rows, const int* hess_i, const int* hess_j);
+
+    private:
+        friend class PythonCallback;
+
+        vector<double> g;
+        vector<double> jac;
+        vector<double> hess;
+
+        //! jacobian entries of each row, index into jac
+        vector<vector<Idx>> row_jac;
+        vector<vector<Idx>> row_jac_cols;
+
+        //! hessian entries of each row, index into hess
+        vector<vector<Idx>> row_hess;
+        vector<vector<PII>> row_hess_pairs;
+
+        callback_type callback;
+        void* data;
+        unsigned long eval_id;
+        bool evaluated;
+        Idx max_pos;
+};
+
+//! one row of a CallbackBlock, \sa Model::addCallbackConstrs()
+class PythonCallback: public ConstraintInterface {
+    public:
+        PythonCallback(shared_ptr<CallbackBlock> block, Idx row, double _lb, double _ub);
 
-      double lb();
-      void lb(double v);
-      double ub();
-      void ub(double v);
+        double lb();
+        void lb(double v);
+        double ub();
+        void ub(double v);
 
-      Idx getNNZ_Jac() = 0;
-      void getNZ_Jac(unsigned int* jCol) = 0;
-      void setEvals(CStack&){}
-      const double& getG()const = 0;
-      const vector<double>& getJac()const = 0;
-      void eval_h(double* values, const double& lambda) = 0;
+        Idx getNNZ_Jac();
+        void getNZ_Jac(unsigned int* jCol);
+        void setHessStructure(HessStructure& hess);
+        void remapHess(const vector<Idx>& perm);
+        void finalize();
+        void setEvals(CStack& stack){ setEvals(stack, EVAL_HESS); }
+        void setEvals(CStack&, EvalLevel level);
+        const double& getG()const;
+        const vector<double>& getJac()const;
+        void eval_h(double* values, const double& lambda);
 
-  private:
-    double _lb;
-    double _ub;
+        TapeInfo tapeInfo();
 
-    g_type g;
-    void* g_data;
+        void addMemory(MemoryReport& report)const;
 
-  };
+    private:
+        shared_ptr<CallbackBlock> block;
+        Idx row;
+        double _lb;
+        double _ub;
+        vector<double> jac;
+        vector<Idx> hess_map;
+};
 }
 #endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -16,6 +16,7 @@
 
 #include "simstack.hpp"
 #include "logger.hpp"
+#include "memory_report.hpp"
 
 namespace MadOpt {
 
@@ -30,12 +31,17 @@ void SimStack::doAdd(const Idx& nofelems){
 }
 
 void SimStack::doMull(){
+    doMul(2);
+}
+
+void SimStack::doMul(const Idx& nofelems){
     TRACE_START;
-    ASSERT_LE(2, size());
-    hess_stack.setJac(jac_stack);
-    hess_stack.merge(2);
-    jac_stack.merge(2);
-    _size -= 1;
+    ASSERT_LE(2, nofelems);
+    ASSERT_LE(nofelems, size());
+    hess_stack.setJacs(jac_stack, nofelems);
+    hess_stack.merge(nofelems);
+    jac_stack.merge(nofelems);
+    _size -= nofelems-1;
     TRACE(str());
     TRACE_END;
 }
@@ -53,6 +59,13 @@ void SimStack::doUnaryOp(const double& jac_value, const double& hess_value){
     TRACE_END;
 }
 
+void SimStack::doDiv(){
+    TRACE_START;
+    doUnaryOp(0, 0);
+    doMull();
+    TRACE_END;
+}
+
 void SimStack::emplace_back(const Idx& id){
     TRACE_START;
     ASSERT(id >= 0);
@@ -116,9 +129,9 @@ Idx SimStack::size(){
     return _size;
 }
 
-void SimStack::setConflicts(Array<Idx>* conflicts){
-    jac_stack.setConflicts(conflicts);
-    hess_stack.setConflicts(conflicts);
+void SimStack::setPlan(Array<Idx>* jac_plan, Array<Idx>* hess_plan){
+    jac_stack.setPlan(jac_plan);
+    hess_stack.setPlan(hess_plan);
 }
 
 const Idx& SimStack::max_g_size()const {
@@ -148,6 +161,12 @@ string SimStack::str(){
     return res;
 }
 
+std::size_t SimStack::bytes()const{
+    return jac_stack.bytes() + hess_stack.bytes() + jac_plan_buffer.bytes()
+        + hess_plan_buffer.bytes() + heapBytes(operator_buffer)
+        + heapBytes(data_buffer);
+}
+
 Idx& SimStack::getDataI(){
     return data_i;
 }
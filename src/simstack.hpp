@@ -20,18 +20,31 @@
 #include "common.hpp"
 #include "jac_simstack.hpp"
 #include "hess_simstack.hpp"
+#include "value.hpp"
 #include <vector>
 
 namespace MadOpt {
 
-class SimStack: public Stack {
+typedef char OPType;
+
+//! symbolic stack, records the structure of the jacobian and the hessian
+//and the evaluation plans of a constraint
+class SimStack {
     public:
+        static const EvalLevel level = EVAL_HESS;
+
 	SimStack(): dummy(0), _size(0), _max_size(0), data_i(0){}
 
         void doAdd(const Idx& nofelems);
         void doMull(); 
+        //! product of the last nofelems elements
+        void doMul(const Idx& nofelems);
         double& lastG();
         void doUnaryOp(const double& jac_value, const double& hess_value);
+        //! the structure of pow(last, -1) and of the product
+        void doDiv();
+        //! a linear unary operator keeps the structure
+        void doScale(const double& factor){}
         void emplace_back(const Idx& id);
         void emplace_back(const double& value);
         void clear();
@@ -47,10 +60,21 @@ class SimStack: public Stack {
         vector<Idx> getJacEntries();
         vector<PII> getHessEntries();
 
-        void setConflicts(Array<Idx>* c);
+        void setPlan(Array<Idx>* jac_plan, Array<Idx>* hess_plan);
+
+        //! reused buffers the constraints record their evaluation plans in
+        Array<Idx>& getJacPlanBuffer(){ return jac_plan_buffer; }
+        Array<Idx>& getHessPlanBuffer(){ return hess_plan_buffer; }
+
+        //! reused buffers the constraints write their tapes in
+        vector<OPType>& getOperatorBuffer(){ return operator_buffer; }
+        vector<Value>& getDataBuffer(){ return data_buffer; }
 
         Idx& getDataI();
 
+        //! allocated heap memory
+        std::size_t bytes()const;
+
         string str();
 
     private:
@@ -60,6 +84,10 @@ class SimStack: public Stack {
         Idx _size;
         Idx _max_size;
         Idx data_i;
+        Array<Idx> jac_plan_buffer;
+        Array<Idx> hess_plan_buffer;
+        vector<OPType> operator_buffer;
+        vector<Value> data_buffer;
 };
 }
 #endif
@@ -24,9 +24,12 @@ namespace MadOpt {
 void Solution::set(const SolverStatus status,
         const Idx x_size, const Idx l_size, 
         const double obj_value, 
-        const double* x, const double* lambda){
+        const double* x, const double* lambda,
+        const double* z_L, const double* z_U){
     lambda_loaded = false;
     _status = status;
+    _z_L.clear();
+    _z_U.clear();
 
     if (hasSolution()){
         _obj_value = obj_value;
@@ -39,6 +42,12 @@ void Solution::set(const SolverStatus status,
             for (Idx i=0; i<ng(); i++)
                 _l[i] = lambda[i];
             lambda_loaded = true;
+        } else
+            _l.clear();
+
+        if (z_L != NULL && z_U != NULL){
+            _z_L.assign(z_L, z_L + x_size);
+            _z_U.assign(z_U, z_U + x_size);
         }
     }
 }
@@ -52,7 +52,8 @@ class Solution{
 	void set(const SolverStatus status,
                 const Idx x_size, const Idx l_size, 
                 const double obj_value, 
-                const double* x, const double* lambda);
+                const double* x, const double* lambda,
+                const double* z_L=NULL, const double* z_U=NULL);
 
         void set(const SolverStatus status,
                 const Idx x_size, 
@@ -71,6 +72,18 @@ class Solution{
 
         double lam(const Idx idx)const ;
 
+        //! all solution values, valid until the next solution is set
+        const vector<double>& getX()const { return _x; }
+
+        //! all constraint multipliers, empty if none are loaded
+        const vector<double>& getLam()const { return _l; }
+
+        //! multipliers of the variable lower bounds, empty if none are loaded
+        const vector<double>& getZ_L()const { return _z_L; }
+
+        //! multipliers of the variable upper bounds, empty if none are loaded
+        const vector<double>& getZ_U()const { return _z_U; }
+
         //! solver status
         SolverStatus status()const ;
 
@@ -85,9 +98,17 @@ class Solution{
         //! returns true if a solution is loaded
         bool hasSolution() const;
 
+        //! allocated heap memory
+        std::size_t bytes()const {
+            return (_x.capacity() + _l.capacity() + _z_L.capacity()
+                    + _z_U.capacity())*sizeof(double);
+        }
+
     private:
         vector<double> _x;
         vector<double> _l;
+        vector<double> _z_L;
+        vector<double> _z_U;
         double _obj_value;
         SolverStatus _status;
         bool lambda_loaded;
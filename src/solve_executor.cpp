@@ -0,0 +1,138 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "solve_executor.hpp"
+
+#include "model.hpp"
+#include "exceptions.hpp"
+#include "logger.hpp"
+#include "tracing.hpp"
+
+namespace MadOpt {
+
+SolveExecutor::SolveExecutor(Idx nof_workers, Idx max_queued):
+    max_queued(max_queued),
+    stop(false)
+{
+    if (nof_workers == 0)
+        throw MadOptError("SolveExecutor needs at least one worker");
+    if (this->max_queued == 0)
+        this->max_queued = 2*nof_workers;
+    for (Idx i=0; i<nof_workers; i++)
+        workers.emplace_back(&SolveExecutor::threadFunction, this);
+}
+
+SolveExecutor::~SolveExecutor(){
+    {
+        std::unique_lock<std::mutex> _lock(lock);
+        stop = true;
+    }
+    job_wait.notify_all();
+    FOREACH(t, workers)
+    //for (auto& t: workers){
+        t.join();
+    }
+}
+
+std::future<Solution> SolveExecutor::submit(Model& model, double timelimit){
+    Job job;
+    job.model = &model;
+    job.timelimit = timelimit;
+    job.done = nullptr;
+    job.data = nullptr;
+    auto future = job.promise.get_future();
+    push(std::move(job));
+    return future;
+}
+
+void SolveExecutor::submit(Model& model, double timelimit,
+        done_type done, void* data){
+    Job job;
+    job.model = &model;
+    job.timelimit = timelimit;
+    job.done = done;
+    job.data = data;
+    push(std::move(job));
+}
+
+Idx SolveExecutor::nofWorkers()const{
+    return workers.size();
+}
+
+Idx SolveExecutor::nofQueued(){
+    std::unique_lock<std::mutex> _lock(lock);
+    return jobs.size();
+}
+
+void SolveExecutor::push(Job&& job){
+    TRACE_START;
+    {
+        std::unique_lock<std::mutex> _lock(lock);
+        queue_wait.wait(_lock, [this]{ return jobs.size() < max_queued; });
+        jobs.push_back(std::move(job));
+    }
+    job_wait.notify_one();
+    TRACE_END;
+}
+
+void SolveExecutor::threadFunction(){
+    SolverWorkspace workspace;
+    while(1){
+        Job job;
+        {
+            std::unique_lock<std::mutex> _lock(lock);
+            job_wait.wait(_lock, [this]{ return stop || !jobs.empty(); });
+            if (jobs.empty())
+                break;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        queue_wait.notify_one();
+        run(job, workspace);
+    }
+}
+
+void SolveExecutor::run(Job& job, SolverWorkspace& workspace){
+    TRACE_START;
+    TRACE_SPAN("SolveExecutor::run");
+    Model& model = *job.model;
+    const double timelimit = model.timelimit;
+    if (job.timelimit >= 0)
+        model.timelimit = job.timelimit;
+
+    string error;
+    std::exception_ptr exception;
+    try {
+        model.solve(workspace);
+    } catch (std::exception& e){
+        error = e.what();
+        exception = std::current_exception();
+    } catch (...){
+        error = "unknown error in solve";
+        exception = std::current_exception();
+    }
+    model.timelimit = timelimit;
+
+    if (job.done != nullptr)
+        job.done(job.data, exception ? error.c_str() : nullptr);
+    else if (exception)
+        job.promise.set_exception(exception);
+    else
+        job.promise.set_value(model.getSolution());
+    TRACE_END;
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
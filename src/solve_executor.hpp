@@ -0,0 +1,134 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_SOLVE_EXECUTOR_H
+#define MADOPT_SOLVE_EXECUTOR_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <typeindex>
+
+#include "common.hpp"
+#include "solution.hpp"
+
+namespace MadOpt {
+
+class Model;
+
+//! per worker storage for solver applications, a model solved by a
+//SolveExecutor takes its initialised solver from here instead of creating
+//its own
+class SolverWorkspace {
+    public:
+        //! base class for the solver specific entries
+        class Entry {
+            public:
+                virtual ~Entry(){}
+        };
+
+        //! returns the entry of type T, it is created on first access
+        template<class T>
+        T& get(){
+            auto& entry = entries[std::type_index(typeid(T))];
+            if (!entry)
+                entry.reset(new T());
+            return static_cast<T&>(*entry);
+        }
+
+    private:
+        unordered_map<std::type_index, unique_ptr<Entry>> entries;
+};
+
+/*! \brief fixed pool of worker threads that solves independent models
+ * \details every worker keeps one SolverWorkspace, hence the solver
+ * applications (IpoptApplication, BonminSetup) are initialised once per
+ * worker and not once per model. A model must not be changed, solved or
+ * destroyed while it is queued or solved by the executor. The linear solver
+ * used by ipopt has to be thread safe (e.g. ma27, ma57), the sequential
+ * MUMPS build is not.
+ */
+class SolveExecutor {
+    public:
+        //! callback type for submit(), error is NULL if the solve succeeded
+        typedef void (*done_type)(void* data, const char* error);
+
+        /*! \brief starts the workers
+         * @param[in] nof_workers number of worker threads
+         * @param[in] max_queued number of jobs that may wait for a worker
+         * before submit() blocks, 0 means twice the number of workers
+         */
+        SolveExecutor(Idx nof_workers, Idx max_queued=0);
+
+        SolveExecutor(SolveExecutor const &) = delete;
+        SolveExecutor(SolveExecutor&&) = delete;
+
+        //! finishes all submitted jobs and stops the workers
+        ~SolveExecutor();
+
+        /*! \brief queue a model for solving, blocks while the queue is full
+         * @param[in] model the model to solve
+         * @param[in] timelimit time limit of this job, a negative value
+         * keeps the timelimit of the model
+         * \return the solution, it is also loaded into the model
+         */
+        std::future<Solution> submit(Model& model, double timelimit=-1);
+
+        /*! \brief \sa submit(Model&, double), instead of a future the
+         * callback done is called by the worker once the job is finished
+         */
+        void submit(Model& model, double timelimit, done_type done, void* data);
+
+        //! number of worker threads
+        Idx nofWorkers()const;
+
+        //! number of jobs waiting for a worker
+        Idx nofQueued();
+
+    private:
+        struct Job {
+            Model* model;
+            double timelimit;
+            std::promise<Solution> promise;
+            done_type done;
+            void* data;
+        };
+
+        std::vector<std::thread> workers;
+
+        std::deque<Job> jobs;
+
+        std::mutex lock;
+
+        std::condition_variable job_wait;
+
+        std::condition_variable queue_wait;
+
+        Idx max_queued;
+
+        bool stop;
+
+        void push(Job&& job);
+
+        void threadFunction();
+
+        void run(Job& job, SolverWorkspace& workspace);
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_SOLVE_STATS_H
+#define MADOPT_SOLVE_STATS_H
+
+#include <chrono>
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+//! statistics of the last solve(), only collected if madopt is built with
+//ENABLE_STATS, otherwise all counters stay 0
+struct SolveStats {
+    //! number of calls and wall clock time spent in them
+    struct Counter {
+        Counter(): calls(0), seconds(0){}
+        unsigned long calls;
+        double seconds;
+    };
+
+    //! adds the lifetime of the timer to a counter
+    class Timer {
+        public:
+            Timer(Counter& counter): counter(counter),
+                start(std::chrono::steady_clock::now()){}
+
+            ~Timer(){
+                counter.calls++;
+                counter.seconds += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start).count();
+            }
+
+        private:
+            Counter& counter;
+            std::chrono::steady_clock::time_point start;
+    };
+
+    SolveStats(){ clear(); }
+
+    Counter eval_f;
+    Counter eval_grad_f;
+    Counter eval_g;
+    Counter eval_jac_g;
+    Counter eval_h;
+    //! get_nlp_info, bounds, starting point and the sparsity structure
+    Counter structure;
+    //! Model::setEvals(), it runs inside the eval callbacks
+    Counter set_evals;
+
+    //! solve() itself
+    Counter solve;
+
+    //! solver iterations, -1 if unknown
+    long iterations;
+    //! wall clock time the solver reports for its algorithm, -1 if unknown
+    double solver_seconds;
+
+    //! time spent in madopt callbacks
+    double callbackSeconds()const {
+        return eval_f.seconds + eval_grad_f.seconds + eval_g.seconds
+            + eval_jac_g.seconds + eval_h.seconds + structure.seconds;
+    }
+
+    void clear(){
+        eval_f = eval_grad_f = eval_g = eval_jac_g = eval_h = Counter();
+        structure = set_evals = solve = Counter();
+        iterations = -1;
+        solver_seconds = -1;
+    }
+};
+
+#ifdef ENABLE_STATS
+#define STATS_TIMER(counter) SolveStats::Timer _stats_timer(counter)
+#define STATS(code) code
+#else
+#define STATS_TIMER(counter)
+#define STATS(code)
+#endif
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_SOLVER_OPTIONS_H
+#define MADOPT_SOLVER_OPTIONS_H
+
+#include <map>
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+//! options set on a model, recorded so they can be applied to whichever
+//solver application ends up solving the model
+struct SolverOptions {
+    std::map<string, string> strings;
+    std::map<string, double> numerics;
+    std::map<string, int> integers;
+
+    //! applies all options to an Ipopt::OptionsList
+    template<class OptionsList>
+    void applyTo(OptionsList& options)const{
+        FOREACH(o, strings)
+        //for (auto& o: strings){
+            options.SetStringValue(o.first, o.second);
+        }
+        FOREACH(o, numerics)
+        //for (auto& o: numerics){
+            options.SetNumericValue(o.first, o.second);
+        }
+        FOREACH(o, integers)
+        //for (auto& o: integers){
+            options.SetIntegerValue(o.first, o.second);
+        }
+    }
+};
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -20,19 +20,23 @@
 
 namespace MadOpt {
 
-class Stack {
-    public:
-        virtual ~Stack(){}
+//! what an evaluation computes, each level includes the lower ones
+enum EvalLevel {
+    EVAL_NONE,
+    //! values only
+    EVAL_VALUE,
+    //! values and jacobian
+    EVAL_JAC,
+    //! values, jacobian and hessian
+    EVAL_HESS
+};
 
-        virtual void doAdd(const Idx& nofelems)=0;
-        virtual void doMull()=0; 
-        virtual double& lastG()=0;
-        virtual void doUnaryOp(const double& jac_value, const double& hess_value)=0;
-        virtual void emplace_back(const Idx& id)=0;
-        virtual void emplace_back(const double& value)=0;
-        virtual Idx size()=0;
-        virtual void clear()=0;
-        virtual Idx& getDataI()=0;
+//! how the derivatives are evaluated
+enum Engine {
+    //! replays the plans the symbolic pass compiled, \sa ListSimStack::merge()
+    ENGINE_PLAN,
+    //! resolves the conflicts while evaluating, \sa VStack
+    ENGINE_ONE_PASS
 };
 }
 #endif
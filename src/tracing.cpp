@@ -0,0 +1,197 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "tracing.hpp"
+#include "exceptions.hpp"
+
+namespace MadOpt {
+
+std::atomic<bool> Tracing::active(false);
+
+namespace {
+    //! ring buffer of one thread, only that thread writes
+    struct TraceBuffer {
+        TraceBuffer(Idx tid): events(Tracing::buffer_size), head(0), writing(false), tid(tid){}
+        vector<Tracing::Event> events;
+        std::atomic<uint64_t> head;
+        //! true while record() writes, dump() and clear() wait for it
+        std::atomic<bool> writing;
+        Idx tid;
+    };
+
+    //! buffers of all threads that recorded, the buffer of a finished thread
+    //keeps its events and is reused by the next thread, hence there are as
+    //many buffers as threads ever traced at the same time
+    struct TraceRegistry {
+        std::mutex lock;
+        vector<unique_ptr<TraceBuffer>> buffers;
+        vector<TraceBuffer*> unused;
+    };
+
+    TraceRegistry& registry(){
+        static TraceRegistry r;
+        return r;
+    }
+
+    //! returns the buffer to the registry when the thread exits
+    struct BufferOwner {
+        BufferOwner(): buffer(nullptr){}
+        ~BufferOwner(){
+            if (buffer == nullptr)
+                return;
+            auto& r = registry();
+            std::unique_lock<std::mutex> _lock(r.lock);
+            r.unused.push_back(buffer);
+        }
+        TraceBuffer* buffer;
+    };
+
+    thread_local BufferOwner local_buffer;
+
+    TraceBuffer* localBuffer(){
+        if (local_buffer.buffer == nullptr){
+            auto& r = registry();
+            std::unique_lock<std::mutex> _lock(r.lock);
+            if (r.unused.empty()){
+                r.buffers.emplace_back(new TraceBuffer(r.buffers.size()));
+                local_buffer.buffer = r.buffers.back().get();
+            } else {
+                local_buffer.buffer = r.unused.back();
+                r.unused.pop_back();
+            }
+        }
+        return local_buffer.buffer;
+    }
+
+    //! waits until no thread is inside record(), the caller holds the
+    //registry lock and tracing is disabled, hence no record() starts
+    void waitForWriters(TraceRegistry& r){
+        FOREACH(buffer, r.buffers)
+        //for (auto& buffer: r.buffers){
+            while (buffer->writing.load(std::memory_order_seq_cst))
+                std::this_thread::yield();
+        }
+    }
+
+    string& envPath(){
+        static string path;
+        return path;
+    }
+
+    void dumpAtExit(){
+        Tracing::enable(false);
+        Tracing::dump(envPath());
+    }
+
+    //! MADOPT_TRACE=file enables tracing at startup and dumps at exit
+    struct TraceEnv {
+        TraceEnv(){
+            const char* path = std::getenv("MADOPT_TRACE");
+            if (path == nullptr || *path == 0)
+                return;
+            envPath() = path;
+            // constructed before atexit, hence destroyed after the dump
+            registry();
+            Tracing::enable(true);
+            std::atexit(dumpAtExit);
+        }
+    } trace_env;
+}
+
+void Tracing::enable(bool on){
+    active.store(on, std::memory_order_seq_cst);
+}
+
+void Tracing::record(const char* name, uint64_t start, uint64_t duration){
+    TraceBuffer* buffer = localBuffer();
+    // together with the seq_cst store in enable() and the load in
+    // waitForWriters() either dump() sees writing or record() sees the
+    // disabled tracing, spans that end after enable(false) are dropped
+    buffer->writing.store(true, std::memory_order_seq_cst);
+    if (!active.load(std::memory_order_seq_cst)){
+        buffer->writing.store(false, std::memory_order_release);
+        return;
+    }
+    const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& e = buffer->events[head % buffer_size];
+    e.name = name;
+    e.start = start;
+    e.duration = duration;
+    buffer->head.store(head + 1, std::memory_order_relaxed);
+    buffer->writing.store(false, std::memory_order_release);
+}
+
+void Tracing::clear(){
+    if (enabled())
+        throw MadOptError("Tracing::clear() needs disabled tracing");
+    auto& r = registry();
+    std::unique_lock<std::mutex> _lock(r.lock);
+    waitForWriters(r);
+    FOREACH(buffer, r.buffers)
+    //for (auto& buffer: r.buffers){
+        buffer->head.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Tracing::dump(std::ostream& os){
+    if (enabled())
+        throw MadOptError("Tracing::dump() needs disabled tracing");
+    auto& r = registry();
+    std::unique_lock<std::mutex> _lock(r.lock);
+    waitForWriters(r);
+
+    uint64_t origin = std::numeric_limits<uint64_t>::max();
+    FOREACH(buffer, r.buffers)
+    //for (auto& buffer: r.buffers){
+        const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        for (uint64_t i=head > buffer_size ? head - buffer_size : 0; i<head; i++)
+            origin = std::min(origin, buffer->events[i % buffer_size].start);
+    }
+
+    os.precision(3);
+    os<<std::fixed;
+    os<<"{\"traceEvents\": [";
+    bool first = true;
+    FOREACH(buffer, r.buffers)
+    //for (auto& buffer: r.buffers){
+        const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+        for (uint64_t i=head > buffer_size ? head - buffer_size : 0; i<head; i++){
+            const Event& e = buffer->events[i % buffer_size];
+            os<<(first ? "\n" : ",\n")<<"{\"name\": \""<<e.name
+                <<"\", \"ph\": \"X\", \"pid\": 0, \"tid\": "<<buffer->tid
+                <<", \"ts\": "<<(e.start - origin)/1000.
+                <<", \"dur\": "<<e.duration/1000.<<"}";
+            first = false;
+        }
+    }
+    os<<"\n], \"displayTimeUnit\": \"ns\"}"<<std::endl;
+}
+
+bool Tracing::dump(const string& path){
+    std::ofstream file(path);
+    if (!file)
+        return false;
+    dump(file);
+    return true;
+}
+
+}
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_TRACING_H
+#define MADOPT_TRACING_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "common.hpp"
+
+namespace MadOpt {
+
+/*! \brief runtime switchable tracing of spans, e.g. setEvals or the solver
+ * callbacks, exported in the chrome trace format (chrome://tracing,
+ * perfetto)
+ * \details every thread writes into its own ring buffer of the last
+ * buffer_size events without locking, older events are overwritten. The
+ * buffer of a finished thread is reused by the next one. While tracing is
+ * disabled a span costs one relaxed atomic load, spans that end after
+ * tracing was disabled are not recorded. Setting the environment variable
+ * MADOPT_TRACE=file.json enables tracing at startup and dumps the trace at
+ * exit.
+ */
+class Tracing {
+    public:
+        //! events kept per thread
+        static const Idx buffer_size = 1<<16;
+
+        struct Event {
+            const char* name;
+            uint64_t start;
+            uint64_t duration;
+        };
+
+        //! records the lifetime of the object as event, name has to be a
+        //string literal
+        class Span {
+            public:
+                Span(const char* name): name(enabled() ? name : nullptr),
+                    start(this->name ? now() : 0){}
+
+                ~Span(){
+                    if (name)
+                        record(name, start, now() - start);
+                }
+
+            private:
+                const char* name;
+                uint64_t start;
+        };
+
+        static bool enabled(){ return active.load(std::memory_order_relaxed); }
+
+        static void enable(bool on);
+
+        //! drops all recorded events, throws a MadOptError if tracing is
+        //enabled, waits for spans that are just being recorded
+        static void clear();
+
+        //! writes all recorded events as chrome trace json, \sa clear()
+        static void dump(std::ostream& os);
+
+        //! \sa dump(std::ostream&), returns false if path can not be written
+        static bool dump(const string& path);
+
+    private:
+        static std::atomic<bool> active;
+
+        static uint64_t now(){
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        static void record(const char* name, uint64_t start, uint64_t duration);
+};
+
+#define TRACE_SPAN(name) Tracing::Span _trace_span(name)
+
+}
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
@@ -14,112 +14,103 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "vstack.hpp"
+#include "hess_structure.hpp"
+#include "exceptions.hpp"
 #include "logger.hpp"
 
 namespace MadOpt {
 
-void VStack::doADD(Idx nofelems){
+template<EvalLevel level>
+void VStack::mulFactors(const Idx& nofelems){
     TRACE_START;
     ASSERT_LE(nofelems, size());
-    jac_stack.merge(nofelems);
-    hess_stack.merge(nofelems);
-
-    double& goal = g_stack[g_stack_end-nofelems];
-    for (Idx i=0; i<nofelems-1; i++){
-        goal += g_stack[--g_stack_end];
+    const double* factors = &g_stack[g_stack_end-nofelems];
+    const Idx last = nofelems-1;
+    if (prefix.size() < nofelems){
+        prefix.resize(nofelems);
+        suffix.resize(nofelems);
     }
-
-    ASSERT_EQ(size(), jac_stack.size());
-    ASSERT_EQ(size(), hess_stack.size());
-    TRACE_END;
-}
-
-void VStack::doMUL(){
-    TRACE_START;
-    ASSERT_LE(1, size());
-
-    double& last = g_stack[--g_stack_end];
-    double& prev = g_stack[g_stack_end-1];
-
-    hess_stack.merge(prev, last);
-    hess_stack.mergeJacInto(jac_stack);
-    jac_stack.merge(prev, last);
-    prev *= last;
-    ASSERT_EQ(size(), jac_stack.size());
-    ASSERT_EQ(size(), hess_stack.size());
-    TRACE_END;
-}
-
-double& VStack::lastG(){
-    return g_stack[g_stack_end-1];
-}
-
-void VStack::doUnaryOp(const double& jac_value, const double& hess_value){
-    TRACE_START;
-    hess_stack.mergeSingle(jac_stack, jac_value, hess_value);
-    jac_stack.mulAll(jac_value);
-    ASSERT_EQ(size(), jac_stack.size());
-    ASSERT_EQ(size(), hess_stack.size());
-    TRACE_END;
-}
-
-void VStack::emplace_back(const Idx& id){
-    TRACE_START;
-    DEBUG_CODE(Idx s = size());
-
-    ensureElem();
-    g_stack[g_stack_end++] = x[id];
-    jac_stack.emplace_back(id, 1);
-    hess_stack.emplace_back_empty();
-    ASSERT_EQ(size(), s+1);
-    ASSERT_EQ(size(), jac_stack.size());
-    ASSERT_EQ(size(), hess_stack.size());
+    prefix[0] = 1;
+    for (Idx i=1; i<nofelems; i++)
+        prefix[i] = prefix[i-1]*factors[i-1];
+    if (level >= EVAL_JAC){
+        suffix[last] = 1;
+        for (Idx i=last; i>0; i--)
+            suffix[i-1] = suffix[i]*factors[i];
+    }
+    if (level >= EVAL_HESS){
+        for (Idx l=0; l<nofelems; l++)
+            hess_stack.mulList(nofelems-l, prefix[l]*suffix[l]);
+        hess_stack.merge(nofelems);
+        hess_stack.mergeJacsInto(jac_stack, nofelems, factors, prefix.data(), suffix.data());
+    }
+    if (level >= EVAL_JAC){
+        for (Idx l=0; l<nofelems; l++)
+            jac_stack.mulList(nofelems-l, prefix[l]*suffix[l]);
+        jac_stack.merge(nofelems);
+    }
+    const double res = prefix[last]*factors[last];
+    g_stack_end -= last;
+    g_stack[g_stack_end-1] = res;
+    ASSERT_IF(level >= EVAL_JAC, size() == jac_stack.size());
+    ASSERT_IF(level >= EVAL_HESS, size() == hess_stack.size());
     TRACE_END;
 }
 
-void VStack::emplace_back(const double& value){
-    TRACE_START;
-    DEBUG_CODE(Idx s = size());
-
-    ensureElem();
-    g_stack[g_stack_end++] = value;
-    jac_stack.emplace_back_empty();
-    hess_stack.emplace_back_empty();
-    ASSERT_EQ(size(), s+1);
-    ASSERT_EQ(size(), jac_stack.size());
-    ASSERT_EQ(size(), hess_stack.size());
-    TRACE_END;
-}
+template void VStack::mulFactors<EVAL_VALUE>(const Idx&);
+template void VStack::mulFactors<EVAL_JAC>(const Idx&);
+template void VStack::mulFactors<EVAL_HESS>(const Idx&);
 
 void VStack::clear(){
     TRACE_START;
-    ASSERT_EQ(g_stack_end, jac_stack.size());
-    ASSERT_EQ(g_stack_end, hess_stack.size());
-
     jac_stack.clear();
     hess_stack.clear();
     data_i = 0;
     g_stack_end = 0;
-
-    ASSERT_EQ(g_stack_end, jac_stack.size());
-    ASSERT_EQ(g_stack_end, hess_stack.size());
     TRACE_END;
 }
 
-Idx VStack::size(){
-    ASSERT_EQ(g_stack_end, jac_stack.size());
-    ASSERT_EQ(g_stack_end, hess_stack.size());
-    return g_stack_end;
-}
+void VStack::optimizeAlignment(const ArenaVector<Idx>& jac_entries,
+        const ArenaVector<Idx>& hess_map,
+        ArenaVector<Idx>& jac_align, ArenaVector<Idx>& hess_align){
+    TRACE_START;
+    ASSERT(structure != nullptr && structure->compressed());
+    if (jac_stack.length() != jac_entries.size()
+            || hess_stack.length() != hess_map.size())
+        throw MadOptError("the one pass engine found other entries than the constraint");
+
+    // (variable or position, index in the constraint), sorted for lookups
+    vector<PII> index(jac_entries.size());
+    for (Idx k=0; k<jac_entries.size(); k++)
+        index[k] = PII(jac_entries[k], k);
+    std::sort(index.begin(), index.end());
+    jac_align.resize(jac_entries.size());
+    for (Idx i=1; i<=jac_stack.length(); i++){
+        const PII key(jac_stack.getStackElemId(i), 0);
+        auto iter = std::lower_bound(index.begin(), index.end(), key);
+        if (iter == index.end() || iter->first != key.first)
+            throw MadOptError("the one pass engine found a jacobian entry that is not in the constraint");
+        jac_align[i-1] = iter->second;
+    }
 
-void VStack::fill(double* jac, double* hess){
-    jac_stack.fill(jac);
-    hess_stack.fill(hess);
+    index.resize(hess_map.size());
+    for (Idx k=0; k<hess_map.size(); k++)
+        index[k] = PII(hess_map[k], k);
+    std::sort(index.begin(), index.end());
+    hess_align.resize(hess_map.size());
+    for (Idx i=1; i<=hess_stack.length(); i++){
+        const PII key(structure->find(hess_stack.getStackElemId(i)), 0);
+        auto iter = std::lower_bound(index.begin(), index.end(), key);
+        if (iter == index.end() || iter->first != key.first)
+            throw MadOptError("the one pass engine found a hessian entry that is not in the constraint");
+        hess_align[i-1] = iter->second;
+    }
+    TRACE_END;
 }
 
-void VStack::optimizeAlignment(){}
-
 Idx VStack::getNNZ_Jac(){
     return jac_stack.length();
 }
@@ -142,15 +133,21 @@ vector<HessPair> VStack::getHessEntries(){
 
 void VStack::setX(const double* xx, const Idx& size){
     x = xx;
+    if (size == x_size)
+        return;
     x_size = size;
     jac_stack.setXSize(size);
     hess_stack.setXSize(size);
 }
 
+std::size_t VStack::bytes()const{
+    return (g_stack.capacity() + prefix.capacity() + suffix.capacity())*sizeof(double)
+        + jac_stack.bytes() + hess_stack.bytes();
+}
+
 void VStack::ensureElem(){
     if (g_stack_end == g_stack.size())
         g_stack.resize(g_stack_end+1);
 }
 
 }
-
@@ -20,6 +20,8 @@
 #include <map>
 #include <string.h>
 
+#include "stack.hpp"
+#include "arena.hpp"
 #include "jacstack.hpp"
 #include "hessstack.hpp"
 
@@ -27,27 +29,65 @@ namespace MadOpt {
 
 using namespace std;
 
+class HessStructure;
+
+/*! \brief stack of the one pass engine, \sa ENGINE_ONE_PASS
+ * \details resolves the conflicts of the jacobian and the hessian entries
+ * while evaluating, with the last stack position of every variable and
+ * pair, instead of replaying the plans of the symbolic pass. The entries
+ * come out in the order of the resolution, optimizeAlignment() maps them to
+ * the entries of a constraint.
+ */
 class VStack {
     public:
-        void doADD(Idx nofelems);
+        template<EvalLevel level> void doAdd(const Idx& nofelems);
+
+        template<EvalLevel level> void doMull();
 
-        void doMUL();
+        //! product of the last nofelems elements, \sa CStack::doMul()
+        template<EvalLevel level> void doMul(const Idx& nofelems);
 
         double& lastG();
 
+        template<EvalLevel level>
         void doUnaryOp(const double& jac_value, const double& hess_value);
 
-        void emplace_back(const Idx& id);
+        //! divides the previous element by the last one
+        template<EvalLevel level> void doDiv();
 
-        void emplace_back(const double& value);
+        //! multiplies the derivatives of the last element with factor
+        template<EvalLevel level> void doScale(const double& factor);
+
+        template<EvalLevel level> void emplace_back(const Idx& id);
+
+        template<EvalLevel level> void emplace_back(const double& value);
 
         void clear();
 
-        Idx size();
+        Idx size(){ return g_stack_end; }
+
+        Idx& getDataI(){ return data_i; }
 
-        void fill(double* jac, double* hess);
+        //! copies the results to the entries of the constraint, the stack
+        //entry i goes to jac[jac_align[i]] and hess[hess_align[i]]
+        template<EvalLevel level>
+        void fill(double& g, double* jac, double* hess,
+                const Idx* jac_align, const Idx* hess_align);
 
-        void optimizeAlignment();
+        /*! \brief maps the entries of the last evaluation to the entries of
+         * a constraint
+         * \details the order of the resolution only depends on the tape,
+         * the alignment of one evaluation at EVAL_HESS is valid for all
+         * evaluations of the same constraint. Allocates, hence it is only
+         * called for the first one.
+         * @param jac_entries the variables of the jacobian entries
+         * @param hess_map the positions of the hessian entries in the
+         * structure, \sa setStructure()
+         * @param[out] jac_align @param[out] hess_align \sa fill()
+         */
+        void optimizeAlignment(const ArenaVector<Idx>& jac_entries,
+                const ArenaVector<Idx>& hess_map,
+                ArenaVector<Idx>& jac_align, ArenaVector<Idx>& hess_align);
 
         Idx getNNZ_Jac();
 
@@ -55,19 +95,200 @@ class VStack {
 
         vector<HessPair> getHessEntries();
 
+        //! the compressed hessian structure the positions of the
+        //constraints refer to
+        void setStructure(const HessStructure* s){ structure = s; }
+
         void setX(const double* xx, const Idx& size);
 
-        Idx data_i=0;
+        //! allocated heap memory
+        std::size_t bytes()const;
 
     private:
         vector<double> g_stack;
         Idx g_stack_end=0;
         JacStack jac_stack;
         HessStack hess_stack;
-        const double* x;
+        const double* x=nullptr;
         Idx x_size=0;
+        Idx data_i=0;
+        const HessStructure* structure=nullptr;
+        //! products of the factors before and after each factor of doMul()
+        vector<double> prefix;
+        vector<double> suffix;
 
         void ensureElem();
+
+        //! doMul() of more than two factors, \sa CStack::mulFactors()
+        template<EvalLevel level> void mulFactors(const Idx& nofelems);
+};
+
+/*! \brief a VStack that evaluates up to level, the stack type of the one
+ * pass instantiations of InnerConstraint::computeFinalStack()
+ * \details the one pass counterpart of CSweep
+ */
+template<EvalLevel L>
+class VSweep {
+    public:
+        static const EvalLevel level = L;
+
+        VSweep(VStack& stack): stack(stack){}
+
+        void doAdd(const Idx& nofelems){ stack.doAdd<L>(nofelems); }
+        void doMull(){ stack.doMull<L>(); }
+        void doMul(const Idx& nofelems){ stack.doMul<L>(nofelems); }
+        double& lastG(){ return stack.lastG(); }
+        void doUnaryOp(const double& jac_value, const double& hess_value){
+            stack.doUnaryOp<L>(jac_value, hess_value);
+        }
+        void doDiv(){ stack.doDiv<L>(); }
+        void doScale(const double& factor){ stack.doScale<L>(factor); }
+        void emplace_back(const Idx& id){ stack.emplace_back<L>(id); }
+        void emplace_back(const double& value){ stack.emplace_back<L>(value); }
+        Idx size(){ return stack.size(); }
+        Idx& getDataI(){ return stack.getDataI(); }
+        void fill(double& g, double* jac, double* hess,
+                const Idx* jac_align, const Idx* hess_align){
+            stack.fill<L>(g, jac, hess, jac_align, hess_align);
+        }
+
+    private:
+        VStack& stack;
 };
+
+template<EvalLevel level>
+inline void VStack::doAdd(const Idx& nofelems){
+    TRACE_START;
+    ASSERT_LE(nofelems, size());
+    if (level >= EVAL_JAC)
+        jac_stack.merge(nofelems);
+    if (level >= EVAL_HESS)
+        hess_stack.merge(nofelems);
+
+    double& goal = g_stack[g_stack_end-nofelems];
+    for (Idx i=0; i<nofelems-1; i++){
+        goal += g_stack[--g_stack_end];
+    }
+    ASSERT_IF(level >= EVAL_JAC, size() == jac_stack.size());
+    ASSERT_IF(level >= EVAL_HESS, size() == hess_stack.size());
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::doMull(){
+    TRACE_START;
+    ASSERT_LE(2, size());
+
+    double& last = g_stack[--g_stack_end];
+    double& prev = g_stack[g_stack_end-1];
+
+    if (level >= EVAL_HESS){
+        hess_stack.merge(prev, last);
+        hess_stack.mergeJacInto(jac_stack, 1);
+    }
+    if (level >= EVAL_JAC)
+        jac_stack.merge(prev, last);
+    prev *= last;
+    ASSERT_IF(level >= EVAL_JAC, size() == jac_stack.size());
+    ASSERT_IF(level >= EVAL_HESS, size() == hess_stack.size());
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::doMul(const Idx& nofelems){
+    if (nofelems == 2)
+        doMull<level>();
+    else
+        mulFactors<level>(nofelems);
+}
+
+inline double& VStack::lastG(){
+    return g_stack[g_stack_end-1];
+}
+
+template<EvalLevel level>
+inline void VStack::doUnaryOp(const double& jac_value, const double& hess_value){
+    TRACE_START;
+    if (level >= EVAL_HESS)
+        hess_stack.mergeSingle(jac_stack, jac_value, hess_value);
+    if (level >= EVAL_JAC)
+        jac_stack.mulAll(jac_value);
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::doDiv(){
+    TRACE_START;
+    ASSERT_LE(2, size());
+
+    const double& last = g_stack[--g_stack_end];
+    double& prev = g_stack[g_stack_end-1];
+    const double inv = 1/last;
+    const double res = prev/last;
+
+    if (level >= EVAL_HESS){
+        // d/dv = -u/v^2, d2/dv2 = 2u/v^3, d2/dudv = -1/v^2
+        hess_stack.mergeSingle(jac_stack, -res*inv, 2*res*inv*inv);
+        hess_stack.merge(1, inv);
+        hess_stack.mergeJacInto(jac_stack, -inv*inv);
+    }
+    if (level >= EVAL_JAC)
+        jac_stack.merge(-res*inv, inv);
+    prev = res;
+    ASSERT_IF(level >= EVAL_JAC, size() == jac_stack.size());
+    ASSERT_IF(level >= EVAL_HESS, size() == hess_stack.size());
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::doScale(const double& factor){
+    if (level >= EVAL_HESS)
+        hess_stack.mulAll(factor);
+    if (level >= EVAL_JAC)
+        jac_stack.mulAll(factor);
+}
+
+template<EvalLevel level>
+inline void VStack::emplace_back(const Idx& id){
+    TRACE_START;
+    ASSERT_LE(id, x_size-1);
+    ensureElem();
+    g_stack[g_stack_end++] = x[id];
+    if (level >= EVAL_JAC)
+        jac_stack.emplace_back(id, 1);
+    if (level >= EVAL_HESS)
+        hess_stack.emplace_back_empty();
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::emplace_back(const double& value){
+    TRACE_START;
+    ensureElem();
+    g_stack[g_stack_end++] = value;
+    if (level >= EVAL_JAC)
+        jac_stack.emplace_back_empty();
+    if (level >= EVAL_HESS)
+        hess_stack.emplace_back_empty();
+    TRACE_END;
+}
+
+template<EvalLevel level>
+inline void VStack::fill(double& g, double* jac, double* hess,
+        const Idx* jac_align, const Idx* hess_align){
+    ASSERT_EQ(size(), 1);
+    g = lastG();
+    if (level >= EVAL_JAC){
+        const auto& stack = jac_stack.getStack();
+        for (Idx i=1; i<jac_stack.getEnd(); i++)
+            jac[jac_align[i-1]] = stack[i].value;
+    }
+    if (level >= EVAL_HESS){
+        const auto& stack = hess_stack.getStack();
+        for (Idx i=1; i<hess_stack.getEnd(); i++)
+            hess[hess_align[i-1]] = stack[i].value;
+    }
+}
+
 }
 #endif
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MADOPT_ALLOC_COUNTER_H
+#define MADOPT_ALLOC_COUNTER_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*! \brief counting global operator new for the test runner
+ * \details replaces the global allocation functions, must only be included
+ * by one translation unit (the cxxtest runner). While an AllocCounter is in
+ * scope every allocation and deallocation of the current thread is counted.
+ */
+class AllocCounter {
+    public:
+        AllocCounter(): start(counted()), start_freed(freed()){ active()++; }
+
+        ~AllocCounter(){ active()--; }
+
+        //! allocations since construction
+        unsigned long allocations()const { return counted() - start; }
+
+        //! deallocations since construction
+        unsigned long deallocations()const { return freed() - start_freed; }
+
+        static void count(){
+            if (active() > 0)
+                counted()++;
+        }
+
+        static void countFree(){
+            if (active() > 0)
+                freed()++;
+        }
+
+    private:
+        unsigned long start;
+        unsigned long start_freed;
+
+        static int& active(){
+            static thread_local int a = 0;
+            return a;
+        }
+
+        static unsigned long& counted(){
+            static thread_local unsigned long c = 0;
+            return c;
+        }
+
+        static unsigned long& freed(){
+            static thread_local unsigned long c = 0;
+            return c;
+        }
+};
+
+void* operator new(std::size_t size){
+    AllocCounter::count();
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size){
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    if (p != NULL)
+        AllocCounter::countFree();
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+#endif
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
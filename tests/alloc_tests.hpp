@@ -0,0 +1,178 @@
+/*
+ * Copyright 2014 National ICT Australia Limited (NICTA)
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cxxtest/TestSuite.h>
+#include "alloc_counter.hpp"
+#include "testmodel.hpp"
+#include "../src/blackbox.hpp"
+#include "../src/tracing.hpp"
+using namespace MadOpt;
+
+// g0 = a*b*a, g1 = sin(b) + c^2
+class AllocBox: public BlackBox {
+    public:
+        AllocBox(const vector<Var>& vars, Jacobian jacobian):
+            BlackBox(vars, 2, {PII(0, 0), PII(0, 1), PII(1, 1), PII(1, 2)},
+                    jacobian, SECOND_DIFFERENCE){}
+
+        void g(const double* x, double* g)const { eval(x, g); }
+
+        void g(const std::complex<double>* x, std::complex<double>* g)const { eval(x, g); }
+
+    private:
+        template<class T>
+        void eval(const T* x, T* g)const {
+            g[0] = x[0]*x[1]*x[0];
+            g[1] = sin(x[1]) + x[2]*x[2];
+        }
+};
+
+//! the evaluation after the first iteration must not touch the heap
+class AllocTest: public CxxTest::TestSuite {
+    public:
+        void testCounter(){
+            AllocCounter counter;
+            vector<double> v(10);
+            TS_ASSERT_EQUALS(counter.allocations(), 1);
+        }
+
+        void testEvaluation(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<6; i++)
+                x.push_back(m.addVar(0.5, 2, 1, "x" + std::to_string((long long int)i)));
+            Param p = m.addParam(2, "p");
+            m.setObj(x[0]*x[1] + pow(x[2], 3) + p*x[3]*x[3] + 4);
+            m.addConstr(0, x[0]*x[1]*x[0], 10);
+            m.addConstr(0, sin(x[0]) + cos(x[1]*x[2]) + tan(x[3]), 10);
+            m.addConstr(0, log2(x[4]) + ln(x[5])*x[4], 10);
+            m.addConstr(0, pow(x[0] + x[1]*x[2] + p, 2)*x[3], 10);
+            m.addConstr(0, 2*x[0] + 3*x[1] - x[5], 10);
+            m.addConstr(0, (x[0]*x[1] + x[2])*(x[3]*x[4] + x[5]), 10);
+            m.addConstr(0, Expr(1), 10);
+            m.addConstr(0, sin(x[3] + p)*x[5]*pow(x[4], 0.5), 10);
+
+            const Idx nnz_jac = m.getNNZ_Jac();
+            const Idx nnz_hess = m.getNNZ_Hess();
+            vector<double> x0(m.nx(), 1);
+            vector<double> x1 = {0.6, 1.1, 1.4, 0.9, 1.7, 1.2};
+            vector<double> grad(m.nx()), g(m.ng()), jac(nnz_jac), hess(nnz_hess);
+            vector<double> lambda(m.ng(), 1);
+            double f;
+
+            auto iteration = [&](const vector<double>& xx){
+                m.eval_f(xx.data(), true, f);
+                m.eval_grad_f(xx.data(), false, grad.data());
+                m.eval_g(xx.data(), false, g.data());
+                m.eval_jac_g(xx.data(), false, jac.data());
+                m.eval_h(xx.data(), false, hess.data(), 1, lambda.data());
+            };
+
+            iteration(x0);
+            {
+                AllocCounter counter;
+                iteration(x1);
+                iteration(x0);
+                TS_ASSERT_EQUALS(counter.allocations(), 0);
+            }
+
+            // the instrumentation must not allocate either
+            m.enableProfiling(true);
+            Tracing::enable(true);
+            iteration(x1);
+            {
+                AllocCounter counter;
+                iteration(x0);
+                iteration(x1);
+                TS_ASSERT_EQUALS(counter.allocations(), 0);
+            }
+            Tracing::enable(false);
+            Tracing::clear();
+        }
+
+        void testOnePass(){
+            TestModel m;
+            m.setEngine(ENGINE_ONE_PASS);
+            vector<Var> x;
+            for (Idx i=0; i<4; i++)
+                x.push_back(m.addVar(0.5, 2, 1, "x" + std::to_string((long long int)i)));
+            m.setObj(x[0]*x[1]*x[0] + pow(x[2], 3));
+            m.addConstr(0, (x[0] + x[1] + x[0])*(x[1] + sin(x[0]*x[1])), 10);
+            m.addConstr(0, cos(x[2]*x[3]*x[2]) + ln(x[3])*x[3] + 2*x[2], 10);
+            m.addConstr(0, Expr(1), 10);
+
+            vector<double> x0(m.nx(), 1);
+            vector<double> x1 = {0.6, 1.1, 1.4, 0.9};
+            vector<double> jac(m.getNNZ_Jac()), hess(m.getNNZ_Hess());
+            vector<double> lambda(m.ng(), 1);
+
+            m.eval_jac_g(x0.data(), true, jac.data());
+            m.eval_h(x0.data(), false, hess.data(), 1, lambda.data());
+            AllocCounter counter;
+            m.eval_jac_g(x1.data(), true, jac.data());
+            m.eval_h(x1.data(), false, hess.data(), 1, lambda.data());
+            m.eval_jac_g(x0.data(), true, jac.data());
+            TS_ASSERT_EQUALS(counter.allocations(), 0);
+        }
+
+        void testBlackBox(){
+            for (auto jacobian: {BlackBox::FORWARD_DIFFERENCE, BlackBox::COMPLEX_STEP}){
+                TestModel m;
+                Var a = m.addVar(0, 3, 1, "a");
+                Var b = m.addVar(0, 3, 2, "b");
+                Var c = m.addVar(0, 3, 3, "c");
+                m.setObj(a + b + c);
+                vector<double> lb(2, 0), ub(2, 10);
+                m.addCallbackConstrs(new AllocBox({a, b, c}, jacobian), lb.data(), ub.data());
+
+                vector<double> x0 = {1, 2, 3};
+                vector<double> x1 = {1.5, 0.5, 2};
+                vector<double> jac(m.getNNZ_Jac()), hess(m.getNNZ_Hess());
+                vector<double> lambda(m.ng(), 1);
+
+                m.eval_jac_g(x0.data(), true, jac.data());
+                m.eval_h(x0.data(), false, hess.data(), 1, lambda.data());
+                AllocCounter counter;
+                m.eval_jac_g(x1.data(), true, jac.data());
+                m.eval_h(x1.data(), false, hess.data(), 1, lambda.data());
+                TS_ASSERT_EQUALS(counter.allocations(), 0);
+            }
+        }
+
+        //! number of deallocations when a model with rows constraints is destroyed
+        static unsigned long teardown(Idx rows){
+            auto m = new TestModel();
+            vector<Var> x;
+            for (Idx i=0; i<100; i++)
+                x.push_back(m->addVar(0, 1, "x" + std::to_string((long long int)i)));
+            m->addParam(1, "a parameter with a name longer than the small string buffer");
+            for (Idx i=0; i<rows; i++)
+                m->addConstr(0, x[i%100]*x[(i+1)%100] + sin(x[(i+7)%100]), 1);
+            m->setObj(x[0]*x[0]);
+
+            AllocCounter counter;
+            delete m;
+            return counter.deallocations();
+        }
+
+        void testTeardown(){
+            // the constraints are freed with the blocks of the arena, so
+            // only the number of blocks grows with the model
+            const unsigned long small = teardown(500);
+            const unsigned long large = teardown(8000);
+            TS_ASSERT_LESS_THAN(large, small + 8);
+        }
+};
+/* ex: set tabstop=4 shiftwidth=4 expandtab: */
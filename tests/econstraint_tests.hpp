@@ -16,6 +16,7 @@
 #include <cxxtest/TestSuite.h>
 #include "testmodel.hpp"
 #include "../src/inner_constraint.hpp"
+#include "../src/pairhashmap.hpp"
 
 using namespace MadOpt;
 
@@ -31,11 +32,14 @@ class EConstraintTest: public CxxTest::TestSuite {
                 const vector<double> hess={}, 
                 const double delta=0.000001
                 ){
-            HessPosMap hess_pos_map;
+            HessStructure hess_structure;
             TestModel m;
             auto& simstack = m.getSimStack();
             simstack.setXSize(x.size());
-            InnerConstraint e(exp, 0, 0, hess_pos_map, simstack);
+            InnerConstraint e(exp, 0, 0, hess_structure, simstack);
+            vector<Idx> perm;
+            hess_structure.compress(perm);
+            e.remapHess(perm);
 
             map<int, double> jacvm;
             for (Idx i=0; i<jac_entries.size(); i++)
@@ -49,40 +53,45 @@ class EConstraintTest: public CxxTest::TestSuite {
 
             auto& cstack = m.getCStack();
             cstack.resize(simstack);
-            cstack.setX(x.data());
-            e.setEvals(cstack);
-
-            map<int, double> ej;
-            auto ejac = e.getJac();
-
-            for (Idx i=0; i<e.getNNZ_Jac(); i++)
-                ej[ejace[i]] = ejac[i];
-
-            vector<double> ehess(hess_pos_map.size(), 0);
-            auto hess_map = e.getHessMap();
-            auto hess_res = e.getHess();
-            int i=0;
-            for (auto x: hess_map)
-                ehess[x] += hess_res[i++];
-
-            map<PII, double> eh;
-            for (auto p: hess_pos_map)
-                eh[p.first] = ehess[p.second];
-
-            TS_ASSERT_DELTA(e.getG(), g, delta);
-            TS_ASSERT_EQUALS(ej.size(), jacvm.size());
-            TS_ASSERT_EQUALS(eh.size(), hessvm.size());
-
-            if (delta == 0){
-                TS_ASSERT_EQUALS(ej, jacvm);
-                TS_ASSERT_EQUALS(eh, hessvm);
-            } else {
-
-                for (auto p: ej)
-                    TS_ASSERT_DELTA(p.second, jacvm.at(p.first), delta);
-
-                for (auto p: eh)
-                    TS_ASSERT_DELTA(p.second, hessvm.at(p.first), delta);
+            cstack.setX(x.data(), x.size());
+            // both engines have to give the same results, the one pass
+            // engine first as it writes on the zeros of the new constraint
+            for (Engine engine: {ENGINE_ONE_PASS, ENGINE_PLAN}){
+                cstack.setEngine(engine, &hess_structure);
+                e.setEvals(cstack);
+
+                map<int, double> ej;
+                auto ejac = e.getJacValues();
+
+                for (Idx i=0; i<e.getNNZ_Jac(); i++)
+                    ej[ejace[i]] = ejac[i];
+
+                vector<double> ehess(hess_structure.size(), 0);
+                auto hess_map = e.getHessMap();
+                auto hess_res = e.getHess();
+                int i=0;
+                for (auto x: hess_map)
+                    ehess[x] += hess_res[i++];
+
+                map<PII, double> eh;
+                for (Idx i=0; i<hess_structure.size(); i++)
+                    eh[PII(hess_structure.cols()[i], hess_structure.rows()[i])] = ehess[i];
+
+                TS_ASSERT_DELTA(e.getG(), g, delta);
+                TS_ASSERT_EQUALS(ej.size(), jacvm.size());
+                TS_ASSERT_EQUALS(eh.size(), hessvm.size());
+
+                if (delta == 0){
+                    TS_ASSERT_EQUALS(ej, jacvm);
+                    TS_ASSERT_EQUALS(eh, hessvm);
+                } else {
+
+                    for (auto p: ej)
+                        TS_ASSERT_DELTA(p.second, jacvm.at(p.first), delta);
+
+                    for (auto p: eh)
+                        TS_ASSERT_DELTA(p.second, hessvm.at(p.first), delta);
+                }
             }
         }
 
@@ -158,6 +167,20 @@ class EConstraintTest: public CxxTest::TestSuite {
             Tes(sin(2*a), {3}, sin(2*3), {0}, {2*cos(6)}, {PII(0,0)}, {-4*sin(6)});
         }
 
+        void testTAN(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            // tan' = 1 + tan^2, tan'' = 2*tan*(1 + tan^2)
+            double t = std::tan(0.6);
+            Tes(tan(2*a), {0.3}, t, {0}, {2*(1 + t*t)}, {PII(0,0)}, {8*t*(1 + t*t)});
+            t = std::tan(0.15);
+            const double d = 1 + t*t;
+            Tes(tan(a*b), {0.3, 0.5}, t, {0, 1}, {0.5*d, 0.3*d},
+                    {PII(0,0), PII(0,1), PII(1,1)},
+                    {2*t*d*0.25, 2*t*d*0.15 + d, 2*t*d*0.09});
+        }
+
         void testPOW(){
             TestModel m;
             Var a = m.addVar("a");
@@ -165,6 +188,20 @@ class EConstraintTest: public CxxTest::TestSuite {
             Tes(pow(2*a, 3), {3}, pow(6,3), {0}, {3*2*pow(2*3,2)}, {PII(0,0)}, {3*2*2*2*pow(2*3,1)});
         }
 
+        void testSpecialisedPow(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Tes(pow(a,3), {3}, 27, {0}, {27}, {PII(0,0)}, {18});
+            Tes(pow(a,-1), {3}, 1.0/3, {0}, {-1.0/9}, {PII(0,0)}, {2.0/27});
+            Tes(sqrt(a), {3}, sqrt(3), {0}, {0.5/sqrt(3)}, {PII(0,0)}, {-0.25*pow(3,-1.5)});
+            Tes(pow(a,-0.5), {3}, pow(3,-0.5), {0}, {-0.5*pow(3,-1.5)}, {PII(0,0)}, {0.75*pow(3,-2.5)});
+            Tes(pow(a,4), {3}, 81, {0}, {4*27}, {PII(0,0)}, {12*9});
+            Tes(pow(a,-2), {3}, 1.0/9, {0}, {-2.0/27}, {PII(0,0)}, {6.0/81});
+            Tes(pow(a,5), {-2}, -32, {0}, {5*16}, {PII(0,0)}, {20*-8});
+            Tes(pow(a,1.5), {3}, pow(3,1.5), {0}, {1.5*sqrt(3)}, {PII(0,0)}, {0.75/sqrt(3)});
+            Tes(sin(a)*cos(a), {3}, sin(3)*cos(3), {0}, {cos(6)}, {PII(0,0)}, {-2*sin(6)});
+        }
+
         void testMulti(){
             TestModel m;
             Var a = m.addVar("a");
@@ -178,6 +215,94 @@ class EConstraintTest: public CxxTest::TestSuite {
                 {0,1}, {2*bx, 2*ax+1.5}, {PII(0,1)}, {2});
         }
 
+        void testProduct(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Var c = m.addVar("c");
+            Var d = m.addVar("d");
+            const vector<PII> pairs = {PII(0,1), PII(0,2), PII(0,3), PII(1,2), PII(1,3), PII(2,3)};
+            Tes(a*b*c*d, {2, 3, 4, 5}, 120, {0,1,2,3}, {60, 40, 30, 24},
+                    pairs, {20, 15, 12, 10, 8, 6});
+            // zero factors, no division by them
+            Tes(a*b*c*d, {2, 3, 0, 5}, 0, {0,1,2,3}, {0, 0, 30, 0},
+                    pairs, {0, 15, 0, 10, 0, 6});
+            Tes(a*b*c*d, {0, 3, 0, 5}, 0, {0,1,2,3}, {0, 0, 0, 0},
+                    pairs, {0, 15, 0, 0, 0, 0});
+            // a^2*b*c
+            Tes(a*b*a*c, {2, 3, 5}, 60, {0,1,2}, {60, 20, 12},
+                    {PII(0,0), PII(0,1), PII(0,2), PII(1,2)}, {30, 20, 12, 4});
+        }
+
+        void testMonomial(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Var c = m.addVar("c");
+            // 3*a^2*b^3*c, the repeated a is one variable of the monomial
+            Tes(3*a*pow(b, 3)*a*c, {2, 3, 5}, 3*4*27*5, {0, 1, 2},
+                    {3*2*2*27*5, 3*4*3*9*5, 3*4*27},
+                    {PII(0,0), PII(0,1), PII(0,2), PII(1,1), PII(1,2)},
+                    {3*2*27*5, 3*2*2*3*9*5, 3*2*2*27, 3*4*6*3*5, 3*4*3*9});
+            // a*a is the monomial a^2
+            Tes(a*a, {3}, 9, {0}, {6}, {PII(0,0)}, {2});
+            Tes(-a*b, {2, 3}, -6, {0, 1}, {-3, -2}, {PII(0,1)}, {-1});
+        }
+
+        void testDivNeg(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Var c = m.addVar("c");
+            Tes(a/b, {2, 3}, 2./3, {0,1}, {1./3, -2./9}, {PII(0,1), PII(1,1)}, {-1./9, 4./27});
+            Tes(2/b, {2, 3}, 2./3, {1}, {-2./9}, {PII(1,1)}, {4./27});
+            Tes(pow(a,-1)*pow(b,-1), {2, 3}, 1./6, {0,1}, {-1./12, -1./18},
+                    {PII(0,0), PII(0,1), PII(1,1)}, {1./12, 1./36, 1./27});
+            Tes((a*c)/(a+b), {2, 3, 4}, 8./5, {0,1,2}, {12./25, -8./25, 2./5},
+                    {PII(0,0), PII(0,1), PII(0,2), PII(1,1), PII(1,2)},
+                    {-24./125, -4./125, 3./25, 16./125, -2./25});
+            Tes(a-b, {2, 3}, -1, {0,1}, {1,-1});
+            Tes(-(a*b), {2, 3}, -6, {0,1}, {-3,-2}, {PII(0,1)}, {-1});
+            Tes(3 - 2*a*b*0.5 + 1, {2, 3}, -2, {0,1}, {-3,-2}, {PII(0,1)}, {-1});
+        }
+
+        void testShortTape(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            HessStructure hess_structure;
+            auto& simstack = m.getSimStack();
+            simstack.setXSize(2);
+            // a b DIV, a b NEG ADD, MONOMIAL MUL_CONST ADD_CONST
+            TS_ASSERT_EQUALS(InnerConstraint(a/b, 0, 0, hess_structure, simstack).tapeInfo().operators, 3);
+            TS_ASSERT_EQUALS(InnerConstraint(a-b, 0, 0, hess_structure, simstack).tapeInfo().operators, 4);
+            TS_ASSERT_EQUALS(InnerConstraint(2*a*b+1, 0, 0, hess_structure, simstack).tapeInfo().operators, 3);
+        }
+
+        void testFolding(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Param p = m.addParam(2, "p");
+            HessStructure hess_structure;
+            auto& simstack = m.getSimStack();
+            simstack.setXSize(2);
+            auto nofOperators = [&](const Expr& e){
+                return InnerConstraint(e, 0, 0, hess_structure, simstack).tapeInfo().operators;
+            };
+            // a MUL_CONST, a ADD_CONST
+            TS_ASSERT_EQUALS(nofOperators((Expr(2) + 3)*a), 2);
+            TS_ASSERT_EQUALS(nofOperators(a + pow(Expr(3), 2) + sin(Expr(0.5))), 2);
+            // the zero product and the zero term are dropped
+            TS_ASSERT_EQUALS(nofOperators(a + (Expr(2) - 2)*b), 1);
+            // 1/(1/a) is built as pow(a, 1)
+            TS_ASSERT_EQUALS(nofOperators(pow(pow(a, -1), -1)), 1);
+            // the parameter stays, p a MUL ADD_CONST
+            TS_ASSERT_EQUALS(nofOperators(p*a + 2*Expr(3)), 4);
+            Tes(a*(Expr(1)/4) + pow(Expr(2), 3)*b, {2, 3}, 0.5 + 24, {0, 1}, {0.25, 8});
+            Tes(a + (Expr(2) - 2)*b, {2, 3}, 2, {0}, {1});
+        }
+
         void testBug(){
             TestModel m;
             Var a = m.addVar("a");
@@ -193,6 +318,25 @@ class EConstraintTest: public CxxTest::TestSuite {
                 {PII(0,0), PII(0,1)}, {2*bx, 2*ax+1.5});
         }
 
+        void testScatteredProducts(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            Var c = m.addVar("c");
+            Var d = m.addVar("d");
+            // a*b and b*a end up in one entry, the products are scattered
+            Tes((a+b)*(a+b), {2, 3}, 25, {0, 1}, {10, 10},
+                {PII(0,0), PII(0,1), PII(1,1)}, {2, 2, 2});
+            Tes((a+b+c)*(b+c+d), {1, 2, 3, 4}, 54,
+                {0, 1, 2, 3}, {9, 15, 15, 6},
+                {PII(0,1), PII(0,2), PII(0,3), PII(1,1),
+                 PII(1,2), PII(1,3), PII(2,2), PII(2,3)},
+                {1, 1, 1, 2, 2, 1, 2, 1});
+            // the same entries merge in the sum as well
+            Tes((a+b)*(a+b) + a*b + b*a, {2, 3}, 37, {0, 1}, {16, 14},
+                {PII(0,0), PII(0,1), PII(1,1)}, {2, 4, 2});
+        }
+
         void testTutorialTerm(){
             TestModel m;
             Var a = m.addVar("a");
@@ -300,5 +444,49 @@ class EConstraintTest: public CxxTest::TestSuite {
 
             Tes(term, x, g, jac_entries, jac, hess_entries, hess);
         }
+
+        void testDenseHess(){
+            // (sum (i+1)*x_i)^2, every pair of variables is a hessian entry
+            int N = 40;
+            TestModel m;
+            Expr sum(0);
+            vector<double> x(N, 1);
+            vector<Idx> jac_entries(N);
+            vector<double> jac(N);
+            vector<PII> hess_entries;
+            vector<double> hess;
+            double s = N*(N+1)/2;
+            for (int i=0; i < N; ++i) {
+                sum += (i+1)*m.addVar("x" + std::to_string(i));
+                jac_entries[i] = i;
+                jac[i] = 2*s*(i+1);
+                for (int k=i; k < N; ++k){
+                    hess_entries.push_back(PII(i, k));
+                    hess.push_back(2*(i+1)*(k+1));
+                }
+            }
+
+            Tes(pow(sum, 2), x, s*s, jac_entries, jac, hess_entries, hess);
+        }
+
+        void testPairHashMap(){
+            PairHashMap map;
+            for (Idx i=0; i<100; i++)
+                for (Idx k=i; k<100; k++)
+                    map[PII(i, k)] = i*100 + k + 1;
+            TS_ASSERT_EQUALS(map.size(), 5050);
+            TS_ASSERT_EQUALS(map[PII(3, 97)], 398);
+            TS_ASSERT_EQUALS(map[PII(97, 3)], 0);
+            TS_ASSERT_EQUALS(map.size(), 5051);
+
+            std::size_t bytes = map.bytes();
+            map.clear();
+            TS_ASSERT_EQUALS(map.size(), 0);
+            TS_ASSERT_EQUALS(map.bytes(), bytes);
+            TS_ASSERT_EQUALS(map[PII(3, 97)], 0);
+            map[PII(3, 97)] = 5;
+            TS_ASSERT_EQUALS(map[PII(3, 97)], 5);
+            TS_ASSERT_EQUALS(map.size(), 1);
+        }
 };
 
@@ -15,6 +15,7 @@
  */
 #include <cxxtest/TestSuite.h>
 #include "testmodel.hpp"
+#include "../src/expr_array.hpp"
 using namespace MadOpt;
 
 class ExprTest: public CxxTest::TestSuite {
@@ -302,4 +303,23 @@ class ExprTest: public CxxTest::TestSuite {
           Tes(a+x, "a+[x]", OP_ADD);
           Tes(a*x, "a*[x]", OP_MUL);
       }
+
+      void testArrays(){
+          TestModel m;
+          vector<Expr> x = {m.addVar("a"), m.addVar("b"), m.addVar("c")};
+          vector<double> c = {2, 0, 3};
+
+          Tes(sum(x), "a+b+c", OP_ADD);
+          Tes(dot(c.data(), x), "2*a+3*c", OP_ADD);
+          Tes(sumsq(x), "(a^2)+(b^2)+(c^2)", OP_ADD);
+          Tes(sum(add(x, c.data())), "a+2+b+c+3", OP_ADD);
+          Tes(sum(mul(x, x)), "a*a+b*b+c*c", OP_ADD);
+          Tes(sum(sin(x)), "sin(a)+sin(b)+sin(c)", OP_ADD);
+          Tes(mul(x, c.data())[1], "0", OP_CONST, true);
+          Tes(pow(x, 3)[2], "c^3", OP_POW);
+          Tes(sum(vector<Expr>()), "0", OP_CONST, true);
+
+          vector<Expr> y = {x[0]};
+          TS_ASSERT_THROWS(add(x, y), MadOptError);
+      }
 };                                      
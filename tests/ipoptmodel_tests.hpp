@@ -13,9 +13,12 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <chrono>
 #include <cxxtest/TestSuite.h>
 #include "../src/ipopt_model.hpp"
 #include "../src/exceptions.hpp"
+#include "../src/solve_executor.hpp"
+#include "../src/python_callback.hpp"
 
 using namespace MadOpt;
 
@@ -187,4 +190,101 @@ public:
             m.solve();
             TS_ASSERT(m.hasSolution());
        }
+
+       void testSolveExecutor(){
+            const int N = 6;
+            vector<unique_ptr<IpoptModel>> m(N);
+            vector<Var> x(N);
+            for (int i=0; i<N; i++){
+                m[i].reset(new IpoptModel());
+                x[i] = m[i]->addVar(0, 10, 5, "x");
+                m[i]->addConstr(i, x[i], 10);
+                m[i]->setObj(x[i]);
+            }
+
+            SolveExecutor executor(2, 1);
+            vector<future<Solution>> sol;
+            for (int i=0; i<N; i++)
+                sol.push_back(executor.submit(*m[i]));
+
+            for (int i=0; i<N; i++){
+                TS_ASSERT_EQUALS(sol[i].get().status(), Solution::SUCCESS);
+                TS_ASSERT_DELTA(x[i].x(), i, 0.0001);
+            }
+
+            // the model own application is still usable afterwards
+            m[0]->solve();
+            TS_ASSERT_DELTA(x[0].x(), 0, 0.0001);
+            TS_ASSERT_THROWS(SolveExecutor(0), MadOptError);
+       }
+
+        //! g0 = x0, burns 20ms of cpu time per evaluation
+        static bool busyBlock(void* data, const double* x, Idx nx,
+                double* g, double* jac, double* hess){
+            const auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+            while (std::chrono::steady_clock::now() < end);
+            g[0] = x[0];
+            jac[0] = 1;
+            return true;
+        }
+
+       void testSolveExecutorTimelimit(){
+            // the limit of a job is wall clock time, with the cpu time of
+            // the process two concurrent jobs would stop each other early.
+            // The callback spins on the wall clock, hence a job takes as
+            // long as the serial solve even if the workers share a core
+            const int N = 2;
+            vector<unique_ptr<IpoptModel>> m(N);
+            vector<int> rows = {0}, cols = {0};
+            vector<double> lb(1, 1), ub(1, 10);
+            for (int i=0; i<N; i++){
+                m[i].reset(new IpoptModel());
+                Var x = m[i]->addVar(0, 10, 5, "x");
+                Var y = m[i]->addVar(0, 10, 5, "y");
+                m[i]->addCallbackConstrs(new CallbackBlock(1, 1, rows.data(), cols.data(),
+                            0, NULL, NULL, NULL, busyBlock, NULL), lb.data(), ub.data());
+                m[i]->setObj(pow(x - 2, 2) + pow(y - 3, 2));
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            m[0]->solve();
+            const double seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+            TS_ASSERT_EQUALS(m[0]->status(), Solution::SUCCESS);
+
+            SolveExecutor executor(N);
+            vector<future<Solution>> sol;
+            for (int i=0; i<N; i++)
+                sol.push_back(executor.submit(*m[i], 1.5*seconds));
+            for (int i=0; i<N; i++)
+                TS_ASSERT_EQUALS(sol[i].get().status(), Solution::SUCCESS);
+
+            // an exceeded limit is still reported as such
+            m[0]->timelimit = 0;
+            m[0]->solve();
+            TS_ASSERT_EQUALS(m[0]->status(), Solution::CPUTIME_EXCEEDED);
+       }
+
+        void testStats(){
+            IpoptModel m;
+            Var a = m.addVar(0, 1, 0.5, "a");
+            Var b = m.addVar(0, 1, 0.5, "b");
+            m.addConstr(1, a+b, 3);
+            m.setObj(pow(a, 2) + b);
+            TS_ASSERT_EQUALS(m.stats().solve.calls, 0);
+            m.solve();
+
+            const SolveStats& stats = m.stats();
+#ifdef ENABLE_STATS
+            TS_ASSERT_EQUALS(stats.solve.calls, 1);
+            TS_ASSERT(stats.eval_f.calls > 0);
+            TS_ASSERT(stats.eval_h.calls > 0);
+            TS_ASSERT(stats.structure.calls >= 3);
+            TS_ASSERT(stats.set_evals.calls > 0);
+            TS_ASSERT(stats.iterations >= 0);
+            TS_ASSERT(stats.callbackSeconds() <= stats.solve.seconds);
+#else
+            TS_ASSERT_EQUALS(stats.solve.calls, 0);
+#endif
+        }
 };
@@ -16,10 +16,12 @@
  */
 #include "../src/ipopt_model.hpp"
 #include "../src/bonmin_model.hpp"
+#include "../src/solve_executor.hpp"
 #include <unistd.h>
 #include <cmath>
 #include <math.h>
 #include <vector>
+#include <chrono>
 
 using namespace MadOpt;
 
@@ -109,6 +111,39 @@ void tutorial(double p, int i){
     cout<<x[2].x()<<endl;
 }
 
+//! solves per second of n tutorial models of size 10^p with 1,2,4.. workers
+void executor(double p, int n){
+    int N = std::pow(10, p);
+    n = std::max(n, 1);
+
+    vector<unique_ptr<IpoptModel>> models(n);
+    vector<vector<Var>> x(n, vector<Var>(N));
+    for (int i=0; i<n; i++){
+        models[i].reset(new IpoptModel());
+        constructModel(N, *models[i], x[i]);
+        models[i]->show_solver = false;
+    }
+
+    unsigned int max_workers = std::max(thread::hardware_concurrency(), 1u);
+    for (unsigned int workers=1; workers<=max_workers; workers*=2){
+        auto start = chrono::steady_clock::now();
+        {
+            SolveExecutor executor(workers);
+            vector<future<Solution>> solutions;
+            FOREACH(m, models)
+            //for (auto& m: models){
+                solutions.push_back(executor.submit(*m));
+            }
+            FOREACH(s, solutions)
+            //for (auto& s: solutions){
+                s.wait();
+            }
+        }
+        chrono::duration<double> t = chrono::steady_clock::now() - start;
+        cout<<"workers: "<<workers<<" solves/s: "<<n/t.count()<<endl;
+    }
+}
+
 int main(int argc, char* argv[]){
     double d = 5;
     int n = 1;
@@ -127,7 +162,7 @@ int main(int argc, char* argv[]){
         }
 
     vector<function<void(double, int)> > funcs 
-        = {tutorial, profile, test, playground};
+        = {tutorial, profile, test, playground, executor};
 
     if (func < funcs.size())
         funcs[func](d, n);
@@ -13,10 +13,35 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <set>
+#include <thread>
 #include <cxxtest/TestSuite.h>
 #include "testmodel.hpp"
+#include "../src/python_callback.hpp"
+#include "../src/blackbox.hpp"
+#include "../src/tracing.hpp"
 using namespace MadOpt;
 
+// g0 = a*b, g1 = sin(b) + c^2
+class TestBox: public BlackBox {
+    public:
+        TestBox(const vector<Var>& vars, Jacobian jacobian, Hessian hessian, Idx threads):
+            BlackBox(vars, 2, {PII(0, 0), PII(0, 1), PII(1, 1), PII(1, 2)},
+                    jacobian, hessian, threads){}
+
+        void g(const double* x, double* g)const { eval(x, g); }
+
+        void g(const std::complex<double>* x, std::complex<double>* g)const { eval(x, g); }
+
+    private:
+        template<class T>
+        void eval(const T* x, T* g)const {
+            g[0] = x[0]*x[1];
+            g[1] = sin(x[1]) + x[2]*x[2];
+        }
+};
+
 class ModelTest: public CxxTest::TestSuite {
 public:
   void testNoObj(){
@@ -185,6 +210,100 @@ public:
             TS_ASSERT_THROWS(m.getSolution().x(0), MadOptError);
         }
 
+        void testSolutionArrays(){
+            TestModel m;
+            vector<double> x = {3, 4};
+            vector<double> l = {5};
+            vector<double> z_L = {6, 7};
+            vector<double> z_U = {8, 9};
+            m.getSolution().set(Solution::SolverStatus::SUCCESS, 2, 1, 2,
+                    x.data(), l.data(), z_L.data(), z_U.data());
+            TS_ASSERT_EQUALS(m.getSolution().getX(), x);
+            TS_ASSERT_EQUALS(m.getSolution().getLam(), l);
+            TS_ASSERT_EQUALS(m.getSolution().getZ_L(), z_L);
+            TS_ASSERT_EQUALS(m.getSolution().getZ_U(), z_U);
+
+            m.getSolution().set(Solution::SolverStatus::SUCCESS, 2, 2, x.data());
+            TS_ASSERT_EQUALS(m.getSolution().getLam().size(), 0);
+            TS_ASSERT_EQUALS(m.getSolution().getZ_L().size(), 0);
+        }
+
+        void testEvaluate(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            m.addConstr(1, a*b, 3);
+            m.addConstr(0, a+b, 3);
+            m.setObj(a*a);
+
+            vector<double> x = {2, 3};
+            vector<double> lambda = {1, 0};
+            m.evaluate(x.data(), 1, lambda.data());
+            const Evaluation& e = m.getEvaluation();
+
+            TS_ASSERT_EQUALS(e.f, 4);
+            TS_ASSERT_EQUALS(e.grad_f, vector<double>({4, 0}));
+            TS_ASSERT_EQUALS(e.g, vector<double>({6, 5}));
+            TS_ASSERT_EQUALS(e.jac_row, vector<int>({0, 0, 1, 1}));
+            TS_ASSERT_EQUALS(e.jac.size(), 4);
+            TS_ASSERT_EQUALS(e.hess.size(), 2);
+            for (Idx i=0; i<e.hess.size(); i++)
+                TS_ASSERT_EQUALS(e.hess[i], e.hess_row[i] == e.hess_col[i] ? 2 : 1);
+
+            m.evaluate(x.data());
+            for (Idx i=0; i<e.hess.size(); i++)
+                TS_ASSERT_EQUALS(e.hess[i], e.hess_row[i] == e.hess_col[i] ? 2 : 0);
+        }
+
+        void testBulkSetters(){
+            TestModel m;
+            Var a = m.addVar(0, 1, 0, "a");
+            Var b = m.addVar(0, 1, 0, "b");
+            Constraint c = m.addConstr(0, a+b, 1);
+
+            vector<double> lb = {2, -2};
+            vector<double> ub = {3, -1};
+            TS_ASSERT_THROWS(m.setInits(lb.data()), MadOptError);
+            vector<double> init = {0.5, 0.5};
+            m.setInits(init.data());
+            TS_ASSERT_EQUALS(a.init(), 0.5);
+            TS_ASSERT_THROWS(m.setVarBounds(lb.data(), ub.data()), MadOptError);
+            lb = {-2, -2};
+            ub = {3, 1};
+            m.setVarBounds(lb.data(), ub.data());
+            TS_ASSERT_EQUALS(b.lb(), -2);
+            TS_ASSERT_EQUALS(b.ub(), 1);
+
+            m.setConstrBounds(lb.data(), ub.data());
+            TS_ASSERT_EQUALS(c.lb(), -2);
+            TS_ASSERT_EQUALS(c.ub(), 3);
+            TS_ASSERT_THROWS(m.setConstrBounds(ub.data(), lb.data()), MadOptError);
+
+            // a rejected call changes none of the entries, the first pair
+            // is valid and the second is not
+            vector<double> bad_lb = {0, 2};
+            vector<double> bad_ub = {1, 1};
+            TS_ASSERT_THROWS(m.setVarBounds(bad_lb.data(), bad_ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(a.lb(), -2);
+            TS_ASSERT_EQUALS(a.ub(), 3);
+            TS_ASSERT_EQUALS(b.lb(), -2);
+            TS_ASSERT_EQUALS(b.ub(), 1);
+            // b.init() = 0.5 is not in [0.6, 1]
+            bad_lb = {0, 0.6};
+            TS_ASSERT_THROWS(m.setVarBounds(bad_lb.data(), bad_ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(a.lb(), -2);
+            TS_ASSERT_EQUALS(b.lb(), -2);
+            init = {0, 2};
+            TS_ASSERT_THROWS(m.setInits(init.data()), MadOptError);
+            TS_ASSERT_EQUALS(a.init(), 0.5);
+
+            m.addConstr(0, a-b, 1);
+            bad_lb = {-1, 2};
+            TS_ASSERT_THROWS(m.setConstrBounds(bad_lb.data(), bad_ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(c.lb(), -2);
+            TS_ASSERT_EQUALS(c.ub(), 3);
+        }
+
         void testgetJac(){
             TestModel m;
 
@@ -208,4 +327,630 @@ public:
             TS_ASSERT_EQUALS(iRow, iRow_res);
             TS_ASSERT_EQUALS(iRow, iRow_res);
         }
+
+        void testAddVars(){
+            TestModel m;
+            m.addVar("a");
+            vector<double> lb = {-1, -2};
+            vector<double> ub = {1, 2};
+            vector<double> init = {0, 1};
+            vector<Var> x = m.addVars(2, lb.data(), ub.data(), init.data(), "x");
+
+            TS_ASSERT_EQUALS(m.nx(), 3);
+            TS_ASSERT_EQUALS(x[1].name(), "x2");
+            TS_ASSERT_EQUALS(x[1].getPos(), 2);
+            TS_ASSERT_EQUALS(x[1].lb(), -2);
+            TS_ASSERT_EQUALS(x[1].init(), 1);
+        }
+
+        void testAddLinearConstrs(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            m.addConstr(0, a, 1);
+
+            // [[1, 2], [0, 3]]
+            vector<int> indptr = {0, 2, 3};
+            vector<int> indices = {0, 1, 1};
+            vector<double> data = {1, 2, 3};
+            vector<double> lb = {0, -1};
+            vector<double> ub = {1, 1};
+            TS_ASSERT_EQUALS(m.addLinearConstrs(2, indptr.data(), indices.data(),
+                        data.data(), lb.data(), ub.data()), 1);
+            TS_ASSERT_EQUALS(m.ng(), 3);
+            TS_ASSERT_EQUALS(m.lb(2), -1);
+            TS_ASSERT_EQUALS(m.getNNZ_Jac(), 4);
+
+            vector<double> x = {1, 2};
+            m.evaluate(x.data());
+            TS_ASSERT_EQUALS(m.getEvaluation().g, vector<double>({1, 5, 6}));
+
+            // a failing call adds no row, also if the earlier rows are valid
+            indices[2] = 2;
+            TS_ASSERT_THROWS(m.addLinearConstrs(2, indptr.data(), indices.data(),
+                        data.data(), lb.data(), ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(m.ng(), 3);
+            indices[2] = 1;
+            lb[1] = 2;
+            TS_ASSERT_THROWS(m.addLinearConstrs(2, indptr.data(), indices.data(),
+                        data.data(), lb.data(), ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(m.ng(), 3);
+            lb[1] = -1;
+            indptr = {0, 2, 1};
+            TS_ASSERT_THROWS(m.addLinearConstrs(2, indptr.data(), indices.data(),
+                        data.data(), lb.data(), ub.data()), MadOptError);
+            TS_ASSERT_EQUALS(m.ng(), 3);
+        }
+
+        //! 2*x0 + x0*x1 written against the plain ConstraintInterface, it
+        //only knows setEvals() without level
+        class CustomConstraint: public ConstraintInterface{
+            public:
+                CustomConstraint(): g(0), jac(2, 0){}
+                double lb(){ return 0; }
+                void lb(double v){}
+                double ub(){ return 1; }
+                void ub(double v){}
+                Idx getNNZ_Jac(){ return 2; }
+                void getNZ_Jac(unsigned int* jCol){ jCol[0] = 0; jCol[1] = 1; }
+                void setEvals(CStack& stack){
+                    const double* x = stack.getX();
+                    g = 2*x[0] + x[0]*x[1];
+                    jac[0] = 2 + x[1];
+                    jac[1] = x[0];
+                }
+                const double& getG()const { return g; }
+                const vector<double>& getJac()const { return jac; }
+                void eval_h(double* values, const double& lambda){}
+            private:
+                double g;
+                vector<double> jac;
+        };
+
+        void testCustomConstraint(){
+            TestModel m;
+            m.addVar("a");
+            m.addVar("b");
+            m.addConstr(new CustomConstraint());
+            vector<double> x = {2, 3};
+            m.evaluate(x.data());
+            TS_ASSERT_EQUALS(m.getEvaluation().g, vector<double>({10}));
+            TS_ASSERT_EQUALS(m.getEvaluation().jac, vector<double>({5, 2}));
+            // also at a new x and for the lower levels
+            x = {1, 1};
+            m.setEvals(x.data(), EVAL_VALUE);
+            m.evaluate(x.data());
+            TS_ASSERT_EQUALS(m.getEvaluation().g, vector<double>({3}));
+        }
+
+        static bool callbackBlock(void* data, const double* x, Idx nx,
+                double* g, double* jac, double* hess){
+            (*(int*)data)++;
+            // g0 = x0*x1, g1 = x1^2
+            g[0] = x[0]*x[1];
+            g[1] = x[1]*x[1];
+            jac[0] = x[1];
+            jac[1] = x[0];
+            jac[2] = 2*x[1];
+            hess[0] = 1;
+            hess[1] = 2;
+            return nx == 2;
+        }
+
+        void testCallbackConstrs(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            m.addConstr(0, a*b, 1);
+            m.setObj(a*a);
+
+            int calls = 0;
+            vector<int> jac_rows = {0, 0, 1};
+            vector<int> jac_cols = {0, 1, 1};
+            vector<int> hess_rows = {0, 1};
+            vector<int> hess_i = {1, 1};
+            vector<int> hess_j = {0, 1};
+            vector<double> lb = {0, 0};
+            vector<double> ub = {1, 2};
+            auto block = new CallbackBlock(2, 3, jac_rows.data(), jac_cols.data(),
+                    2, hess_rows.data(), hess_i.data(), hess_j.data(),
+                    callbackBlock, &calls);
+            TS_ASSERT_EQUALS(m.addCallbackConstrs(block, lb.data(), ub.data()), 1);
+            TS_ASSERT_EQUALS(m.ng(), 3);
+            TS_ASSERT_EQUALS(m.ub(2), 2);
+            TS_ASSERT_EQUALS(m.getNNZ_Jac(), 5);
+            TS_ASSERT_EQUALS(m.getNNZ_Hess(), 3);
+
+            vector<double> x = {2, 3};
+            vector<double> lambda = {0, 1, 1};
+            m.evaluate(x.data(), 1, lambda.data());
+            const Evaluation& e = m.getEvaluation();
+            TS_ASSERT_EQUALS(calls, 1);
+            TS_ASSERT_EQUALS(e.g, vector<double>({6, 6, 9}));
+            TS_ASSERT_EQUALS(e.jac, vector<double>({3, 2, 3, 2, 6}));
+            TS_ASSERT_EQUALS(e.jac_col, vector<int>({0, 1, 0, 1, 1}));
+            for (Idx i=0; i<e.hess.size(); i++){
+                PII p(e.hess_row[i], e.hess_col[i]);
+                TS_ASSERT_EQUALS(e.hess[i], p == PII(0, 0) ? 2 : (p == PII(1, 0) ? 1 : 2));
+            }
+
+            int failing = 0;
+            auto block2 = new CallbackBlock(1, 0, NULL, NULL, 0, NULL, NULL, NULL,
+                    [](void*, const double*, Idx, double*, double*, double*){ return false; },
+                    &failing);
+            m.addCallbackConstrs(block2, lb.data(), ub.data());
+            TS_ASSERT_THROWS(m.evaluate(x.data()), MadOptError);
+
+            vector<int> bad_cols = {0, 1, 5};
+            TS_ASSERT_THROWS(m.addCallbackConstrs(new CallbackBlock(2, 3, jac_rows.data(),
+                            bad_cols.data(), 0, NULL, NULL, NULL, callbackBlock, &calls),
+                        lb.data(), ub.data()), MadOptError);
+        }
+
+        void testBlackBox(){
+            vector<double> x = {2, 3, 0.5};
+            vector<double> lb = {0, 0};
+            vector<double> ub = {1, 2};
+            vector<double> jac = {3, 2, cos(3), 1};
+            vector<double> lambda = {1, 1};
+
+            for (Idx mode=0; mode<4; mode++){
+                TestModel m;
+                vector<Var> vars = {m.addVar("a"), m.addVar("b"), m.addVar("c")};
+                auto box = new TestBox(vars,
+                        mode % 2 ? BlackBox::COMPLEX_STEP : BlackBox::FORWARD_DIFFERENCE,
+                        BlackBox::SECOND_DIFFERENCE, mode < 2 ? 1 : 3);
+                TS_ASSERT_EQUALS(box->nofColors(), 2);
+                TS_ASSERT_EQUALS(box->nofEvaluations(), 8);
+                m.addCallbackConstrs(box, lb.data(), ub.data());
+                TS_ASSERT_EQUALS(m.getNNZ_Jac(), 4);
+                TS_ASSERT_EQUALS(m.getNNZ_Hess(), 5);
+
+                m.evaluate(x.data(), 1, lambda.data());
+                const Evaluation& e = m.getEvaluation();
+                TS_ASSERT_EQUALS(e.g, vector<double>({6, sin(3) + 0.25}));
+                for (Idx i=0; i<jac.size(); i++)
+                    TS_ASSERT_DELTA(e.jac[i], jac[i], mode % 2 ? 1e-14 : 1e-6);
+                for (Idx i=0; i<e.hess.size(); i++){
+                    PII p(e.hess_row[i], e.hess_col[i]);
+                    double h = 0;
+                    if (p == PII(0, 1) || p == PII(1, 0))
+                        h = 1;
+                    else if (p == PII(1, 1))
+                        h = -sin(3);
+                    else if (p == PII(2, 2))
+                        h = 2;
+                    TS_ASSERT_DELTA(e.hess[i], h, 1e-4);
+                }
+            }
+
+            TestModel m;
+            vector<Var> vars = {m.addVar("a"), m.addVar("b"), m.addVar("c")};
+            m.addCallbackConstrs(new TestBox(vars, BlackBox::FORWARD_DIFFERENCE,
+                        BlackBox::NO_HESSIAN, 1), lb.data(), ub.data());
+            TS_ASSERT_EQUALS(m.getNNZ_Hess(), 0);
+            vars.pop_back();
+            TS_ASSERT_THROWS(TestBox(vars, BlackBox::FORWARD_DIFFERENCE,
+                        BlackBox::NO_HESSIAN, 1), MadOptError);
+        }
+
+        void testTracing(){
+            Tracing::clear();
+            TestModel m;
+            Var a = m.addVar("a");
+            m.setObj(a*a);
+            vector<double> x = {2};
+            m.setEvals(x.data());
+
+            std::ostringstream empty;
+            Tracing::dump(empty);
+            TS_ASSERT_EQUALS(empty.str().find("Model::"), string::npos);
+
+            Tracing::enable(true);
+            m.addConstr(0, sin(a), 1);
+            m.setEvals(x.data());
+            Tracing::enable(false);
+            m.setEvals(x.data());
+
+            std::ostringstream trace;
+            Tracing::dump(trace);
+            const string json = trace.str();
+            TS_ASSERT_EQUALS(json.find("{\"traceEvents\": ["), 0);
+            TS_ASSERT(json.find("\"name\": \"Model::addConstr\"") != string::npos);
+            TS_ASSERT(json.find("\"name\": \"InnerConstraint::InnerConstraint\"") != string::npos);
+            const Idx first = json.find("Model::setEvals");
+            TS_ASSERT(first != string::npos);
+            TS_ASSERT_EQUALS(json.find("Model::setEvals", first+1), string::npos);
+            Tracing::clear();
+
+            // dump and clear must not race with the writers
+            Tracing::enable(true);
+            TS_ASSERT_THROWS(Tracing::dump(trace), MadOptError);
+            TS_ASSERT_THROWS(Tracing::clear(), MadOptError);
+
+            // a finished thread hands its buffer to the next one
+            for (int i=0; i<4; i++)
+                std::thread([]{ TRACE_SPAN("test::thread"); }).join();
+            Tracing::enable(false);
+            std::ostringstream threads;
+            Tracing::dump(threads);
+            std::set<string> tids;
+            const string events = threads.str();
+            for (size_t pos=events.find("test::thread"); pos!=string::npos;
+                    pos=events.find("test::thread", pos+1)){
+                const size_t tid = events.find("\"tid\": ", pos);
+                tids.insert(events.substr(tid, events.find(',', tid) - tid));
+            }
+            TS_ASSERT_EQUALS(tids.size(), 1);
+            TS_ASSERT_EQUALS(std::count(events.begin(), events.end(), '{') - 1, 4);
+            Tracing::clear();
+        }
+
+        void testProfile(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            m.setObj(a*a + b);
+            m.enableProfiling(true, 2);
+            Constraint c0 = m.addConstr(0, a*b, 1);
+            m.addConstr(0, b*a, 1);
+            Constraint c2 = m.addConstr(0, sin(a) + 2*pow(b, 3), 1);
+            c2.tag("trig");
+            c0.tag("prod");
+            TS_ASSERT_EQUALS(c2.tag(), "trig");
+            TS_ASSERT_EQUALS(m.tag(1), "");
+
+            vector<double> x = {1, 2};
+            for (Idx i=0; i<4; i++)
+                m.setEvals(x.data());
+
+            auto rows = m.profile(0);
+            TS_ASSERT_EQUALS(rows.size(), 4);
+            for (auto& p: rows){
+                TS_ASSERT_EQUALS(p.calls, 2);
+                TS_ASSERT_EQUALS(p.rows, 1);
+                if (p.example == 2){
+                    TS_ASSERT_EQUALS(p.name, "row 2");
+                    TS_ASSERT_EQUALS(p.tag, "trig");
+                    TS_ASSERT_EQUALS(p.tape.jac_nnz, 2);
+                    TS_ASSERT_EQUALS(p.tape.hess_nnz, 2);
+                    TS_ASSERT_EQUALS(p.tape.max_stack, 2);
+                    TS_ASSERT(p.build_seconds > 0);
+                } else if (p.example == -1){
+                    TS_ASSERT_EQUALS(p.name, "objective");
+                    TS_ASSERT_EQUALS(p.build_seconds, 0);
+                }
+            }
+            for (Idx i=1; i<rows.size(); i++)
+                TS_ASSERT(rows[i-1].seconds >= rows[i].seconds);
+            TS_ASSERT_EQUALS(m.profile(2).size(), 2);
+
+            // a*b and b*a have the same shape
+            auto shapes = m.profile(0, Profiler::SHAPE);
+            TS_ASSERT_EQUALS(shapes.size(), 3);
+            for (auto& p: shapes)
+                if (p.example == 0){
+                    TS_ASSERT_EQUALS(p.rows, 2);
+                    TS_ASSERT_EQUALS(p.calls, 4);
+                    TS_ASSERT_EQUALS(p.tape.jac_nnz, 4);
+                    TS_ASSERT_EQUALS(p.tag, "");
+                }
+
+            auto tags = m.profile(0, Profiler::TAG);
+            TS_ASSERT_EQUALS(tags.size(), 4);
+            for (auto& p: tags)
+                if (p.example == 1)
+                    TS_ASSERT_EQUALS(p.name, "untagged");
+            TS_ASSERT(m.profileString().find("trig") != string::npos);
+
+            m.clearProfile();
+            m.enableProfiling(false);
+            m.setEvals(x.data());
+            for (auto& p: m.profile(0))
+                TS_ASSERT_EQUALS(p.calls, 0);
+            TS_ASSERT_THROWS(m.enableProfiling(true, 0), MadOptError);
+        }
+
+        void testMemoryReport(){
+            TestModel m;
+            Var a = m.addVar("a");
+            Var b = m.addVar("b");
+            m.addParam(1, "p");
+            m.setObj(a*a + b);
+            m.addConstr(0, a*b, 1);
+            m.addConstr(0, sin(a) + pow(b, 3)*a, 1);
+            vector<double> lb(1, 0), ub(1, 1);
+            int calls = 0;
+            vector<int> rows = {0}, cols = {0};
+            m.addCallbackConstrs(new CallbackBlock(1, 1, rows.data(), cols.data(),
+                        0, NULL, NULL, NULL, callbackBlock, &calls), lb.data(), ub.data());
+
+            MemoryReport report = m.memoryReport();
+            TS_ASSERT_EQUALS(report.get("variables").objects, 2);
+            TS_ASSERT_EQUALS(report.get("parameters").objects, 1);
+            TS_ASSERT_EQUALS(report.get("objective").objects, 1);
+            TS_ASSERT_EQUALS(report.get("constraint").objects, 2);
+            TS_ASSERT_EQUALS(report.get("callback").objects, 1);
+            TS_ASSERT_EQUALS(report.get("unknown").bytes, 0);
+
+            const auto& ops = report.get("constraint.operators");
+            TS_ASSERT_EQUALS(ops.objects, 2);
+            // the tapes are allocated with their exact size
+            Idx nof_ops = 0, max_ops = 0;
+            for (auto& p: m.profile(0))
+                if (p.example >= 0){
+                    nof_ops += p.tape.operators;
+                    max_ops = std::max(max_ops, p.tape.operators);
+                }
+            TS_ASSERT_EQUALS(ops.bytes, nof_ops*sizeof(OPType));
+            TS_ASSERT_EQUALS(ops.max_bytes, max_ops*sizeof(OPType));
+            TS_ASSERT(ops.max_bytes >= ops.mean());
+            TS_ASSERT(report.get("constraint.jac_plan").bytes > 0);
+            TS_ASSERT(report.get("hess_structure").bytes > 0);
+            TS_ASSERT(report.get("cstack").bytes > 0);
+
+            std::size_t sum = 0;
+            for (auto& e: report.entries)
+                sum += e.bytes;
+            TS_ASSERT_EQUALS(report.total(), sum);
+            TS_ASSERT(report.str().find("constraint.hess_map") != string::npos);
+        }
+
+        void testReplaceObjective(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<100; i++)
+                x.push_back(m.addVar("x" + std::to_string((long long int)i)));
+            Param p = m.addParam(1, "p");
+            m.addConstr(0, x[0]*x[1], 1);
+            vector<double> values(100, 0.5);
+            auto objective = [&](Idx k){
+                Expr obj(0);
+                for (Idx i=0; i<100; i++)
+                    obj += (p + k)*x[i]*x[(i + k) % 100];
+                return obj;
+            };
+            // the first replacement grows the buffers of the hessian structure
+            for (Idx k=0; k<2; k++){
+                m.setObj(objective(1));
+                m.evaluate(values.data());
+            }
+            const std::size_t arena_bytes = m.getArena().bytes();
+            const std::size_t total = m.memoryReport().total();
+            // a parametric loop replaces the objective, the old one is freed
+            for (Idx k=0; k<50; k++){
+                m.setObj(objective(1));
+                m.evaluate(values.data());
+            }
+            TS_ASSERT_EQUALS(m.getArena().bytes(), arena_bytes);
+            TS_ASSERT_EQUALS(m.memoryReport().total(), total);
+            TS_ASSERT_EQUALS(m.memoryReport().get("objective").objects, 1);
+        }
+
+        void testFinalize(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<20; i++)
+                x.push_back(m.addVar("x" + std::to_string((long long int)i)));
+            m.setObj(x[0]*x[0] + x[19]);
+            for (Idx i=0; i<19; i++)
+                m.addConstr(0, x[i]*x[i+1] + sin(x[i]), 1);
+
+            vector<double> values(20, 0.5);
+            vector<double> lambda(20, 1);
+            m.evaluate(values.data(), 1, lambda.data());
+            const Evaluation before = m.getEvaluation();
+            MemoryReport report = m.memoryReport();
+            TS_ASSERT(report.get("simstack").bytes > 0);
+
+            m.finalize();
+            TS_ASSERT(m.isFinalized());
+            MemoryReport finalized = m.memoryReport();
+            TS_ASSERT_EQUALS(finalized.get("simstack").bytes, 0);
+            TS_ASSERT_EQUALS(finalized.get("hess_structure").bytes,
+                    2*m.getNNZ_Hess()*sizeof(int));
+            TS_ASSERT(finalized.get("hess_structure").bytes
+                    <= report.get("hess_structure").bytes);
+            TS_ASSERT(finalized.total() < report.total());
+
+            m.evaluate(values.data(), 1, lambda.data());
+            const Evaluation& e = m.getEvaluation();
+            TS_ASSERT_EQUALS(e.f, before.f);
+            TS_ASSERT_EQUALS(e.g, before.g);
+            TS_ASSERT_EQUALS(e.jac, before.jac);
+            TS_ASSERT_EQUALS(e.hess, before.hess);
+            TS_ASSERT_EQUALS(e.hess_row, before.hess_row);
+            TS_ASSERT_EQUALS(e.hess_col, before.hess_col);
+
+            // adding a constraint sorts its new entry into the structure
+            const Idx nnz_hess = m.getNNZ_Hess();
+            m.addConstr(0, x[0]*x[1] + x[5]*x[10], 1);
+            TS_ASSERT(!m.isFinalized());
+            TS_ASSERT_EQUALS(m.getNNZ_Hess(), nnz_hess + 1);
+            m.evaluate(values.data(), 1, lambda.data());
+            TS_ASSERT_EQUALS(e.g.back(), 0.5);
+            map<PII, double> old_hess, new_hess;
+            for (Idx i=0; i<nnz_hess; i++)
+                old_hess[PII(before.hess_row[i], before.hess_col[i])] = before.hess[i];
+            for (Idx i=0; i<=nnz_hess; i++)
+                new_hess[PII(e.hess_row[i], e.hess_col[i])] = e.hess[i];
+            old_hess[PII(1, 0)] += 1;
+            old_hess[PII(10, 5)] = 1;
+            TS_ASSERT_EQUALS(new_hess, old_hess);
+
+            m.finalize();
+            m.evaluate(values.data(), 1, lambda.data());
+            TS_ASSERT_EQUALS(e.hess_row.size(), nnz_hess + 1);
+            for (Idx i=0; i<nnz_hess; i++)
+                TS_ASSERT(PII(e.hess_row[i], e.hess_col[i])
+                        < PII(e.hess_row[i+1], e.hess_col[i+1]));
+        }
+
+        void testHessStructure(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<10; i++)
+                x.push_back(m.addVar("x" + std::to_string((long long int)i)));
+            m.setObj(x[9]*x[0] + x[3]*x[3]);
+            for (Idx i=9; i>0; i--)
+                m.addConstr(0, x[i]*x[i-1] + x[0]*x[9], 1);
+
+            // lower triangle, sorted row-major and without duplicates
+            TS_ASSERT_EQUALS(m.getNNZ_Hess(), 11);
+            vector<int> rows(m.getNNZ_Hess()), cols(m.getNNZ_Hess());
+            m.getNZ_Hess(rows.data(), cols.data());
+            TS_ASSERT_EQUALS(rows, vector<int>({1, 2, 3, 3, 4, 5, 6, 7, 8, 9, 9}));
+            TS_ASSERT_EQUALS(cols, vector<int>({0, 1, 2, 3, 3, 4, 5, 6, 7, 0, 8}));
+
+            vector<double> values(10, 1);
+            vector<double> lambda(9, 1);
+            m.evaluate(values.data(), 2, lambda.data());
+            TS_ASSERT_EQUALS(m.getEvaluation().hess,
+                    vector<double>({1, 1, 1, 4, 1, 1, 1, 1, 1, 9 + 2, 1}));
+        }
+
+        void testEvalLevel(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<6; i++)
+                x.push_back(m.addVar("x" + std::to_string((long long int)i)));
+            m.setObj(x[0]*x[1]*x[2] + pow(x[3], 3));
+            for (Idx i=0; i<5; i++)
+                m.addConstr(0, sin(x[i])*x[i+1] + ln(x[i+1]) + pow(x[i], 2), 1);
+            TS_ASSERT_EQUALS(m.getEvalLevel(), EVAL_HESS);
+
+            vector<vector<double>> points = {vector<double>(6, 0.5),
+                vector<double>({1, 2, 3, 4, 5, 6})};
+            vector<double> lambda(5, 1.5);
+            vector<Evaluation> expected;
+            FOREACH(p, points)
+            //for (auto& p: points){
+                m.evaluate(p.data(), 2, lambda.data());
+                expected.push_back(m.getEvaluation());
+            }
+
+            // a lower level evaluates again for the derivatives
+            for (EvalLevel level: {EVAL_VALUE, EVAL_JAC, EVAL_HESS}){
+                m.setEvalLevel(level);
+                for (Idx k=0; k<points.size(); k++){
+                    m.evaluate(points[k].data(), 2, lambda.data());
+                    const Evaluation& e = m.getEvaluation();
+                    TS_ASSERT_EQUALS(e.f, expected[k].f);
+                    TS_ASSERT_EQUALS(e.grad_f, expected[k].grad_f);
+                    TS_ASSERT_EQUALS(e.g, expected[k].g);
+                    TS_ASSERT_EQUALS(e.jac, expected[k].jac);
+                    TS_ASSERT_EQUALS(e.hess, expected[k].hess);
+                }
+            }
+
+            // the values only
+            m.setEvals(points[1].data(), EVAL_VALUE);
+            vector<double> g(5);
+            m.eval_g(points[1].data(), false, g.data());
+            TS_ASSERT_EQUALS(g, expected[1].g);
+        }
+
+        void testEngine(){
+            TestModel m;
+            vector<Var> x;
+            for (Idx i=0; i<6; i++)
+                x.push_back(m.addVar("x" + std::to_string((long long int)i)));
+            m.setObj(x[0]*x[1]*x[0] + pow(x[3], 3));
+            for (Idx i=0; i<5; i++)
+                m.addConstr(0, (x[i] + x[i+1]*x[i])*sin(x[i]*x[i+1] + x[i]), 1);
+            TS_ASSERT_EQUALS(m.getEngine(), ENGINE_PLAN);
+
+            vector<double> values = {0.5, 1, 1.5, 2, 2.5, 3};
+            vector<double> lambda(6, 1.5);
+            auto compare = [&](){
+                m.setEngine(ENGINE_PLAN);
+                m.evaluate(values.data(), 2, lambda.data());
+                const Evaluation expected = m.getEvaluation();
+                m.setEngine(ENGINE_ONE_PASS);
+                TS_ASSERT_EQUALS(m.getEngine(), ENGINE_ONE_PASS);
+                for (Idx k=0; k<2; k++){
+                    m.evaluate(values.data(), 2, lambda.data());
+                    const Evaluation& e = m.getEvaluation();
+                    TS_ASSERT_DELTA(e.f, expected.f, 1e-12);
+                    for (Idx i=0; i<e.g.size(); i++)
+                        TS_ASSERT_DELTA(e.g[i], expected.g[i], 1e-12);
+                    for (Idx i=0; i<e.jac.size(); i++)
+                        TS_ASSERT_DELTA(e.jac[i], expected.jac[i], 1e-12);
+                    for (Idx i=0; i<e.hess.size(); i++)
+                        TS_ASSERT_DELTA(e.hess[i], expected.hess[i], 1e-12);
+                }
+            };
+            compare();
+
+            // a new constraint moves the positions of the aligned ones
+            m.addConstr(0, x[5]*x[0]*x[5] + x[2]*x[4], 1);
+            lambda.push_back(2);
+            compare();
+        }
+
+        void testCanonicalisePolynomials(){
+            TestModel plain;
+            TestModel m;
+            TS_ASSERT(!m.canonicalisingPolynomials());
+            m.canonicalisePolynomials();
+            TS_ASSERT(m.canonicalisingPolynomials());
+            vector<double> values = {0.5, -1.5, 2};
+            vector<double> lambda = {1.5, -2, 0.5};
+            for (TestModel* model: {&plain, &m}){
+                Var x = model->addVar("x");
+                Var y = model->addVar("y");
+                Var z = model->addVar("z");
+                model->setObj(2*pow(x, 3) + x*y + 3*x + y*x - x*x + 1);
+                // identical monomials and a univariate polynomial inside sin
+                model->addConstr(0, sin(x*y*z + 2*z*x*y + pow(y, 4) + y), 1);
+                model->addConstr(0, x*x*y - y*x*x + z, 1);
+                model->addConstr(0, pow(z, 2) + z + x/y, 1);
+            }
+            plain.evaluate(values.data(), 2, lambda.data());
+            const Evaluation expected = plain.getEvaluation();
+            m.evaluate(values.data(), 2, lambda.data());
+            const Evaluation& e = m.getEvaluation();
+            TS_ASSERT_DELTA(e.f, expected.f, 1e-12);
+            for (Idx i=0; i<e.g.size(); i++)
+                TS_ASSERT_DELTA(e.g[i], expected.g[i], 1e-12);
+            // x*x*y - y*x*x cancels, the jacobian has two entries less
+            TS_ASSERT_EQUALS(e.jac.size(), expected.jac.size() - 2);
+            vector<double> jac(9, 0), jac_expected(9, 0);
+            for (Idx i=0; i<e.jac.size(); i++)
+                jac[3*e.jac_row[i] + e.jac_col[i]] += e.jac[i];
+            for (Idx i=0; i<expected.jac.size(); i++)
+                jac_expected[3*expected.jac_row[i] + expected.jac_col[i]] += expected.jac[i];
+            for (Idx i=0; i<9; i++)
+                TS_ASSERT_DELTA(jac[i], jac_expected[i], 1e-12);
+            vector<double> hess(9, 0), hess_expected(9, 0);
+            for (Idx i=0; i<e.hess.size(); i++)
+                hess[3*e.hess_row[i] + e.hess_col[i]] += e.hess[i];
+            for (Idx i=0; i<expected.hess.size(); i++)
+                hess_expected[3*expected.hess_row[i] + expected.hess_col[i]] += expected.hess[i];
+            for (Idx i=0; i<9; i++)
+                TS_ASSERT_DELTA(hess[i], hess_expected[i], 1e-12);
+
+            const PolynomialStats& stats = m.polynomialStats();
+            TS_ASSERT_EQUALS(stats.expressions, 4);
+            TS_ASSERT_EQUALS(plain.polynomialStats().expressions, 0);
+            TS_ASSERT(stats.operators_after < stats.operators_before);
+            TS_ASSERT(stats.saved() > 0);
+        }
+
+        void testCanonicalise(){
+            TestModel m;
+            Var x = m.addVar("x");
+            Var y = m.addVar("y");
+            TS_ASSERT_EQUALS(canonicalise(x*y + 2*y*x).toString(), "3*x*y");
+            TS_ASSERT_EQUALS(canonicalise(3*pow(x, 3) + x*y + 2*x + 4 + y*x).toString(),
+                    "(3*x*x+2)*x+2*x*y+4");
+            TS_ASSERT_EQUALS(canonicalise(x*y - y*x + 1).toString(), "1");
+            TS_ASSERT_EQUALS(canonicalise(sin(x) + x*2 + sin(x)).toString(),
+                    "sin(x)+sin(x)+2*x");
+
+            Expr p = pow(x, 4) - 2*pow(x, 3) + 3*pow(x, 2) - 4*x + 5;
+            TS_ASSERT_EQUALS(canonicalise(p).toString(), "(((x+-2)*x+3)*x+-4)*x+5");
+            TS_ASSERT(InnerConstraint::tapeLength(canonicalise(p))
+                    < InnerConstraint::tapeLength(p));
+        }
 };
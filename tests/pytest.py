@@ -37,6 +37,10 @@ model.solve()
 if model.has_solution:
     print(model.nx, model.ng, model.objValue, model.stat)
 
+# timings and call counts of the last solve
+stats = model.stats
+print(stats["iterations"], stats["eval_h"]["calls"], stats["callback_seconds"], stats["solve"]["seconds"])
+
 var = x[0]
 if model.has_solution:
     # var.x ==> solution value
@@ -0,0 +1,58 @@
+# Solves independent models from a python thread pool and checks that the
+# solves run in parallel, this requires that madopt releases the GIL and that
+# ipopt uses a thread safe linear solver, e.g.
+#   MADOPT_LINEAR_SOLVER=ma27 python tests/pythreads.py
+import os
+import time
+import concurrent.futures
+
+import madopt
+
+N = 10**4
+THREADS = min(4, os.cpu_count() or 1)
+LINEAR_SOLVER = os.environ.get('MADOPT_LINEAR_SOLVER')
+
+
+def tutorial(p):
+    model = madopt.IpoptModel()
+    if LINEAR_SOLVER:
+        model.setOption('linear_solver', LINEAR_SOLVER)
+    x = [model.addVar(lb=-1.5, ub=0, init=-0.5) for i in range(N)]
+
+    obj = madopt.Expr(0)
+    for i in range(N):
+        obj += (x[i] - p)**2
+    model.setObj(obj)
+
+    for i in range(N-2):
+        a = float(i+2)/float(N)
+        model.addEqConstr((x[i+1]**2 + 1.5*x[i+1] - a)*madopt.cos(x[i+2]) - x[i])
+    return model
+
+
+def solve(model):
+    model.solve()
+    return model.status
+
+
+models = [tutorial(1 + 0.01*i) for i in range(THREADS)]
+
+# the first solve of a model prepares its evaluation (hessian structure,
+# ipopt application), both timed passes re-solve prepared models
+status = [solve(m) for m in models]
+
+start = time.time()
+status += [solve(m) for m in models]
+serial = time.time() - start
+
+start = time.time()
+with concurrent.futures.ThreadPoolExecutor(THREADS) as executor:
+    status += list(executor.map(solve, models))
+parallel = time.time() - start
+
+speedup = serial/parallel
+print('threads', THREADS, 'serial', serial, 'parallel', parallel, 'speedup', speedup)
+
+assert all(s == 0 for s in status)
+# a loose bound, shared machines rarely give the ideal speedup
+assert THREADS == 1 or parallel < 0.8*serial